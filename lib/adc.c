@@ -37,9 +37,10 @@ void AdcInit(void)
   // align to left -> ADCH
   //ADMUX |= (1 << ADLAR);
   // setting adc
-  // - ADIE: adc interrupt enable
   // - ADEN: adc enable
-  ADCSRA |= (1 << ADIE) | (1 << ADEN);  
+  // - ADIE stays cleared, conversion is polled and there is no ADC_vect
+  //   handler, enabled global interrupts would jump to bad interrupt
+  ADCSRA |= (1 << ADEN);  
   // set prescaler => f = 8Mhz / 64 = 125 kHz
   ADC_SET_PRESCALER(ADC_PRESCALER_64); 
 }
@@ -60,7 +61,7 @@ unsigned int AdcReadADC(char channel)
   // start conversion
   ADCSRA |= (1 << ADSC);
   // wait conversion complete
-  while (ADCSRA & (1 << ADIF));
+  while (ADCSRA & (1 << ADSC));
   // read ADCL
   value = ADCL;
   // read ADCH
@@ -83,7 +84,7 @@ char AdcReadADCH(char channel)
   // start conversion
   ADCSRA |= (1 << ADSC);
   // wait conversion complete
-  while (ADCSRA & (1 << ADIF));
+  while (ADCSRA & (1 << ADSC));
   // righ adjusted conversion result
   return ADCH;
 }
@@ -0,0 +1,150 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Display value binding with change detection
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       06.12.2020
+ * @file        binding.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      binding.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <string.h>
+#include "scheduler.h"
+#include "hd44780pcf8574.h"
+#include "binding.h"
+
+/**
+ * @desc    Init field
+ *
+ * @param   BIND_Field *
+ * @param   char x
+ * @param   char y
+ * @param   char width
+ * @param   char * (*)(unsigned long int, char *) - formatting function
+ * @param   unsigned int deadband
+ * @param   unsigned int max age in ms
+ *
+ * @return  void
+ */
+void BIND_Init (BIND_Field *field, char x, char y, char width, char * (*format)(unsigned long int, char *), unsigned int deadband, unsigned int max_age)
+{
+  // position
+  field->x = x;
+  field->y = y;
+  // width limited by buffer
+  field->width = (width < BIND_WIDTH) ? width : (BIND_WIDTH - 1);
+  // nothing on glass yet
+  field->flags = 0;
+  // change detection
+  field->deadband = deadband;
+  field->max_age = max_age;
+  field->stamp = 0;
+  field->value = 0;
+  // formatting
+  field->format = format;
+  field->shown[0] = '\0';
+  field->next[0] = '\0';
+}
+
+/**
+ * @desc    Set new value, format only if outside deadband or max age elapsed
+ *
+ * @param   BIND_Field *
+ * @param   unsigned long int
+ *
+ * @return  char - 1 if field needs flush
+ */
+char BIND_Set (BIND_Field *field, unsigned long int value)
+{
+  unsigned char i;
+  unsigned char len;
+  unsigned long int diff;
+  // formatting function can write more than width
+  char str[BIND_WIDTH + 8];
+  // max age elapsed
+  char forced = (field->max_age > 0) && ((unsigned int) (SCHED_Millis() - field->stamp) >= field->max_age);
+
+  // value known and not too old
+  if ((field->flags & BIND_VALID) && !forced) {
+    // absolute difference
+    diff = (value > field->value) ? (value - field->value) : (field->value - value);
+    // jitter inside deadband
+    if (diff <= field->deadband) {
+      // keep previous request
+      return (field->flags & BIND_DIRTY) ? 1 : 0;
+    }
+  }
+
+  // format new value
+  field->value = value;
+  // formatting function can leave string untouched
+  str[0] = '\0';
+  field->format(value, str);
+  len = strlen(str);
+  // copy and pad with spaces to width
+  for (i = 0; i < field->width; i++) {
+    field->next[i] = (i < len) ? str[i] : ' ';
+  }
+  field->next[i] = '\0';
+
+  // forced rewrite of whole field
+  if (forced) {
+    field->flags |= BIND_DIRTY | BIND_FORCED;
+  // visible text changes
+  } else if (!(field->flags & BIND_VALID) || strcmp(field->next, field->shown)) {
+    field->flags |= BIND_DIRTY;
+  // same digits, nothing to do
+  } else {
+    field->flags &= ~BIND_DIRTY;
+  }
+
+  // flush request
+  return (field->flags & BIND_DIRTY) ? 1 : 0;
+}
+
+/**
+ * @desc    Write changed characters of field to display
+ *
+ * @param   char addr
+ * @param   BIND_Field *
+ *
+ * @return  void
+ */
+void BIND_Flush (char addr, BIND_Field *field)
+{
+  unsigned char first = 0;
+  unsigned char last = field->width - 1;
+
+  // nothing to do
+  if (!(field->flags & BIND_DIRTY)) {
+    return;
+  }
+  // only changed span if glass content is known
+  if ((field->flags & BIND_VALID) && !(field->flags & BIND_FORCED)) {
+    // first changed char
+    while ((first < last) && (field->next[first] == field->shown[first])) {
+      first++;
+    }
+    // last changed char
+    while ((last > first) && (field->next[last] == field->shown[last])) {
+      last--;
+    }
+  }
+  // set position
+  HD44780_PCF8574_PositionXY(addr, field->x + first, field->y);
+  // draw changed span
+  while (first <= last) {
+    HD44780_PCF8574_DrawChar(addr, field->next[first++]);
+  }
+  // glass updated
+  strcpy(field->shown, field->next);
+  field->stamp = SCHED_Millis();
+  field->flags = (field->flags | BIND_VALID) & ~(BIND_DIRTY | BIND_FORCED);
+}
@@ -0,0 +1,89 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Display value binding with change detection
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       06.12.2020
+ * @file        binding.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ */
+
+/** @definition */
+#ifndef __BINDING_H__
+#define __BINDING_H__
+
+  // @const max field width including '\0'
+  #define BIND_WIDTH             8
+
+  // @const field flags
+  #define BIND_VALID             0x01  // text on glass is known
+  #define BIND_DIRTY             0x02  // next text differs from shown text
+  #define BIND_FORCED            0x04  // max age elapsed, rewrite whole field
+
+  /** @struct field bound to position on display */
+  typedef struct {
+    // position
+    char x;
+    char y;
+    // visible width, shorter text is padded with spaces
+    char width;
+    // flags
+    char flags;
+    // deadband - changes smaller or equal are ignored
+    unsigned int deadband;
+    // forced refresh period in ms, 0 = never
+    unsigned int max_age;
+    // ms of last rewrite
+    unsigned int stamp;
+    // last formatted value
+    unsigned long int value;
+    // formatting function, same as AdcValToDecStr
+    char * (*format)(unsigned long int, char *);
+    // text on glass
+    char shown[BIND_WIDTH];
+    // text to render
+    char next[BIND_WIDTH];
+  } BIND_Field;
+
+  /**
+   * @desc    Init field
+   *
+   * @param   BIND_Field *
+   * @param   char x
+   * @param   char y
+   * @param   char width
+   * @param   char * (*)(unsigned long int, char *) - formatting function
+   * @param   unsigned int deadband
+   * @param   unsigned int max age in ms
+   *
+   * @return  void
+   */
+  void BIND_Init (BIND_Field *, char, char, char, char * (*)(unsigned long int, char *), unsigned int, unsigned int);
+
+  /**
+   * @desc    Set new value, format only if outside deadband or max age elapsed
+   *
+   * @param   BIND_Field *
+   * @param   unsigned long int
+   *
+   * @return  char - 1 if field needs flush
+   */
+  char BIND_Set (BIND_Field *, unsigned long int);
+
+  /**
+   * @desc    Write changed characters of field to display
+   *
+   * @param   char addr
+   * @param   BIND_Field *
+   *
+   * @return  void
+   */
+  void BIND_Flush (char, BIND_Field *);
+
+#endif
@@ -0,0 +1,307 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UART bridge - framed binary protocol from host to LCD
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       24.12.2020
+ * @file        bridge.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      bridge.h, uart.h, hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ */
+#include <string.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include "bridge.h"
+
+// compiled only with make BRIDGE=1
+#if BRIDGE
+
+#include "uart.h"
+#include "scheduler.h"
+
+// @const receiver state
+#define BRIDGE_STATE_SYNC        0
+#define BRIDGE_STATE_LENGTH      1
+#define BRIDGE_STATE_PAYLOAD     2
+#define BRIDGE_STATE_CRC         3
+
+/** @var received frames */
+volatile BRIDGE_Stats _bridge_stats;
+
+/** @var front drawn by flush, back written by RX interrupt */
+static BRIDGE_Image _bridge_image[2];
+
+/** @var index of front image */
+static volatile unsigned char _bridge_front = 0;
+
+/** @var receiver state */
+static unsigned char _bridge_state = BRIDGE_STATE_SYNC;
+
+/** @var payload bytes still expected */
+static unsigned char _bridge_left;
+
+/** @var CRC of length and payload so far */
+static unsigned char _bridge_crc;
+
+/** @var command being received, its bytes so far, 0 = next is command */
+static unsigned char _bridge_cmd;
+static unsigned char _bridge_arg = 0;
+
+/** @var cell or CGRAM slot, codes left of cells command */
+static unsigned char _bridge_at;
+static unsigned char _bridge_count;
+
+/** @var frame dropped at its CRC byte */
+static unsigned char _bridge_bad;
+
+/** @var parts of back image written by open frame */
+static unsigned int _bridge_pending = 0;
+
+/** @var parts of front image not on LCD yet */
+static volatile unsigned int _bridge_dirty = 0;
+
+/** @var LCD setup task id */
+static char _bridge_setup = SCHED_NO_TASK;
+
+/** @var LCD ready flag */
+static volatile char _bridge_ready = 0;
+
+/**
+ * @desc    Apply payload byte to back image
+ *
+ * @param   BRIDGE_Image * - back image
+ * @param   unsigned char - byte
+ *
+ * @return  void
+ */
+static void BRIDGE_Command (BRIDGE_Image *back, unsigned char byte)
+{
+  // command
+  if (_bridge_arg == 0) {
+    _bridge_cmd = byte;
+    _bridge_arg = 1;
+    // unknown command, length of rest not known
+    if ((byte < BRIDGE_CMD_CELLS) || (byte > BRIDGE_CMD_BACKLIGHT)) {
+      _bridge_bad = 1;
+    }
+    return;
+  }
+  switch (_bridge_cmd) {
+    // cell, count, codes
+    case BRIDGE_CMD_CELLS:
+      if (_bridge_arg == 1) {
+        _bridge_at = byte;
+        _bridge_arg = 2;
+      } else if (_bridge_arg == 2) {
+        _bridge_count = byte;
+        _bridge_arg = byte ? 3 : 0;
+      } else {
+        // codes beyond last cell dropped
+        if (_bridge_at < BRIDGE_CELLS) {
+          back->text[_bridge_at] = byte;
+          _bridge_pending |= (_bridge_at < HD44780_COLS) ? HD44780_DIRTY_ROW0 : HD44780_DIRTY_ROW1;
+          _bridge_at++;
+        }
+        if (--_bridge_count == 0) {
+          _bridge_arg = 0;
+        }
+      }
+      break;
+    // cell, control
+    case BRIDGE_CMD_CURSOR:
+      if (_bridge_arg == 1) {
+        back->cursor = byte;
+        _bridge_arg = 2;
+      } else {
+        back->control = byte;
+        _bridge_arg = 0;
+      }
+      _bridge_pending |= HD44780_DIRTY_CURSOR;
+      break;
+    // slot, 8 rows
+    case BRIDGE_CMD_GLYPH:
+      if (_bridge_arg == 1) {
+        _bridge_at = byte & 0x07;
+      } else {
+        back->cgram[(_bridge_at << 3) + _bridge_arg - 2] = byte;
+        _bridge_pending |= 1 << _bridge_at;
+      }
+      if (++_bridge_arg == 10) {
+        _bridge_arg = 0;
+      }
+      break;
+    // on
+    case BRIDGE_CMD_BACKLIGHT:
+      back->backlight = byte;
+      _bridge_pending |= HD44780_DIRTY_BACKLIGHT;
+      _bridge_arg = 0;
+      break;
+    // unknown command, bytes ignored till CRC
+    default:
+      break;
+  }
+}
+
+/**
+ * @desc    UART receive - one byte of frame
+ *
+ * @param   USART_RX_vect
+ *
+ * @return  void
+ */
+ISR(USART_RX_vect)
+{
+  // flags valid before data is read
+  unsigned char status = UCSR0A;
+  unsigned char byte = UDR0;
+
+  switch (_bridge_state) {
+    // start of frame
+    case BRIDGE_STATE_SYNC:
+      if (byte == BRIDGE_SYNC) {
+        _bridge_state = BRIDGE_STATE_LENGTH;
+      }
+      break;
+    // back image starts as front, frame writes only its changes
+    case BRIDGE_STATE_LENGTH:
+      memcpy(&_bridge_image[_bridge_front ^ 1], &_bridge_image[_bridge_front], sizeof(BRIDGE_Image));
+      _bridge_crc = _crc8_ccitt_update(0, byte);
+      _bridge_left = byte;
+      _bridge_arg = 0;
+      _bridge_bad = 0;
+      _bridge_pending = 0;
+      _bridge_state = byte ? BRIDGE_STATE_PAYLOAD : BRIDGE_STATE_CRC;
+      break;
+    // commands
+    case BRIDGE_STATE_PAYLOAD:
+      _bridge_crc = _crc8_ccitt_update(_bridge_crc, byte);
+      BRIDGE_Command(&_bridge_image[_bridge_front ^ 1], byte);
+      if (--_bridge_left == 0) {
+        _bridge_state = BRIDGE_STATE_CRC;
+      }
+      break;
+    // whole frame valid, images swapped
+    case BRIDGE_STATE_CRC:
+      if ((byte == _bridge_crc) && !_bridge_bad && (_bridge_arg == 0)) {
+        _bridge_front ^= 1;
+        _bridge_dirty |= _bridge_pending;
+        _bridge_stats.frames++;
+      } else {
+        _bridge_stats.errors++;
+      }
+      _bridge_state = BRIDGE_STATE_SYNC;
+      break;
+  }
+  // byte lost after this one, open frame fails its CRC
+  if (status & (1 << DOR0)) {
+    _bridge_stats.overruns++;
+    _bridge_bad = 1;
+  }
+}
+
+/**
+ * @desc    Init images, UART with RX interrupt
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void BRIDGE_Init (void)
+{
+  unsigned char i;
+
+  // blank screen, display on, backlight on
+  memset(_bridge_image, 0, sizeof(_bridge_image));
+  for (i = 0; i < BRIDGE_CELLS; i++) {
+    _bridge_image[0].text[i] = ' ';
+  }
+  _bridge_image[0].control = BRIDGE_CONTROL_DISPLAY;
+  _bridge_image[0].backlight = 1;
+  _bridge_front = 0;
+  _bridge_state = BRIDGE_STATE_SYNC;
+  // 8N1, double speed
+  UART_Init(UART_UBRR(BRIDGE_BAUD));
+  // receive interrupt
+  UCSR0B |= (1 << RXCIE0);
+}
+
+/**
+ * @desc    Draw front image, only cells differing from shadow
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void BRIDGE_Flush (void)
+{
+  BRIDGE_Image image;
+  unsigned int dirty;
+
+  // LCD still in setup
+  if (!_bridge_ready) {
+    return;
+  }
+  // last complete frame, frames received while drawing come next time
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    dirty = _bridge_dirty;
+    _bridge_dirty = 0;
+    if (dirty) {
+      memcpy(&image, &_bridge_image[_bridge_front], sizeof(image));
+    }
+  }
+  if (!dirty) {
+    return;
+  }
+  // copy drawn, receiver may write next frame meanwhile
+  HD44780_PCF8574_DrawImage(PCF8574_ADDRESS, image.text, image.cgram, image.cursor, image.control, image.backlight, dirty);
+}
+
+/**
+ * @desc    Bridge task - LCD setup, released every tick till done
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void BridgeSetup (void)
+{
+  // setup done, frames received meanwhile drawn with whole image
+  if (HD44780_PCF8574_InitImage(PCF8574_ADDRESS, &_bridge_dirty) != PCF8574_PENDING) {
+    // stop polling
+    SCHED_DeleteTask(_bridge_setup);
+    _bridge_ready = 1;
+  }
+}
+
+/**
+ * @desc    Bridge firmware - LCD setup, receiver, flush task
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Bridge (void)
+{
+  // init scheduler, 1 ms tick, interrupts enabled
+  SCHED_Init();
+  // LCD setup, power on wait runs from now
+  _bridge_setup = SCHED_AddTask(BridgeSetup, 0, 1);
+  // frames received from now, drawn after setup
+  BRIDGE_Init();
+  // diff flush of received frames
+  SCHED_AddTask(BRIDGE_Flush, BRIDGE_FLUSH_MS, BRIDGE_FLUSH_MS);
+
+  // infinitive loop
+  while (1) {
+    // run released tasks, idle till next tick, UART wakes up
+    SCHED_Dispatch();
+  }
+}
+
+#endif
@@ -0,0 +1,148 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UART bridge - framed binary protocol from host to LCD
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       24.12.2020
+ * @file        bridge.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      uart.h, hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ * @usage       make BRIDGE=1, BAUD=76800 (default)
+ *
+ *              Host streams frames over UART 8N1, no reply:
+ *              0xA5, length, payload, CRC-8 of length and payload
+ *              (polynomial 0x07, init 0, _crc8_ccitt_update). Payload
+ *              is sequence of commands:
+ *
+ *              0x01 cell n codes[n]    run of cells from 0x00 - 0x1F,
+ *                                      row 1 from 0x10, 0 - 7 CGRAM
+ *              0x02 cell control       cursor cell, control bit 2
+ *                                      display, 1 cursor, 0 blink
+ *              0x03 slot rows[8]       CGRAM character 0 - 7
+ *              0x04 on                 backlight, 0 off
+ *
+ *              RX interrupt applies commands to back image, copied
+ *              from front at length byte. Valid CRC swaps images,
+ *              frame with bad CRC, unknown command or lost byte is
+ *              dropped whole. Flush task draws front image, only cells
+ *              differing from shadow of LCD, frames arriving meanwhile
+ *              are coalesced.
+ */
+
+/** @definition */
+#ifndef __BRIDGE_H__
+#define __BRIDGE_H__
+
+#include "uart.h"
+#include "hd44780pcf8574.h"
+
+  // UART bridge firmware, make BRIDGE=1
+  #ifndef BRIDGE
+    #define BRIDGE               0
+  #endif
+
+  #if BRIDGE && COPRO
+    #error "BRIDGE and COPRO are both firmware, build one of them"
+  #endif
+
+  #if BRIDGE && HD44780_SINGLE
+    #error "BRIDGE backlight command needs runtime backlight, build without SINGLE"
+  #endif
+
+  #if BRIDGE && (EXPANDER == EXPANDER_GPIO) && EXPANDER_GPIO_USART && \
+      ((EXPANDER_RS < 2) || (EXPANDER_RW < 2) || (EXPANDER_E < 2) || (EXPANDER_BL < 2) || \
+       (EXPANDER_DB4 < 2) || (EXPANDER_DB5 < 2) || (EXPANDER_DB6 < 2) || (EXPANDER_DB7 < 2))
+    #error "BRIDGE receives on PD0, GPIO wiring must leave PD0 / PD1 free, set WIRING"
+  #endif
+
+  // @const baud rate of host, make BAUD=38400
+  //  @8MHz 76800 -> UBRR 12, error 0.2%, 115200 needs 7.3728 MHz crystal
+  #ifndef BRIDGE_BAUD
+    #define BRIDGE_BAUD          76800
+  #endif
+
+  #if BRIDGE && !UART_BAUD_OK(BRIDGE_BAUD)
+    #error "BRIDGE_BAUD more than 2% off at F_CPU, UART_UBRR can not make it"
+  #endif
+  // @const min period of flush in ms, frame rate limit of LCD traffic
+  #ifndef BRIDGE_FLUSH_MS
+    #define BRIDGE_FLUSH_MS      10
+  #endif
+
+  // @const frame
+  #define BRIDGE_SYNC            0xA5
+
+  // @const commands
+  #define BRIDGE_CMD_CELLS       0x01
+  #define BRIDGE_CMD_CURSOR      0x02
+  #define BRIDGE_CMD_GLYPH       0x03
+  #define BRIDGE_CMD_BACKLIGHT   0x04
+
+  // @const control of cursor command, low bits of display control
+  #define BRIDGE_CONTROL_DISPLAY 0x04
+  #define BRIDGE_CONTROL_CURSOR  0x02
+  #define BRIDGE_CONTROL_BLINK   0x01
+
+  // @const cells of image
+  #define BRIDGE_CELLS           (HD44780_ROWS * HD44780_COLS)
+
+  /** @struct screen wanted by host */
+  typedef struct {
+    // character codes, row after row
+    unsigned char text[BRIDGE_CELLS];
+    // 8 characters of 8 rows
+    unsigned char cgram[64];
+    // cursor cell
+    unsigned char cursor;
+    // display, cursor, blink
+    unsigned char control;
+    // 0 off
+    unsigned char backlight;
+  } BRIDGE_Image;
+
+  /** @struct received frames, host readable */
+  typedef struct {
+    // frames applied
+    unsigned int frames;
+    // frames dropped - CRC, unknown command, truncated command
+    unsigned int errors;
+    // bytes lost by receiver, frame dropped too
+    unsigned int overruns;
+  } BRIDGE_Stats;
+
+  /** @var received frames */
+  extern volatile BRIDGE_Stats _bridge_stats;
+
+  /**
+   * @desc    Init images, UART with RX interrupt
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void BRIDGE_Init (void);
+
+  /**
+   * @desc    Draw front image, only cells differing from shadow
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void BRIDGE_Flush (void);
+
+  /**
+   * @desc    Bridge firmware - LCD setup, receiver, flush task
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void Bridge (void);
+
+#endif
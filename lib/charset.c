@@ -0,0 +1,424 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UTF-8 to HD44780 character ROM with CGRAM fallback
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       22.12.2020
+ * @file        charset.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      charset.h, hd44780pcf8574.h
+ * ---------------------------------------------------------------+
+ */
+#include <stddef.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "charset.h"
+
+// compiled only with make UTF8=1
+#if CHARSET_UTF8
+
+#include "hd44780pcf8574.h"
+
+/** @struct CGRAM slot */
+typedef struct {
+  // code point of glyph, 0 if free
+  unsigned int cp;
+  // clock of last use
+  unsigned int stamp;
+} CHARSET_Slot;
+
+#if CHARSET_ROM == CHARSET_ROM_A00
+
+/** @var U+00A0 .. U+00FF in ROM A00, 0 if missing */
+static const unsigned char _charset_latin1[96] PROGMEM = {
+  0x20, 0x00, 0xEC, 0x00, 0x00, 0x5C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xDF, 0x00, 0x00, 0x00, 0x00, 0xE4, 0x00, 0xA5, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0xE1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0xEE, 0x00, 0x00, 0x00, 0x00, 0xEF, 0xFD, 0x00, 0x00, 0x00, 0x00, 0xF5, 0x00, 0x00, 0x00
+};
+
+/** @var other code points in ROM A00, sorted, degree sign drawn by 0xDF */
+static const CHARSET_Map _charset_rom[] PROGMEM = {
+  { 0x03A3, 0xF6 },  // capital letter sigma
+  { 0x03A9, 0xF4 },  // capital letter omega
+  { 0x03B1, 0xE0 },  // small letter alpha
+  { 0x03B2, 0xE2 },  // small letter beta
+  { 0x03B5, 0xE3 },  // small letter epsilon
+  { 0x03B8, 0xF2 },  // small letter theta
+  { 0x03BC, 0xE4 },  // small letter mu
+  { 0x03C0, 0xF7 },  // small letter pi
+  { 0x03C1, 0xE6 },  // small letter rho
+  { 0x03C3, 0xE5 },  // small letter sigma
+  { 0x2126, 0xF4 },  // ohm sign
+  { 0x2190, 0x7F },  // leftwards arrow
+  { 0x2192, 0x7E },  // rightwards arrow
+  { 0x221A, 0xE8 },  // square root
+  { 0x221E, 0xF3 },  // infinity
+  { 0x2588, 0xFF },  // full block
+  { 0x4E07, 0xFB },  // kanji ten thousand
+  { 0x5186, 0xFC },  // kanji yen
+  { 0x5343, 0xFA }   // kanji thousand
+};
+
+#else
+
+/** @var U+00A0 .. U+00FF in ROM A02, 0 if missing */
+static const unsigned char _charset_latin1[96] PROGMEM = {
+  0x20, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0x00, 0xA9, 0xAA, 0xAB, 0x00, 0x00, 0x00, 0x00,
+  0xB0, 0xB1, 0xB2, 0xB3, 0x00, 0xB5, 0xB6, 0xB7, 0x00, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF,
+  0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+  0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
+  0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF,
+  0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+};
+
+/** @var other code points in ROM A02, sorted */
+static const CHARSET_Map _charset_rom[] PROGMEM = {
+  { 0x03BC, 0xB5 }   // drawn as micro sign
+};
+
+#endif
+
+/** @var glyphs of code points missing in ROM, sorted, accent in rows 0 - 1 */
+static const CHARSET_Glyph _charset_glyphs[] PROGMEM = {
+  { 0x00C4, { 0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x11, 0x11, 0x00 } },  // capital letter a with diaeresis
+  { 0x00D6, { 0x0A, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 } },  // capital letter o with diaeresis
+  { 0x00DC, { 0x0A, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00 } },  // capital letter u with diaeresis
+  { 0x00DF, { 0x0C, 0x12, 0x12, 0x14, 0x12, 0x11, 0x16, 0x10 } },  // small letter sharp s
+  { 0x00E0, { 0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },  // small letter a with grave
+  { 0x00E1, { 0x02, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },  // small letter a with acute
+  { 0x00E2, { 0x04, 0x0A, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00 } },  // small letter a with circumflex
+  { 0x00E7, { 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x04, 0x08 } },  // small letter c with cedilla
+  { 0x00E8, { 0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },  // small letter e with grave
+  { 0x00E9, { 0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },  // small letter e with acute
+  { 0x00EA, { 0x04, 0x0A, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },  // small letter e with circumflex
+  { 0x00EB, { 0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },  // small letter e with diaeresis
+  { 0x00ED, { 0x02, 0x04, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 } },  // small letter i with acute
+  { 0x00EE, { 0x04, 0x0A, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00 } },  // small letter i with circumflex
+  { 0x00F3, { 0x02, 0x04, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 } },  // small letter o with acute
+  { 0x00F4, { 0x04, 0x0A, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00 } },  // small letter o with circumflex
+  { 0x00F9, { 0x08, 0x04, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 } },  // small letter u with grave
+  { 0x00FA, { 0x02, 0x04, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 } },  // small letter u with acute
+  { 0x00FB, { 0x04, 0x0A, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00 } },  // small letter u with circumflex
+  { 0x00FD, { 0x02, 0x04, 0x11, 0x11, 0x0F, 0x01, 0x0E, 0x00 } },  // small letter y with acute
+  { 0x010D, { 0x0A, 0x04, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x00 } },  // small letter c with caron
+  { 0x011B, { 0x0A, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00 } },  // small letter e with caron
+  { 0x0148, { 0x0A, 0x04, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00 } },  // small letter n with caron
+  { 0x0159, { 0x0A, 0x04, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00 } },  // small letter r with caron
+  { 0x0161, { 0x0A, 0x04, 0x0E, 0x10, 0x0E, 0x01, 0x1E, 0x00 } },  // small letter s with caron
+  { 0x016F, { 0x04, 0x0A, 0x04, 0x11, 0x11, 0x13, 0x0D, 0x00 } },  // small letter u with ring above
+  { 0x017E, { 0x0A, 0x04, 0x1F, 0x02, 0x04, 0x08, 0x1F, 0x00 } },  // small letter z with caron
+  { 0x03A9, { 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0A, 0x1B, 0x00 } },  // capital letter omega
+  { 0x20AC, { 0x07, 0x08, 0x1E, 0x08, 0x1E, 0x08, 0x07, 0x00 } },  // euro sign
+  { 0x2190, { 0x00, 0x04, 0x08, 0x1F, 0x08, 0x04, 0x00, 0x00 } },  // leftwards arrow
+  { 0x2191, { 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 } },  // upwards arrow
+  { 0x2192, { 0x00, 0x04, 0x02, 0x1F, 0x02, 0x04, 0x00, 0x00 } },  // rightwards arrow
+  { 0x2193, { 0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00 } }   // downwards arrow
+};
+
+/** @var CGRAM slots, index = CGRAM character */
+static CHARSET_Slot _charset_slots[8];
+
+/** @var use clock of slots */
+static unsigned int _charset_clock = 0;
+
+/**
+ * @desc    Binary search of sorted flash table, code point first member
+ *
+ * @param   const void * - table in flash
+ * @param   unsigned char - number of entries
+ * @param   unsigned char - size of entry
+ * @param   unsigned int - code point
+ *
+ * @return  const void * - entry in flash, NULL if missing
+ */
+static const void *CHARSET_Search (const void *table, unsigned char count, unsigned char size, unsigned int cp)
+{
+  const char *entry;
+  unsigned char low = 0;
+  unsigned char high = count;
+  unsigned char mid;
+  unsigned int key;
+
+  // halve till found or empty
+  while (low < high) {
+    mid = (low + high) >> 1;
+    entry = (const char *) table + mid * size;
+    key = pgm_read_word(entry);
+    if (key == cp) {
+      return entry;
+    } else if (key < cp) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @desc    Decode next byte of UTF-8, lead byte drops unfinished sequence
+ *
+ * @param   CHARSET_Stream *
+ * @param   char - byte
+ * @param   unsigned int * - code point, CHARSET_INVALID if malformed,
+ *                           overlong or surrogate
+ *
+ * @return  char - 1 if code point is complete
+ */
+char CHARSET_Decode (CHARSET_Stream *stream, char byte, unsigned int *cp)
+{
+  unsigned char b = (unsigned char) byte;
+
+  // continuation byte 10xxxxxx
+  if ((b & 0xC0) == 0x80) {
+    // no sequence to continue
+    if (stream->left == 0) {
+      *cp = CHARSET_INVALID;
+      return 1;
+    }
+    stream->cp = (stream->cp << 6) | (b & 0x3F);
+    if (--stream->left) {
+      return 0;
+    }
+    // only basic multilingual plane is drawn
+    *cp = (stream->cp > 0xFFFF) ? CHARSET_INVALID : (unsigned int) stream->cp;
+    // overlong form, shorter sequence encodes it (C0 80 would be NUL)
+    if (stream->cp < ((stream->length == 1) ? 0x80UL : (stream->length == 2) ? 0x800UL : 0x10000UL)) {
+      *cp = CHARSET_INVALID;
+    }
+    // UTF-16 surrogate, not a character
+    if ((*cp >= 0xD800) && (*cp <= 0xDFFF)) {
+      *cp = CHARSET_INVALID;
+    }
+    return 1;
+  }
+
+  // lead byte, payload bits and length of sequence
+  stream->left = 0;
+  if (b < 0x80) {
+    *cp = b;
+    return 1;
+  } else if ((b & 0xE0) == 0xC0) {
+    stream->cp = b & 0x1F;
+    stream->left = 1;
+  } else if ((b & 0xF0) == 0xE0) {
+    stream->cp = b & 0x0F;
+    stream->left = 2;
+  } else if ((b & 0xF8) == 0xF0) {
+    stream->cp = b & 0x07;
+    stream->left = 3;
+  } else {
+    *cp = CHARSET_INVALID;
+    return 1;
+  }
+  stream->length = stream->left;
+  return 0;
+}
+
+/**
+ * @desc    Character code of code point in ROM
+ *
+ * @param   unsigned int - code point above ASCII
+ *
+ * @return  unsigned char - 0 if not in ROM
+ */
+unsigned char CHARSET_Rom (unsigned int cp)
+{
+  const CHARSET_Map *map;
+
+  // Latin-1 supplement, one flash read
+  if ((cp >= 0xA0) && (cp <= 0xFF)) {
+    return pgm_read_byte(&_charset_latin1[cp - 0xA0]);
+  }
+#if CHARSET_ROM == CHARSET_ROM_A00
+  // halfwidth katakana, JIS X 0201 order
+  if ((cp >= 0xFF61) && (cp <= 0xFF9F)) {
+    return (unsigned char) (cp - 0xFF61 + 0xA1);
+  }
+#endif
+  // sorted pairs
+  map = CHARSET_Search(_charset_rom, sizeof(_charset_rom) / sizeof(_charset_rom[0]), sizeof(_charset_rom[0]), cp);
+
+  return map ? pgm_read_byte(&map->code) : 0;
+}
+
+/**
+ * @desc    Free or least recently used slot, slots shown in DDRAM mirror
+ *          or pinned by stream are kept
+ *
+ * @param   CHARSET_Stream *
+ *
+ * @return  unsigned char - CGRAM character, 8 if none
+ */
+static unsigned char CHARSET_Evict (CHARSET_Stream *stream)
+{
+  const char *cell = &_hd44780_shadow.ddram[0][0];
+  unsigned char shown = stream->pinned;
+  unsigned char oldest = 8;
+  unsigned char slot;
+  unsigned char i;
+
+  // CGRAM characters on glass, codes 0x00 - 0x0F
+  for (i = 0; i < sizeof(_hd44780_shadow.ddram); i++) {
+    if ((unsigned char) cell[i] < 0x10) {
+      shown |= 1 << (cell[i] & 0x07);
+    }
+  }
+  for (slot = CHARSET_CGRAM_FIRST; slot < 8; slot++) {
+    if (shown & (1 << slot)) {
+      continue;
+    }
+    // free slot first
+    if (_charset_slots[slot].cp == 0) {
+      return slot;
+    }
+    // oldest use, age wraps with clock
+    if ((oldest == 8) || ((unsigned int) (_charset_clock - _charset_slots[slot].stamp) > (unsigned int) (_charset_clock - _charset_slots[oldest].stamp))) {
+      oldest = slot;
+    }
+  }
+  return oldest;
+}
+
+/**
+ * @desc    Upload glyph into CGRAM slot, address counter restored
+ *
+ * @param   char addr
+ * @param   unsigned char - CGRAM character
+ * @param   const CHARSET_Glyph * - glyph in flash
+ *
+ * @return  void
+ */
+static void CHARSET_Upload (char addr, unsigned char slot, const CHARSET_Glyph *glyph)
+{
+  unsigned char ac = _hd44780_shadow.ac;
+  unsigned char i;
+
+  // address counter to come back to
+  if (ac == HD44780_AC_UNKNOWN) {
+    ac = HD44780_PCF8574_ReadStatus(addr) & ~HD44780_BUSY_FLAG;
+  }
+  // 8 rows of character
+  HD44780_PCF8574_SendInstruction(addr, HD44780_CGRAM | (slot << 3));
+  for (i = 0; i < 8; i++) {
+    HD44780_PCF8574_SendData(addr, pgm_read_byte(&glyph->rows[i]));
+  }
+  // back to DDRAM
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ac);
+}
+
+/**
+ * @desc    Character code of code point - ROM, CGRAM glyph uploaded
+ *          if needed, or CHARSET_REPLACEMENT
+ *
+ * @param   char addr
+ * @param   CHARSET_Stream *
+ * @param   unsigned int - code point
+ *
+ * @return  char
+ */
+char CHARSET_Code (char addr, CHARSET_Stream *stream, unsigned int cp)
+{
+  const CHARSET_Glyph *glyph;
+  unsigned char code;
+  unsigned char slot;
+
+  // ASCII
+  if (cp < 0x80) {
+    return (char) cp;
+  }
+  // ROM, no bus traffic
+  if ((code = CHARSET_Rom(cp)) != 0) {
+    return (char) code;
+  }
+  // glyph already in CGRAM
+  for (slot = CHARSET_CGRAM_FIRST; slot < 8; slot++) {
+    if (_charset_slots[slot].cp == cp) {
+      break;
+    }
+  }
+  if (slot == 8) {
+    // glyph and slot for it
+    glyph = CHARSET_Search(_charset_glyphs, sizeof(_charset_glyphs) / sizeof(_charset_glyphs[0]), sizeof(_charset_glyphs[0]), cp);
+    if ((glyph == NULL) || ((slot = CHARSET_Evict(stream)) == 8)) {
+      return CHARSET_REPLACEMENT;
+    }
+    CHARSET_Upload(addr, slot, glyph);
+    _charset_slots[slot].cp = cp;
+  }
+  // recently used, kept till end of string
+  _charset_slots[slot].stamp = ++_charset_clock;
+  stream->pinned |= 1 << slot;
+
+  // alias of CGRAM character, never '\0'
+  return (char) (0x08 | slot);
+}
+
+/**
+ * @desc    Translate UTF-8 into character codes, e.g. for UpdateString
+ *          or Queue, glyphs uploaded now - draw before next translate
+ *
+ * @param   char addr
+ * @param   char * - codes, '\0' terminated
+ * @param   const char * - UTF-8
+ * @param   unsigned char - size of codes buffer
+ *
+ * @return  void
+ */
+void CHARSET_Translate (char addr, char *dst, const char *src, unsigned char size)
+{
+  CHARSET_Stream stream = CHARSET_STREAM_INIT;
+  unsigned int cp;
+  unsigned char i = 0;
+
+  // code per complete code point, room for '\0'
+  while ((*src != '\0') && (i < size - 1)) {
+    if (CHARSET_Decode(&stream, *src++, &cp)) {
+      dst[i++] = CHARSET_Code(addr, &stream, cp);
+    }
+  }
+  dst[i] = '\0';
+}
+
+/**
+ * @desc    Forget CGRAM slots, controller powered up
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void CHARSET_Reset (void)
+{
+  // all free
+  memset(_charset_slots, 0, sizeof(_charset_slots));
+  _charset_clock = 0;
+}
+
+/**
+ * @desc    Upload glyphs of used slots again, controller lost CGRAM
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void CHARSET_Restore (char addr)
+{
+  const CHARSET_Glyph *glyph;
+  unsigned char slot;
+
+  for (slot = CHARSET_CGRAM_FIRST; slot < 8; slot++) {
+    if (_charset_slots[slot].cp != 0) {
+      glyph = CHARSET_Search(_charset_glyphs, sizeof(_charset_glyphs) / sizeof(_charset_glyphs[0]), sizeof(_charset_glyphs[0]), _charset_slots[slot].cp);
+      CHARSET_Upload(addr, slot, glyph);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UTF-8 to HD44780 character ROM with CGRAM fallback
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       22.12.2020
+ * @file        charset.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      hd44780pcf8574.h
+ * ---------------------------------------------------------------+
+ * @usage       make UTF8=1, ROM=A00 (Japanese, default) or ROM=A02
+ *              (European)
+ *
+ *              DrawString decodes UTF-8 byte by byte:
+ *              ASCII          - sent as is, the same as raw path
+ *              U+00A0..U+00FF - one flash read, direct table
+ *              other          - binary search in sorted flash table
+ *              not in ROM     - 5x8 glyph from flash uploaded into free
+ *                               CGRAM slot, least recently used slot
+ *                               not shown in DDRAM mirror is reused
+ *              no glyph/slot  - CHARSET_REPLACEMENT
+ *              Slots are drawn by codes 0x08 - 0x0F, no '\0' in text.
+ */
+
+/** @definition */
+#ifndef __CHARSET_H__
+#define __CHARSET_H__
+
+#include <avr/pgmspace.h>
+
+  // UTF-8 decoding in DrawString, make UTF8=1
+  #ifndef CHARSET_UTF8
+    #define CHARSET_UTF8         0
+  #endif
+
+  // @const character ROM of controller, make ROM=A02
+  #define CHARSET_ROM_A00        0
+  #define CHARSET_ROM_A02        1
+
+  #ifndef CHARSET_ROM
+    #define CHARSET_ROM          CHARSET_ROM_A00
+  #endif
+
+  // @const first CGRAM slot for glyphs, lower slots left to application
+  #ifndef CHARSET_CGRAM_FIRST
+    #define CHARSET_CGRAM_FIRST  0
+  #endif
+  #define CHARSET_SLOTS          (8 - CHARSET_CGRAM_FIRST)
+
+  // @const drawn if neither ROM nor glyph table knows code point
+  #ifndef CHARSET_REPLACEMENT
+    #define CHARSET_REPLACEMENT  '?'
+  #endif
+
+  // @const code point of invalid sequence or beyond U+FFFF
+  #define CHARSET_INVALID        0xFFFD
+
+  /** @struct decoding state of one string */
+  typedef struct {
+    // code point being decoded
+    unsigned long int cp;
+    // continuation bytes still expected
+    unsigned char left;
+    // continuation bytes of whole sequence
+    unsigned char length;
+    // CGRAM slots used by this string, never evicted by it
+    unsigned char pinned;
+  } CHARSET_Stream;
+
+  // empty stream
+  #define CHARSET_STREAM_INIT    { 0, 0, 0, 0 }
+
+  /** @struct code point in ROM */
+  typedef struct {
+    // code point
+    unsigned int cp;
+    // character code of ROM
+    unsigned char code;
+  } CHARSET_Map;
+
+  /** @struct code point drawn by CGRAM */
+  typedef struct {
+    // code point
+    unsigned int cp;
+    // 5x8 rows, bit 4 leftmost
+    uint8_t rows[8];
+  } CHARSET_Glyph;
+
+  /**
+   * @desc    Decode next byte of UTF-8
+   *
+   * @param   CHARSET_Stream *
+   * @param   char - byte
+   * @param   unsigned int * - code point, CHARSET_INVALID if malformed,
+   *                           overlong or surrogate
+   *
+   * @return  char - 1 if code point is complete
+   */
+  char CHARSET_Decode (CHARSET_Stream *, char, unsigned int *);
+
+  /**
+   * @desc    Character code of code point in ROM
+   *
+   * @param   unsigned int - code point above ASCII
+   *
+   * @return  unsigned char - 0 if not in ROM
+   */
+  unsigned char CHARSET_Rom (unsigned int);
+
+  /**
+   * @desc    Character code of code point - ROM, CGRAM glyph uploaded
+   *          if needed, or CHARSET_REPLACEMENT
+   *
+   * @param   char addr
+   * @param   CHARSET_Stream *
+   * @param   unsigned int - code point
+   *
+   * @return  char
+   */
+  char CHARSET_Code (char, CHARSET_Stream *, unsigned int);
+
+  /**
+   * @desc    Translate UTF-8 into character codes, e.g. for UpdateString
+   *          or Queue, glyphs uploaded now - draw before next translate
+   *
+   * @param   char addr
+   * @param   char * - codes, '\0' terminated
+   * @param   const char * - UTF-8
+   * @param   unsigned char - size of codes buffer
+   *
+   * @return  void
+   */
+  void CHARSET_Translate (char, char *, const char *, unsigned char);
+
+  /**
+   * @desc    Forget CGRAM slots, controller powered up
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void CHARSET_Reset (void);
+
+  /**
+   * @desc    Upload glyphs of used slots again, controller lost CGRAM
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void CHARSET_Restore (char);
+
+#endif
@@ -0,0 +1,233 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Display coprocessor - I2C slave with register map
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       20.12.2020
+ * @file        copro.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      copro.h, twi.h, hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ */
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "copro.h"
+
+// compiled only with make COPRO=1
+#if COPRO
+
+#include "twi.h"
+#include "scheduler.h"
+#include "hd44780pcf8574.h"
+
+// @const slave, ACK next byte, interrupt on every bus event
+#define COPRO_TWCR               ((1 << TWEN) | (1 << TWIE) | (1 << TWINT) | (1 << TWEA))
+
+/** @var registers, written by TWI interrupt */
+volatile unsigned char _copro_regs[COPRO_REGS];
+
+/** @var register pointer */
+static volatile unsigned char _copro_pointer = 0;
+
+/** @var bytes received in write transaction, first sets pointer */
+static volatile unsigned char _copro_received = 0;
+
+/** @var registers written by open transaction */
+static volatile unsigned int _copro_pending = 0;
+
+/** @var registers committed by STOP, not on LCD yet */
+static volatile unsigned int _copro_dirty = 0;
+
+/** @var LCD setup task id */
+static char _copro_setup = SCHED_NO_TASK;
+
+/** @var LCD ready flag */
+static volatile char _copro_ready = 0;
+
+/**
+ * @desc    Store register written by master, read only and reserved
+ *          registers ignored
+ *
+ * @param   unsigned char - register
+ * @param   unsigned char - value
+ *
+ * @return  void
+ */
+static void COPRO_Store (unsigned char reg, unsigned char value)
+{
+  // text cell
+  if (reg < COPRO_REG_CURSOR) {
+    _copro_pending |= (reg < COPRO_REG_TEXT + HD44780_COLS) ? HD44780_DIRTY_ROW0 : HD44780_DIRTY_ROW1;
+  // cursor cell or display control
+  } else if ((reg == COPRO_REG_CURSOR) || (reg == COPRO_REG_CONTROL)) {
+    _copro_pending |= HD44780_DIRTY_CURSOR;
+  } else if (reg == COPRO_REG_BACKLIGHT) {
+    _copro_pending |= HD44780_DIRTY_BACKLIGHT;
+  // row of CGRAM character
+  } else if (reg >= COPRO_REG_CGRAM) {
+    _copro_pending |= 1 << ((reg - COPRO_REG_CGRAM) >> 3);
+  } else {
+    return;
+  }
+  _copro_regs[reg] = value;
+}
+
+/**
+ * @desc    Load register read by master
+ *
+ * @param   unsigned char - register
+ *
+ * @return  unsigned char
+ */
+static unsigned char COPRO_Load (unsigned char reg)
+{
+  // state of frame
+  if (reg == COPRO_REG_STATUS) {
+    return ((_copro_pending | _copro_dirty) ? COPRO_STATUS_PENDING : 0) | (_copro_ready ? COPRO_STATUS_READY : 0);
+  }
+  return _copro_regs[reg];
+}
+
+/**
+ * @desc    TWI slave - every bus event of own address
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ISR(TWI_vect)
+{
+  // ACK next byte, bus released
+  unsigned char twcr = COPRO_TWCR;
+
+  switch (TWI_STATUS) {
+    // addressed for write, register pointer comes first
+    case TWI_SR_SLAW_ACK:
+      _copro_received = 0;
+      break;
+    // pointer, then registers
+    case TWI_SR_OA_DATA_ACK:
+      if (_copro_received++ == 0) {
+        _copro_pointer = TWI_TWDR & (COPRO_REGS - 1);
+      } else {
+        COPRO_Store(_copro_pointer, TWI_TWDR);
+        _copro_pointer = (_copro_pointer + 1) & (COPRO_REGS - 1);
+      }
+      break;
+    // addressed for read, master wants next byte
+    case TWI_ST_OA_ACK:
+    case TWI_ST_DATA_ACK:
+      TWI_TWDR = COPRO_Load(_copro_pointer);
+      _copro_pointer = (_copro_pointer + 1) & (COPRO_REGS - 1);
+      break;
+    // STOP or repeated START, frame committed
+    case TWI_SR_STOP_RSTART:
+      _copro_dirty |= _copro_pending;
+      _copro_pending = 0;
+      break;
+    // bus error, STOP only releases lines
+    case 0x00:
+      twcr |= (1 << TWSTO);
+      break;
+    // master NACK ends read
+    default:
+      break;
+  }
+  TWI_TWCR = twcr;
+}
+
+/**
+ * @desc    Init registers, enable TWI slave with interrupt
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void COPRO_Init (void)
+{
+  unsigned char i;
+
+  // blank screen, display on, backlight on
+  for (i = 0; i < COPRO_REGS; i++) {
+    _copro_regs[i] = (i < COPRO_REG_CURSOR) ? ' ' : 0;
+  }
+  _copro_regs[COPRO_REG_CONTROL] = COPRO_CONTROL_DISPLAY;
+  _copro_regs[COPRO_REG_BACKLIGHT] = 1;
+  // own address, no general call
+  TWI_TWAR = COPRO_ADDRESS << 1;
+  // listen
+  TWI_TWCR = (1 << TWEN) | (1 << TWIE) | (1 << TWEA);
+}
+
+/**
+ * @desc    Draw committed registers, only cells differing from shadow
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void COPRO_Flush (void)
+{
+  unsigned int dirty;
+
+  // LCD still in setup
+  if (!_copro_ready) {
+    return;
+  }
+  // committed frame
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    dirty = _copro_dirty;
+    _copro_dirty = 0;
+  }
+  // registers read while drawn, next commit draws them again
+  HD44780_PCF8574_DrawImage(PCF8574_ADDRESS, &_copro_regs[COPRO_REG_TEXT], &_copro_regs[COPRO_REG_CGRAM],
+    _copro_regs[COPRO_REG_CURSOR], _copro_regs[COPRO_REG_CONTROL], _copro_regs[COPRO_REG_BACKLIGHT], dirty);
+}
+
+/**
+ * @desc    Coprocessor task - LCD setup, released every tick till done
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void CoproSetup (void)
+{
+  // setup done, registers written meanwhile drawn with whole map
+  if (HD44780_PCF8574_InitImage(PCF8574_ADDRESS, &_copro_dirty) != PCF8574_PENDING) {
+    // stop polling
+    SCHED_DeleteTask(_copro_setup);
+    _copro_ready = 1;
+  }
+}
+
+/**
+ * @desc    Coprocessor firmware - LCD setup, slave, flush task
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Copro (void)
+{
+  // init scheduler, 1 ms tick, interrupts enabled
+  SCHED_Init();
+  // LCD setup, power on wait runs from now
+  _copro_setup = SCHED_AddTask(CoproSetup, 0, 1);
+  // registers written by master from now, drawn after setup
+  COPRO_Init();
+  // diff flush of committed frames
+  SCHED_AddTask(COPRO_Flush, COPRO_FLUSH_MS, COPRO_FLUSH_MS);
+
+  // infinitive loop
+  while (1) {
+    // run released tasks, idle till next tick, TWI wakes up
+    SCHED_Dispatch();
+  }
+}
+
+#endif
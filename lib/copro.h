@@ -0,0 +1,109 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Display coprocessor - I2C slave with register map
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       20.12.2020
+ * @file        copro.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      twi.h, hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ * @usage       make COPRO=1 EXPANDER=GPIO, or EXPANDER=SWI2C
+ *
+ *              ATmega is slave of main controller at COPRO_ADDRESS,
+ *              TWI pins are taken, LCD hangs on GPIO or software I2C.
+ *              Write: register, data ... Read: data from register set
+ *              by previous write. Pointer increments, wraps at 0x80.
+ *              STOP commits written registers, flush task draws only
+ *              cells differing from shadow of LCD.
+ *
+ *              0x00 - 0x0F  row 0, character codes, 0 - 7 CGRAM
+ *              0x10 - 0x1F  row 1
+ *              0x20         cursor cell 0x00 - 0x1F
+ *              0x21         control - bit 2 display, 1 cursor, 0 blink
+ *              0x22         backlight, 0 off
+ *              0x23         status, read only - COPRO_STATUS_*
+ *              0x40 - 0x7F  CGRAM, 8 characters of 8 rows
+ */
+
+/** @definition */
+#ifndef __COPRO_H__
+#define __COPRO_H__
+
+#include "expander.h"
+
+  // coprocessor firmware, make COPRO=1
+  #ifndef COPRO
+    #define COPRO                0
+  #endif
+
+  #if COPRO && (EXPANDER != EXPANDER_GPIO) && (EXPANDER != EXPANDER_SWI2C)
+    #error "COPRO is TWI slave, LCD needs EXPANDER=GPIO or SWI2C"
+  #endif
+
+  #if COPRO && HD44780_SINGLE
+    #error "COPRO backlight register needs runtime backlight, build without SINGLE"
+  #endif
+
+  // @const own 7 bit address, free of PCF8574 / MCP23008 ranges
+  #ifndef COPRO_ADDRESS
+    #define COPRO_ADDRESS        0x30
+  #endif
+  // @const min period of flush in ms, frame rate limit of LCD traffic
+  #ifndef COPRO_FLUSH_MS
+    #define COPRO_FLUSH_MS       10
+  #endif
+
+  // @const register map
+  #define COPRO_REG_TEXT         0x00
+  #define COPRO_REG_CURSOR       0x20
+  #define COPRO_REG_CONTROL      0x21
+  #define COPRO_REG_BACKLIGHT    0x22
+  #define COPRO_REG_STATUS       0x23
+  #define COPRO_REG_CGRAM        0x40
+  #define COPRO_REGS             0x80
+
+  // @const control register, low bits of display control instruction
+  #define COPRO_CONTROL_DISPLAY  0x04
+  #define COPRO_CONTROL_CURSOR   0x02
+  #define COPRO_CONTROL_BLINK    0x01
+
+  // @const status register
+  #define COPRO_STATUS_PENDING   0x01  // written registers not on LCD yet
+  #define COPRO_STATUS_READY     0x02  // LCD init done
+
+  /** @var registers, written by TWI interrupt */
+  extern volatile unsigned char _copro_regs[COPRO_REGS];
+
+  /**
+   * @desc    Init registers, enable TWI slave with interrupt
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void COPRO_Init (void);
+
+  /**
+   * @desc    Draw committed registers, only cells differing from shadow
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void COPRO_Flush (void);
+
+  /**
+   * @desc    Coprocessor firmware - LCD setup, slave, flush task
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void Copro (void);
+
+#endif
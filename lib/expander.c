@@ -0,0 +1,370 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Port backends of HD44780 - I2C expanders, direct GPIO
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       18.12.2020
+ * @file        expander.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      expander.h, twi.h, swi2c.h, i2cdev.h, hd44780pcf8574.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <util/delay.h>
+#include "twi.h"
+#include "swi2c.h"
+#include "i2cdev.h"
+#include "hd44780pcf8574.h"
+#include "expander.h"
+
+#if EXPANDER == EXPANDER_MCP23008
+/**
+ * @desc    MCP23008 write register
+ *
+ * @param   char addr
+ * @param   char - register
+ * @param   char - value
+ *
+ * @return  void
+ */
+static void EXPANDER_Register (char addr, char reg, char value)
+{
+  TWI_MT_Start();
+  TWI_Transmit_SLAW(HD44780_ADDR(addr));
+  TWI_Transmit_Byte(reg);
+  TWI_Transmit_Byte(value);
+  TWI_Stop();
+}
+#endif
+
+/**
+ * @desc    Init backend - TWI, MCP23008 registers or GPIO directions
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void EXPANDER_Init (char addr)
+{
+#if EXPANDER == EXPANDER_GPIO
+  // E low before pins become outputs
+  EXPANDER_GPIO_PORT = (EXPANDER_GPIO_PORT & (unsigned char) ~EXPANDER_MASK) | EXPANDER_MAP(~PCF8574_PIN_E);
+  // LCD pins outputs
+  EXPANDER_GPIO_DDR |= EXPANDER_MASK;
+#elif EXPANDER == EXPANDER_SWI2C
+  // all lanes released
+  SWI2C_Init();
+#elif EXPANDER == EXPANDER_LINUX
+  // adapter, unless opened by application
+  I2CDEV_Open(I2CDEV_PATH);
+#else
+  // Init TWI
+  TWI_Init();
+#endif
+#if EXPANDER == EXPANDER_MCP23008
+  // address pointer stays at OLAT, port byte per TWI byte
+  EXPANDER_Register(addr, MCP23008_IOCON, MCP23008_SEQOP);
+  // E low before pins become outputs
+  EXPANDER_Register(addr, MCP23008_OLAT, EXPANDER_MAP(~PCF8574_PIN_E));
+  // all outputs
+  EXPANDER_Register(addr, MCP23008_IODIR, 0x00);
+#endif
+  // unused with PCF8574, GPIO
+  (void) addr;
+}
+
+/**
+ * @desc    Open port for writes - START, SLAW, register
+ *
+ * @param   char addr - none with SINGLE, EXPANDER_ADDRESS
+ *
+ * @return  void
+ */
+#if HD44780_SINGLE
+void EXPANDER_Start_Single (void)
+#else
+void EXPANDER_Start (char addr)
+#endif
+{
+#if EXPANDER == EXPANDER_SWI2C
+  // the same address on every lane
+  SWI2C_Start();
+  SWI2C_WriteAll((HD44780_ADDR(addr) << 1) | TWI_WRITE);
+#elif EXPANDER == EXPANDER_LINUX
+  // address of ioctl message
+  I2CDEV_Start(HD44780_ADDR(addr));
+#elif EXPANDER != EXPANDER_GPIO
+  // TWI: start
+  TWI_MT_Start();
+  // TWI: send SLAW
+  TWI_Transmit_SLAW(HD44780_ADDR(addr));
+#endif
+#if EXPANDER == EXPANDER_MCP23008
+  // output latch, SEQOP keeps pointer there
+  TWI_Transmit_Byte(MCP23008_OLAT);
+#endif
+#if !HD44780_SINGLE
+  // unused with GPIO
+  (void) addr;
+#endif
+}
+
+/**
+ * @desc    Write port byte in driver layout
+ *
+ * @param   char
+ *
+ * @return  void
+ */
+void EXPANDER_Write (char data)
+{
+#if EXPANDER == EXPANDER_GPIO
+  // other pins of port kept
+  EXPANDER_GPIO_PORT = (EXPANDER_GPIO_PORT & (unsigned char) ~EXPANDER_MASK) | EXPANDER_MAP(data);
+#elif EXPANDER == EXPANDER_SWI2C
+  // the same byte on every lane
+  SWI2C_WriteAll(EXPANDER_MAP(data));
+#elif EXPANDER == EXPANDER_LINUX
+  // buffered till STOP
+  I2CDEV_Write(EXPANDER_MAP(data));
+#else
+  // one TWI byte per port write
+  TWI_Transmit_Byte(EXPANDER_MAP(data));
+#endif
+}
+
+/**
+ * @desc    Write one port byte per lane in driver layout, lockstep
+ *
+ * @param   const char * - EXPANDER_LANES bytes
+ *
+ * @return  void
+ */
+void EXPANDER_WriteLanes (const char *data)
+{
+#if EXPANDER == EXPANDER_SWI2C
+  unsigned char bytes[EXPANDER_LANES];
+  unsigned char lane;
+
+  // wired pins of every lane
+  for (lane = 0; lane < EXPANDER_LANES; lane++) {
+    bytes[lane] = EXPANDER_MAP(data[lane]);
+  }
+  // one bus time for all lanes
+  SWI2C_Write(bytes);
+#else
+  // single display
+  EXPANDER_Write(data[0]);
+#endif
+}
+
+/**
+ * @desc    Hold closed transactions to send them at once, nested
+ *
+ * @param   char - 1 hold, 0 release
+ *
+ * @return  void
+ */
+void EXPANDER_Hold (char hold)
+{
+#if EXPANDER == EXPANDER_LINUX
+  // one ioctl for whole string
+  I2CDEV_Hold(hold);
+#endif
+  // every transaction goes out at once elsewhere
+  (void) hold;
+}
+
+/**
+ * @desc    Close port - STOP
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void EXPANDER_Stop (void)
+{
+#if EXPANDER == EXPANDER_SWI2C
+  // all lanes
+  SWI2C_Stop();
+#elif EXPANDER == EXPANDER_LINUX
+  // one ioctl, unless held
+  I2CDEV_Stop();
+#elif EXPANDER != EXPANDER_GPIO
+  // TWI Stop
+  TWI_Stop();
+#endif
+}
+
+/**
+ * @desc    Transaction cut since last call, port bytes lost on the way
+ *
+ * @param   void
+ *
+ * @return  char - 1 cut, flag cleared
+ */
+char EXPANDER_Dropped (void)
+{
+#if (EXPANDER == EXPANDER_PCF8574) || (EXPANDER == EXPANDER_PCF8574A) || (EXPANDER == EXPANDER_MCP23008)
+  // arbitration lost to other master
+  return TWI_Dropped();
+#else
+  // no other master
+  return 0;
+#endif
+}
+
+/**
+ * @desc    Read port in driver layout, own transaction, lane 0
+ *
+ * @param   char addr
+ *
+ * @return  char
+ */
+char EXPANDER_Read (char addr)
+{
+  unsigned char data;
+#if EXPANDER == EXPANDER_SWI2C
+  unsigned char bytes[EXPANDER_LANES];
+#endif
+
+#if EXPANDER == EXPANDER_GPIO
+  // data valid tDDR 160 ns after E rise
+  _delay_us(0.5);
+  data = EXPANDER_GPIO_PIN;
+#elif EXPANDER == EXPANDER_MCP23008
+  char reg = MCP23008_GPIO;
+  // port register, repeated start
+  TWI_Segment segment[2] = {
+    { HD44780_ADDR(addr), TWI_WRITE, &reg, 1 },
+    { HD44780_ADDR(addr), TWI_READ, (char *) &data, 1 }
+  };
+  TWI_Transfer(segment, 2);
+#elif EXPANDER == EXPANDER_SWI2C
+  // lanes run the same instructions, lane 0 answers for all
+  SWI2C_Start();
+  SWI2C_WriteAll((HD44780_ADDR(addr) << 1) | TWI_READ);
+  SWI2C_Read(bytes);
+  SWI2C_Stop();
+  data = bytes[0];
+#elif EXPANDER == EXPANDER_LINUX
+  // pending writes go first
+  I2CDEV_Read(HD44780_ADDR(addr), &data);
+#else
+  // read expander port
+  TWI_MT_Start();
+  TWI_Transmit_SLAR(HD44780_ADDR(addr));
+  data = TWI_Receive_Byte();
+  TWI_Stop();
+#endif
+  // unused with GPIO
+  (void) addr;
+
+  // driver layout
+  return EXPANDER_UNMAP(data);
+}
+
+/**
+ * @desc    Read byte of controller in 4 bit mode - RS, RW setup, then
+ *          two cycles of E up, port read, E down. I2C expanders do it
+ *          in one transaction joined by repeated START
+ *
+ * @param   char addr
+ * @param   char - control byte, DB7 - DB4 released, RW set
+ *
+ * @return  char - DB7 - DB4 of first and second read
+ */
+char EXPANDER_ReadNibbles (char addr, char control)
+{
+  char first;
+  char second;
+#if (EXPANDER == EXPANDER_PCF8574) || (EXPANDER == EXPANDER_PCF8574A)
+  // setup or E down, then E up
+  char up[2] = { EXPANDER_MAP(control), EXPANDER_MAP(control | PCF8574_PIN_E) };
+  char down = EXPANDER_MAP(control);
+  // no STOP between E up and E down, port read while E high
+  TWI_Segment segment[5] = {
+    { HD44780_ADDR(addr), TWI_WRITE, up, 2 },
+    { HD44780_ADDR(addr), TWI_READ, &first, 1 },
+    { HD44780_ADDR(addr), TWI_WRITE, up, 2 },
+    { HD44780_ADDR(addr), TWI_READ, &second, 1 },
+    { HD44780_ADDR(addr), TWI_WRITE, &down, 1 }
+  };
+  TWI_Transfer(segment, 5);
+  first = EXPANDER_UNMAP(first);
+  second = EXPANDER_UNMAP(second);
+#elif EXPANDER == EXPANDER_MCP23008
+  // OLAT written twice in a row, SEQOP keeps pointer
+  char up[3] = { MCP23008_OLAT, EXPANDER_MAP(control), EXPANDER_MAP(control | PCF8574_PIN_E) };
+  char down[2] = { MCP23008_OLAT, EXPANDER_MAP(control) };
+  char reg = MCP23008_GPIO;
+  // port register pointed before every read
+  TWI_Segment segment[7] = {
+    { HD44780_ADDR(addr), TWI_WRITE, up, 3 },
+    { HD44780_ADDR(addr), TWI_WRITE, &reg, 1 },
+    { HD44780_ADDR(addr), TWI_READ, &first, 1 },
+    { HD44780_ADDR(addr), TWI_WRITE, up, 3 },
+    { HD44780_ADDR(addr), TWI_WRITE, &reg, 1 },
+    { HD44780_ADDR(addr), TWI_READ, &second, 1 },
+    { HD44780_ADDR(addr), TWI_WRITE, down, 2 }
+  };
+  TWI_Transfer(segment, 7);
+  first = EXPANDER_UNMAP(first);
+  second = EXPANDER_UNMAP(second);
+#else
+  // RS, RW setup before E, tAS
+  EXPANDER_Start(addr);
+  EXPANDER_Write(control);
+  EXPANDER_Stop();
+  // E up, data valid after tDDR, E down
+  EXPANDER_Start(addr);
+  EXPANDER_Write(control | PCF8574_PIN_E);
+  EXPANDER_Stop();
+  first = EXPANDER_Read(addr);
+  EXPANDER_Start(addr);
+  EXPANDER_Write(control);
+  EXPANDER_Stop();
+  // lower nibble
+  EXPANDER_Start(addr);
+  EXPANDER_Write(control | PCF8574_PIN_E);
+  EXPANDER_Stop();
+  second = EXPANDER_Read(addr);
+  EXPANDER_Start(addr);
+  EXPANDER_Write(control);
+  EXPANDER_Stop();
+#endif
+
+  // DB7 - DB4 of both reads
+  return (first & 0xF0) | ((second >> 4) & 0x0F);
+}
+
+/**
+ * @desc    Data lines direction, no-op on quasi bidirectional PCF8574
+ *
+ * @param   char addr
+ * @param   char - 1 input, 0 output
+ *
+ * @return  void
+ */
+void EXPANDER_Release (char addr, char input)
+{
+#if EXPANDER == EXPANDER_GPIO
+  // pull ups of inputs stay on, written 1 in port
+  if (input) {
+    EXPANDER_GPIO_DDR &= (unsigned char) ~EXPANDER_MASK_DB;
+  } else {
+    EXPANDER_GPIO_DDR |= EXPANDER_MASK_DB;
+  }
+#elif EXPANDER == EXPANDER_MCP23008
+  // data lines input
+  EXPANDER_Register(addr, MCP23008_IODIR, input ? EXPANDER_MASK_DB : 0x00);
+#endif
+  // unused with PCF8574
+  (void) addr;
+  (void) input;
+}
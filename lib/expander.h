@@ -0,0 +1,264 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Port backends of HD44780 - I2C expanders, direct GPIO
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       18.12.2020
+ * @file        expander.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      twi.h, swi2c.h, i2cdev.h
+ * ---------------------------------------------------------------+
+ * @usage       make EXPANDER=PCF8574A, see README
+ *
+ *              Driver composes port byte in PCF8574 backpack layout
+ *              DB7 DB6 DB5 DB4 BL E RW RS (PCF8574_PIN_*). Backend
+ *              moves bits to wired pins and writes byte to port:
+ *
+ *              PCF8574, PCF8574A - one I2C byte per port write
+ *              MCP23008          - OLAT register once per transaction,
+ *                                  then sequential writes with SEQOP
+ *              GPIO              - 8 bit port of MCU, no I2C at all
+ *              SWI2C             - PCF8574 on every lane of software
+ *                                  I2C, all lanes in lockstep
+ *              LINUX             - PCF8574 behind /dev/i2c-N, START..STOP
+ *                                  sequence in one ioctl
+ */
+
+/** @definition */
+#ifndef __EXPANDER_H__
+#define __EXPANDER_H__
+
+#include <avr/io.h>
+#include "swi2c.h"
+
+  // @const backends
+  #define EXPANDER_PCF8574       0
+  #define EXPANDER_PCF8574A      1
+  #define EXPANDER_MCP23008      2
+  #define EXPANDER_GPIO          3
+  #define EXPANDER_SWI2C         4
+  #define EXPANDER_LINUX         5
+
+  // backend, make EXPANDER=MCP23008
+  #ifndef EXPANDER
+    #define EXPANDER             EXPANDER_PCF8574
+  #endif
+
+  // @const default 7 bit address, A2 A1 A0 high on PCF backpacks
+  #ifndef EXPANDER_ADDRESS
+    #if EXPANDER == EXPANDER_PCF8574A
+      // 0x38 - 0x3F
+      #define EXPANDER_ADDRESS   0x3F
+    #elif EXPANDER == EXPANDER_MCP23008
+      // 0x20 - 0x27, A2 A1 A0 low on MCP backpacks
+      #define EXPANDER_ADDRESS   0x20
+    #else
+      // 0x20 - 0x27
+      #define EXPANDER_ADDRESS   0x27
+    #endif
+  #endif
+
+  // @const displays driven at once, one per lane
+  #if EXPANDER == EXPANDER_SWI2C
+    #define EXPANDER_LANES       SWI2C_LANES
+  #else
+    #define EXPANDER_LANES       1
+  #endif
+
+  // @const wiring, port bit of every LCD signal, 8 = not wired
+  //  default is common PCF8574 backpack, DB4 - DB7 at P4 - P7
+  #ifndef EXPANDER_RS
+    #define EXPANDER_RS          0
+  #endif
+  #ifndef EXPANDER_RW
+    #define EXPANDER_RW          1
+  #endif
+  #ifndef EXPANDER_E
+    #define EXPANDER_E           2
+  #endif
+  #ifndef EXPANDER_BL
+    #define EXPANDER_BL          3
+  #endif
+  #ifndef EXPANDER_DB4
+    #define EXPANDER_DB4         4
+  #endif
+  #ifndef EXPANDER_DB5
+    #define EXPANDER_DB5         5
+  #endif
+  #ifndef EXPANDER_DB6
+    #define EXPANDER_DB6         6
+  #endif
+  #ifndef EXPANDER_DB7
+    #define EXPANDER_DB7         7
+  #endif
+
+  // @const wiring equals driver layout, no bit moves
+  #define EXPANDER_IDENTITY      ((EXPANDER_RS == 0) && (EXPANDER_RW == 1) && (EXPANDER_E == 2) && (EXPANDER_BL == 3) && \
+                                  (EXPANDER_DB4 == 4) && (EXPANDER_DB5 == 5) && (EXPANDER_DB6 == 6) && (EXPANDER_DB7 == 7))
+
+  // @const port pins are push-pull, data lines must be switched to input for read
+  #define EXPANDER_PUSH_PULL     ((EXPANDER == EXPANDER_MCP23008) || (EXPANDER == EXPANDER_GPIO))
+
+  // @const port write takes shorter than execution time of HD44780
+  #define EXPANDER_FAST          (EXPANDER == EXPANDER_GPIO)
+
+  // @const MCP23008 registers
+  #define MCP23008_IODIR         0x00
+  #define MCP23008_IOCON         0x05
+  #define MCP23008_GPIO          0x09
+  #define MCP23008_OLAT          0x0A
+  // @const IOCON - address pointer does not increment
+  #define MCP23008_SEQOP         0x20
+
+  // @const MCU port of GPIO backend
+  #ifndef EXPANDER_GPIO_PORT
+    #define EXPANDER_GPIO_PORT   PORTD
+    #define EXPANDER_GPIO_DDR    DDRD
+    #define EXPANDER_GPIO_PIN    PIND
+    // PD0 / PD1 are RXD / TXD of USART
+    #define EXPANDER_GPIO_USART  1
+  #endif
+  #ifndef EXPANDER_GPIO_USART
+    #define EXPANDER_GPIO_USART  0
+  #endif
+
+  // move one bit
+  #define EXPANDER_BIT(BYTE, FROM, TO)  (((((unsigned char) (BYTE)) >> (FROM)) & 0x01) << (TO))
+
+  // driver layout -> wired pins, constant for constant argument
+  #define EXPANDER_MAP(BYTE)     ((unsigned char) ( \
+    EXPANDER_BIT(BYTE, 0, EXPANDER_RS)  | EXPANDER_BIT(BYTE, 1, EXPANDER_RW)  | \
+    EXPANDER_BIT(BYTE, 2, EXPANDER_E)   | EXPANDER_BIT(BYTE, 3, EXPANDER_BL)  | \
+    EXPANDER_BIT(BYTE, 4, EXPANDER_DB4) | EXPANDER_BIT(BYTE, 5, EXPANDER_DB5) | \
+    EXPANDER_BIT(BYTE, 6, EXPANDER_DB6) | EXPANDER_BIT(BYTE, 7, EXPANDER_DB7)))
+
+  // wired pins -> driver layout, not wired signals read 0
+  #define EXPANDER_UNMAP(BYTE)   ((unsigned char) ( \
+    EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_RS, 0)  | EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_RW, 1)  | \
+    EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_E, 2)   | EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_BL, 3)  | \
+    EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_DB4, 4) | EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_DB5, 5) | \
+    EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_DB6, 6) | EXPANDER_BIT((unsigned int) (BYTE), EXPANDER_DB7, 7)))
+
+  // @const pins used by LCD, other pins of GPIO port are kept
+  #define EXPANDER_MASK          EXPANDER_MAP(0xFF)
+  // @const data lines DB7 - DB4
+  #define EXPANDER_MASK_DB       EXPANDER_MAP(0xF0)
+
+  /**
+   * @desc    Init backend - TWI, MCP23008 registers or GPIO directions
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void EXPANDER_Init (char);
+
+  // one display at EXPANDER_ADDRESS, make SINGLE=1
+  #ifndef HD44780_SINGLE
+    #define HD44780_SINGLE       0
+  #endif
+
+  #if HD44780_SINGLE
+  /**
+   * @desc    Open port for writes - START, SLAW of EXPANDER_ADDRESS, register
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void EXPANDER_Start_Single (void);
+
+  // address argument dropped at compile time
+  #define EXPANDER_Start(ADDR)   EXPANDER_Start_Single()
+  #else
+  /**
+   * @desc    Open port for writes - START, SLAW, register
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void EXPANDER_Start (char);
+  #endif
+
+  /**
+   * @desc    Write port byte in driver layout
+   *
+   * @param   char
+   *
+   * @return  void
+   */
+  void EXPANDER_Write (char);
+
+  /**
+   * @desc    Write one port byte per lane in driver layout, lockstep
+   *
+   * @param   const char * - EXPANDER_LANES bytes
+   *
+   * @return  void
+   */
+  void EXPANDER_WriteLanes (const char *);
+
+  /**
+   * @desc    Hold closed transactions to send them at once, nested
+   *
+   * @param   char - 1 hold, 0 release
+   *
+   * @return  void
+   */
+  void EXPANDER_Hold (char);
+
+  /**
+   * @desc    Close port - STOP
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void EXPANDER_Stop (void);
+
+  /**
+   * @desc    Transaction cut since last call, port bytes lost on the way
+   *
+   * @param   void
+   *
+   * @return  char - 1 cut, flag cleared
+   */
+  char EXPANDER_Dropped (void);
+
+  /**
+   * @desc    Read port in driver layout, own transaction, lane 0
+   *
+   * @param   char addr
+   *
+   * @return  char
+   */
+  char EXPANDER_Read (char);
+
+  /**
+   * @desc    Read byte of controller in 4 bit mode - RS, RW setup, then
+   *          two cycles of E up, port read, E down. I2C expanders do it
+   *          in one transaction joined by repeated START
+   *
+   * @param   char addr
+   * @param   char - control byte, DB7 - DB4 released, RW set
+   *
+   * @return  char - DB7 - DB4 of first and second read
+   */
+  char EXPANDER_ReadNibbles (char, char);
+
+  /**
+   * @desc    Data lines direction, no-op on quasi bidirectional PCF8574
+   *
+   * @param   char addr
+   * @param   char - 1 input, 0 output
+   *
+   * @return  void
+   */
+  void EXPANDER_Release (char, char);
+
+#endif
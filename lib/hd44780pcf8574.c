@@ -10,17 +10,158 @@
  * @file        hd44780pcf8574.c
  * @tested      AVR Atmega328p
  *
- * @depend      twi, pcf8574
+ * @depend      expander, pt, prof, idle, charset
  * ---------------------------------------------------------------+
  */
 
 // include libraries
 #include <stdio.h>
+#include <string.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 #include <avr/io.h>
-#include "twi.h"
+#include "prof.h"
+#include "idle.h"
+#include "charset.h"
+#include "expander.h"
 #include "hd44780pcf8574.h"
 
+#if HD44780_STATS
+/* @var hot path counters */
+HD44780_PCF8574_Stats _hd44780_stats;
+#endif
+
+/** @var shadow of controller registers, kept over watchdog reset */
+HD44780_PCF8574_Shadow _hd44780_shadow __attribute__ ((section (".noinit")));
+
+/** @var queued writes, bulk and alarm lane */
+static HD44780_PCF8574_Lane _hd44780_queue[HD44780_QUEUE_LANES];
+
+/** @var address counter before alarm, HD44780_RESUME_NONE if no alarm drawn */
+static unsigned char _hd44780_resume = HD44780_RESUME_NONE;
+
+/**
+ * @desc    Next DDRAM address in 2 line mode
+ *          0x00 .. 0x27 -> 0x40 .. 0x67 -> 0x00
+ *
+ * @param   unsigned char - address counter
+ * @param   char - 1 increment, 0 decrement
+ *
+ * @return  unsigned char
+ */
+static unsigned char HD44780_PCF8574_NextAC (unsigned char ac, char increment)
+{
+  // unknown stays unknown
+  if (ac == HD44780_AC_UNKNOWN) {
+    return ac;
+  }
+  // increment
+  if (increment) {
+    // end of line -> start of other line
+    if (ac == (HD44780_ROW1_START + HD44780_LINE_LENGTH - 1)) {
+      return HD44780_ROW2_START;
+    } else if (ac == (HD44780_ROW2_START + HD44780_LINE_LENGTH - 1)) {
+      return HD44780_ROW1_START;
+    }
+    return ac + 1;
+  }
+  // decrement, start of line -> end of other line
+  if (ac == HD44780_ROW1_START) {
+    return HD44780_ROW2_START + HD44780_LINE_LENGTH - 1;
+  } else if (ac == HD44780_ROW2_START) {
+    return HD44780_ROW1_START + HD44780_LINE_LENGTH - 1;
+  }
+  return ac - 1;
+}
+
+/**
+ * @desc    Update shadow by sent instruction or data
+ *
+ * @param   char - instruction or data
+ * @param   char - annex, PCF8574_PIN_RS set for data
+ *
+ * @return  void
+ */
+static void HD44780_PCF8574_Track (char data, char annex)
+{
+  HD44780_PCF8574_Shadow *sh = &_hd44780_shadow;
+  unsigned char instr = (unsigned char) data;
+
+  // count by kind
+  if (annex & PCF8574_PIN_RS) {
+    HD44780_STATS_INC(data);
+  } else {
+    HD44780_STATS_INC(instructions);
+  }
+
+  // data write moves address counter by entry mode
+  if (annex & PCF8574_PIN_RS) {
+    // mirror of DDRAM
+    if (sh->ac != HD44780_AC_UNKNOWN) {
+      sh->ddram[sh->ac >= HD44780_ROW2_START][sh->ac & ~HD44780_ROW2_START] = data;
+    }
+    sh->ac = HD44780_PCF8574_NextAC(sh->ac, sh->entry & HD44780_ENTRY_ID);
+  // set DDRAM address
+  } else if (instr & HD44780_POSITION) {
+    // address outside line, controller behaviour not known
+    sh->ac = HD44780_DDRAM_VALID(instr & ~HD44780_POSITION) ? (instr & ~HD44780_POSITION) : HD44780_AC_UNKNOWN;
+  // set CGRAM address, DDRAM address is lost
+  } else if (instr & HD44780_CGRAM) {
+    sh->ac = HD44780_AC_UNKNOWN;
+  // function set, no DDRAM effect
+  } else if (instr & HD44780_4BIT_MODE) {
+  // cursor / display shift
+  } else if (instr & HD44780_SHIFT) {
+    // display shift
+    if (instr & HD44780_DISPLAY) {
+      // left shift moves viewport right
+      sh->shift = (instr & HD44780_RIGHT) ?
+        (sh->shift + HD44780_LINE_LENGTH - 1) % HD44780_LINE_LENGTH :
+        (sh->shift + 1) % HD44780_LINE_LENGTH;
+    // cursor shift
+    } else {
+      sh->ac = HD44780_PCF8574_NextAC(sh->ac, instr & HD44780_RIGHT);
+    }
+  // display control
+  } else if (instr & HD44780_DISP_OFF) {
+    sh->control = instr;
+  // entry mode
+  } else if (instr & HD44780_ENTRY_SET) {
+    sh->entry = instr;
+  // return home, display clear
+  } else if (instr & (HD44780_RETURN_HOME | HD44780_DISP_CLEAR)) {
+    sh->ac = 0;
+    sh->shift = 0;
+    // clear sets increment mode and fills DDRAM with spaces
+    if (instr == HD44780_DISP_CLEAR) {
+      sh->entry |= HD44780_ENTRY_ID;
+      memset(sh->ddram, ' ', sizeof(sh->ddram));
+    }
+  }
+}
+
+/**
+ * @desc    Reset shadow before cold init
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void HD44780_PCF8574_ShadowReset (void)
+{
+  // not valid till init is done
+  _hd44780_shadow.magic = 0;
+  _hd44780_shadow.ac = HD44780_AC_UNKNOWN;
+  _hd44780_shadow.shift = 0;
+  _hd44780_shadow.entry = HD44780_ENTRY_MODE;
+  _hd44780_shadow.control = HD44780_DISP_OFF;
+  _hd44780_shadow.backlight = HD44780_BACKLIGHT_ON;
+#if CHARSET_UTF8
+  // CGRAM random after power up
+  CHARSET_Reset();
+#endif
+}
+
 // +---------------------------+
 // |         Power on          |
 // | Wait for more than 15 ms  |   // 15 ms wait
@@ -81,47 +222,52 @@
  */
 char HD44780_PCF8574_Init (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_INIT);
+  // shadow not valid
+  HD44780_PCF8574_ShadowReset();
+
   // delay > 15ms
-  _delay_ms(16);
+  IDLE_DELAY_MS(16);
 
   // Init TWI
-  TWI_Init();
+  EXPANDER_Init(addr);
 
-  // TWI: start
+  // TWI: start, send SLAW
   // -------------------------
-  TWI_MT_Start();
+  EXPANDER_Start(addr);
 
-  // TWI: send SLAW
-  // -------------------------
-  TWI_Transmit_SLAW(addr);
+  // PCF8574 powers on with all pins high, E down first,
+  // RS and RW are held after E fall (tAH)
+  EXPANDER_Write(~PCF8574_PIN_E);
 
   // DB7 BD6 DB5 DB4 P3 E RW RS 
   // DB4=1, DB5=1 / BF cannot be checked in these instructions
   // ---------------------------------------------------------------------
   HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
   // delay > 4.1ms
-  _delay_ms(5);
+  IDLE_DELAY_MS(5);
 
   // DB4=1, DB5=1 / BF cannot be checked in these instructions
   // ---------------------------------------------------------------------
   HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
   // delay > 100us
-  _delay_us(110);
+  IDLE_DELAY_US(110);
 
   // DB4=1, DB5=1 / BF cannot be checked in these instructions
   // ---------------------------------------------------------------------
   HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
   // delay > 45us (=37+4 * 270/250)
-  _delay_us(50);
+  IDLE_DELAY_US(50);
 
   // DB5=1 / 4 bit mode 0x20 / BF cannot be checked in these instructions
   // ----------------------------------------------------------------------
   HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB5);
   // delay > 45us (=37+4 * 270/250)
-  _delay_us(50);
+  IDLE_DELAY_US(50);
 
   // TWI Stop
-  TWI_Stop();
+  EXPANDER_Stop();
 
   // 4 bit mode, 2 rows, font 5x8
   HD44780_PCF8574_SendInstruction(addr, HD44780_4BIT_MODE | HD44780_2_ROWS | HD44780_FONT_5x8);
@@ -131,10 +277,154 @@ char HD44780_PCF8574_Init (char addr)
 
   // display clear 0x01 - send 8 bits in 4 bit mode
   HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_CLEAR);
+  // delay > 1.52ms
+  IDLE_DELAY_MS(HD44780_CLEAR_MS);
 
   // entry mode set 0x06 - send 8 bits in 4 bit mode
   HD44780_PCF8574_SendInstruction(addr, HD44780_ENTRY_MODE);
 
+  // shadow valid, warm init possible
+  _hd44780_shadow.magic = HD44780_SHADOW_MAGIC;
+
+  // return success
+  return PCF8574_SUCCESS;
+}
+
+/** @var next DDRAM cell to scrub */
+static unsigned char _hd44780_scrub = 0;
+
+/** @var state of resumable init */
+static PT_Thread _hd44780_pt_init;
+
+/** @var state of resumable display clear */
+static PT_Thread _hd44780_pt_clear;
+
+/**
+ * @desc    LCD init - resumable, call till it stops returning PCF8574_PENDING
+ *          Same sequence as HD44780_PCF8574_Init, waits >= 1 ms yield
+ *          to the caller, the shorter ones are busy waits. Blocking
+ *          HD44780_PCF8574_Init if scheduler tick is not running
+ *
+ * @param   char
+ *
+ * @return  char
+ */
+char HD44780_PCF8574_InitAsync (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_INIT_ASYNC);
+  PT_Thread *pt = &_hd44780_pt_init;
+
+  // no ms tick, waits would never end - blocking init instead
+  if (!SCHED_Running()) {
+    pt->lc = 0;
+    return HD44780_PCF8574_Init(addr);
+  }
+
+  PT_BEGIN(pt);
+
+  // shadow not valid
+  HD44780_PCF8574_ShadowReset();
+
+  // delay > 15ms after power on, elapsed from first call so wrap of
+  // SCHED_Millis is harmless, setup done after first call overlaps
+  PT_WAIT_MS(pt, HD44780_POWER_ON_MS);
+
+  // Init TWI
+  EXPANDER_Init(addr);
+
+  // DB4=1, DB5=1 / BF cannot be checked in these instructions
+  // ---------------------------------------------------------------------
+  EXPANDER_Start(addr);
+  // PCF8574 powers on with all pins high, E down first (tAH)
+  EXPANDER_Write(~PCF8574_PIN_E);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  EXPANDER_Stop();
+  // delay > 4.1ms
+  PT_WAIT_MS(pt, HD44780_INIT_MS);
+
+  // DB4=1, DB5=1 / BF cannot be checked in these instructions
+  // ---------------------------------------------------------------------
+  EXPANDER_Start(addr);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  // delay > 100us
+  IDLE_DELAY_US(HD44780_INIT_US);
+
+  // DB4=1, DB5=1 / BF cannot be checked in these instructions
+  // ---------------------------------------------------------------------
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  // delay > 45us (=37+4 * 270/250)
+  IDLE_DELAY_US(HD44780_EXEC_US);
+
+  // DB5=1 / 4 bit mode 0x20 / BF cannot be checked in these instructions
+  // ----------------------------------------------------------------------
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB5);
+  // delay > 45us (=37+4 * 270/250)
+  IDLE_DELAY_US(HD44780_EXEC_US);
+  EXPANDER_Stop();
+
+  // 4 bit mode, 2 rows, font 5x8
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, HD44780_4BIT_MODE | HD44780_2_ROWS | HD44780_FONT_5x8, HD44780_BACKLIGHT_PIN);
+  IDLE_DELAY_US(HD44780_EXEC_US);
+
+  // display off 0x08 - send 8 bits in 4 bit mode
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, HD44780_DISP_OFF, HD44780_BACKLIGHT_PIN);
+  IDLE_DELAY_US(HD44780_EXEC_US);
+
+  // display clear 0x01 - send 8 bits in 4 bit mode
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, HD44780_DISP_CLEAR, HD44780_BACKLIGHT_PIN);
+  // delay > 1.52ms
+  PT_WAIT_MS(pt, HD44780_CLEAR_MS);
+
+  // entry mode set 0x06 - send 8 bits in 4 bit mode
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, HD44780_ENTRY_MODE, HD44780_BACKLIGHT_PIN);
+  IDLE_DELAY_US(HD44780_EXEC_US);
+
+  // shadow valid, warm init possible
+  _hd44780_shadow.magic = HD44780_SHADOW_MAGIC;
+
+  PT_END(pt);
+}
+
+/**
+ * @desc    LCD warm init - after MCU reset while LCD kept power
+ *          Shadow survived in .noinit, 4 bit sync is verified by reading
+ *          address counter, only function set and control registers are
+ *          sent, DDRAM is kept
+ *
+ * @param   char
+ *
+ * @return  char - PCF8574_ERROR if cold init is needed
+ */
+char HD44780_PCF8574_InitWarm (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_INIT_WARM);
+  unsigned char ac = _hd44780_shadow.ac;
+
+  // shadow lost, e.g. power on reset
+  if (_hd44780_shadow.magic != HD44780_SHADOW_MAGIC) {
+    return PCF8574_ERROR;
+  }
+
+  // Init TWI
+  EXPANDER_Init(addr);
+
+  // in 4 bit sync address counter reads back as in shadow,
+  // 8 bit mode or lost nibble returns the upper nibble twice
+  if ((ac == HD44780_AC_UNKNOWN) || ((unsigned char) HD44780_PCF8574_ReadStatus(addr) != ac)) {
+    // shadow not valid
+    HD44780_PCF8574_ShadowReset();
+    return PCF8574_ERROR;
+  }
+
+  // 4 bit mode, 2 rows, font 5x8
+  HD44780_PCF8574_SendInstruction(addr, HD44780_4BIT_MODE | HD44780_2_ROWS | HD44780_FONT_5x8);
+  // entry mode
+  HD44780_PCF8574_SendInstruction(addr, _hd44780_shadow.entry);
+  // display control
+  HD44780_PCF8574_SendInstruction(addr, _hd44780_shadow.control);
+
   // return success
   return PCF8574_SUCCESS;
 }
@@ -148,13 +438,15 @@ char HD44780_PCF8574_Init (char addr)
  */
 void HD44780_PCF8574_E_pulse (char data)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_E_PULSE);
   // E pulse
   // ----------------------------------
-  TWI_Transmit_Byte(data | PCF8574_PIN_E);
+  EXPANDER_Write(data | PCF8574_PIN_E);
   // PWeh delay time > 450ns
   _delay_us(0.5);
   // E down
-  TWI_Transmit_Byte(data & ~PCF8574_PIN_E);
+  EXPANDER_Write(data & ~PCF8574_PIN_E);
   // PWeh delay time > 450ns
   _delay_us(0.5);
 }
@@ -168,50 +460,151 @@ void HD44780_PCF8574_E_pulse (char data)
  */
 void HD44780_PCF8574_Send_4bits_M4b_I (char data)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_SEND_4BITS);
   // Send upper nibble, E up
   // ----------------------------------
-  TWI_Transmit_Byte(data);
+  EXPANDER_Write(data);
   // E pulse
   HD44780_PCF8574_E_pulse(data);
 }
 
 /**
- * @desc    LCD send 8bits in 4 bit mode
+ * @desc    LCD write 8bits in 4 bit mode into open TWI transaction
  *
  * @param   char
  * @param   char
  *
  * @return  void
  */
-void HD44780_PCF8574_Send_8bits_M4b_I (char addr, char data, char annex)
+static void HD44780_PCF8574_Write_8bits_M4b_I (char data, char annex)
 {
   // upper nible with backlight
   char up_nibble = (data & 0xF0) | annex;
   // lower nibble with backlight
   char low_nibble = (data << 4) | annex;
 
-  // TWI: start
-  // -------------------------
-  TWI_MT_Start();
-
-  // TWI: send SLAW
-  // -------------------------
-  TWI_Transmit_SLAW(addr);
+  // shadow registers
+  HD44780_PCF8574_Track(data, annex);
 
   // Send upper nibble, E up
   // ----------------------------------
-  TWI_Transmit_Byte(up_nibble);
+  EXPANDER_Write(up_nibble);
   // E pulse
   HD44780_PCF8574_E_pulse(up_nibble);
 
   // Send lower nibble, E up
   // ----------------------------------
-  TWI_Transmit_Byte(low_nibble);
+  EXPANDER_Write(low_nibble);
   // E pulse
   HD44780_PCF8574_E_pulse(low_nibble);
 
+#if EXPANDER_FAST
+  // no bus time covers execution, delay > 41us (=37+4 * 270/250)
+  IDLE_DELAY_US(HD44780_EXEC_US);
+#endif
+}
+
+/**
+ * @desc    LCD write 8bits in 4 bit mode, one byte per lane, into open
+ *          transaction - all lanes share one bus time
+ *
+ * @param   const char * - EXPANDER_LANES bytes
+ * @param   char
+ *
+ * @return  void
+ */
+static void HD44780_PCF8574_Write_8bits_Lanes (const char *data, char annex)
+{
+  char nibbles[EXPANDER_LANES];
+  unsigned char shift;
+  unsigned char lane;
+
+  // shadow registers follow lane 0
+  HD44780_PCF8574_Track(data[0], annex);
+
+  // upper nibble, then lower nibble
+  for (shift = 0; shift <= 4; shift += 4) {
+    // nibble of every lane with backlight
+    for (lane = 0; lane < EXPANDER_LANES; lane++) {
+      nibbles[lane] = ((data[lane] << shift) & 0xF0) | annex;
+    }
+    // Send nibble
+    EXPANDER_WriteLanes(nibbles);
+    // E up
+    for (lane = 0; lane < EXPANDER_LANES; lane++) {
+      nibbles[lane] |= PCF8574_PIN_E;
+    }
+    EXPANDER_WriteLanes(nibbles);
+    // PWeh delay time > 450ns
+    _delay_us(0.5);
+    // E down
+    for (lane = 0; lane < EXPANDER_LANES; lane++) {
+      nibbles[lane] &= ~PCF8574_PIN_E;
+    }
+    EXPANDER_WriteLanes(nibbles);
+    // PWeh delay time > 450ns
+    _delay_us(0.5);
+  }
+
+#if EXPANDER_FAST
+  // no bus time covers execution, delay > 41us (=37+4 * 270/250)
+  IDLE_DELAY_US(HD44780_EXEC_US);
+#endif
+}
+
+/** @var recover running, transactions cut meanwhile repaired after it */
+static char _hd44780_resync = 0;
+
+/**
+ * @desc    LCD close transaction. Bytes cut by other master never reached
+ *          glass, shadow is ahead of it and 4 bit sync may be lost -
+ *          address counter unknown, glass redrawn from mirror
+ *
+ * @param   char
+ *
+ * @return  void
+ */
+static void HD44780_PCF8574_Stop (char addr)
+{
+  EXPANDER_Stop();
+  // cut again during recover, once more
+  while (!_hd44780_resync && EXPANDER_Dropped()) {
+    _hd44780_resync = 1;
+    _hd44780_shadow.ac = HD44780_AC_UNKNOWN;
+    // nibble sync, then mirror drawn
+    HD44780_PCF8574_Recover(addr);
+    _hd44780_resync = 0;
+  }
+}
+
+/**
+ * @desc    LCD send 8bits in 4 bit mode
+ *
+ * @param   char - none with SINGLE, PCF8574_ADDRESS
+ * @param   char
+ * @param   char
+ *
+ * @return  void
+ */
+#if HD44780_SINGLE
+void HD44780_PCF8574_Send_8bits_M4b_I_Single (char data, char annex)
+#else
+void HD44780_PCF8574_Send_8bits_M4b_I (char addr, char data, char annex)
+#endif
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_SEND_8BITS);
+  // TWI: start, send SLAW
+  // -------------------------
+  EXPANDER_Start(addr);
+
+  // 8 bits in 4 bit mode
+  // -------------------------
+  HD44780_PCF8574_Write_8bits_M4b_I(data, annex);
+
   // TWI Stop
-  TWI_Stop();
+  HD44780_PCF8574_Stop(HD44780_ADDR(addr));
 }
 
 /**
@@ -223,25 +616,282 @@ void HD44780_PCF8574_Send_8bits_M4b_I (char addr, char data, char annex)
  */
 void HD44780_PCF8574_CheckBF (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_CHECK_BF);
+  // bounded number of polls
+  char i = HD44780_BF_POLLS;
+  // wait till BF cleared
+  while ((HD44780_PCF8574_ReadStatus(addr) & HD44780_BUSY_FLAG) && --i) {
+    HD44780_STATS_INC(polls);
+  }
 }
 
 /**
- * @desc    LCD Send instruction 8 bits in 4 bits mode
+ * @desc    LCD read 8 bits in 4 bit mode
+ *          PCF8574 pins are quasi-bidirectional, written 1 releases DB7-DB4
  *
  * @param   char
+ * @param   char - annex, PCF8574_PIN_RS for DDRAM data
+ *
+ * @return  char
+ */
+static char HD44780_PCF8574_Read_8bits_M4b_I (char addr, char annex)
+{
+  char data;
+  // DB7-DB4 released, read, register select, backlight
+  char control = PCF8574_PIN_DB7 | PCF8574_PIN_DB6 | PCF8574_PIN_DB5 | PCF8574_PIN_DB4 | PCF8574_PIN_RW | annex;
+
+  HD44780_STATS_INC(reads);
+
+  // push-pull data lines input before controller drives them
+  EXPANDER_Release(addr, 1);
+
+  // RS, RW setup, upper and lower nibble, one transaction on I2C
+  // ----------------------------------
+  data = EXPANDER_ReadNibbles(addr, control);
+
+#if EXPANDER_PUSH_PULL
+  // controller stops driving data lines, then outputs again
+  EXPANDER_Start(addr);
+  EXPANDER_Write(annex);
+  HD44780_PCF8574_Stop(addr);
+  EXPANDER_Release(addr, 0);
+#endif
+
+  // BF | AC or character
+  return data;
+}
+
+/**
+ * @desc    LCD read busy flag and address counter
+ *
+ * @param   char
+ *
+ * @return  char - BF | AC
+ */
+char HD44780_PCF8574_ReadStatus (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_READ_STATUS);
+  // RS = 0, RW = 1
+  return HD44780_PCF8574_Read_8bits_M4b_I(addr, HD44780_BACKLIGHT_PIN);
+}
+
+/**
+ * @desc    LCD read DDRAM at address counter, address counter moves
+ *
+ * @param   char
+ *
+ * @return  char
+ */
+char HD44780_PCF8574_ReadData (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_READ_DATA);
+  // RS = 1, RW = 1
+  char data = HD44780_PCF8574_Read_8bits_M4b_I(addr, PCF8574_PIN_RS | HD44780_BACKLIGHT_PIN);
+  // read moves address counter like write
+  _hd44780_shadow.ac = HD44780_PCF8574_NextAC(_hd44780_shadow.ac, _hd44780_shadow.entry & HD44780_ENTRY_ID);
+  // character
+  return data;
+}
+
+/**
+ * @desc    LCD recover after controller reset or lost nibble sync
+ *          Re-init without power on wait, restore registers from shadow
+ *          and rewrite only non space characters of DDRAM mirror
+ *
  * @param   char
  *
  * @return  void
  */
+void HD44780_PCF8574_Recover (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_RECOVER);
+  unsigned char row;
+  char shift = _hd44780_shadow.shift;
+  unsigned char ac = _hd44780_shadow.ac;
+  char entry = _hd44780_shadow.entry;
+  char control = _hd44780_shadow.control;
+  // copy of mirror, clear fills mirror with spaces
+  char line[2][HD44780_LINE_LENGTH + 1];
+
+  for (row = 0; row < 2; row++) {
+    memcpy(line[row], _hd44780_shadow.ddram[row], HD44780_LINE_LENGTH);
+    line[row][HD44780_LINE_LENGTH] = '\0';
+  }
+
+  // 8 bit -> 4 bit sync works from any state
+  // -------------------------------------------------
+  EXPANDER_Start(addr);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  // delay > 4.1ms
+  IDLE_DELAY_MS(HD44780_INIT_MS);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  // delay > 100us
+  IDLE_DELAY_US(HD44780_INIT_US);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB4 | PCF8574_PIN_DB5);
+  IDLE_DELAY_US(HD44780_EXEC_US);
+  HD44780_PCF8574_Send_4bits_M4b_I(PCF8574_PIN_DB5);
+  IDLE_DELAY_US(HD44780_EXEC_US);
+  HD44780_PCF8574_Stop(addr);
+
+  // registers
+  // -------------------------------------------------
+  HD44780_PCF8574_SendInstruction(addr, HD44780_4BIT_MODE | HD44780_2_ROWS | HD44780_FONT_5x8);
+  HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_OFF);
+  HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_CLEAR);
+  // delay > 1.52ms
+  IDLE_DELAY_MS(HD44780_CLEAR_MS);
+  HD44780_PCF8574_SendInstruction(addr, HD44780_ENTRY_MODE);
+
+#if CHARSET_UTF8
+  // glyphs before cells drawn by them
+  CHARSET_Restore(addr);
+#endif
+
+  // minimal rewrite - mirror is now spaces
+  // -------------------------------------------------
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START, line[0]);
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW2_START, line[1]);
+
+  // display shift, shorter way
+  if (shift <= (HD44780_LINE_LENGTH / 2)) {
+    HD44780_PCF8574_SendInstructions(addr, HD44780_SHIFT | HD44780_DISPLAY | HD44780_LEFT, shift);
+  } else {
+    HD44780_PCF8574_SendInstructions(addr, HD44780_SHIFT | HD44780_DISPLAY | HD44780_RIGHT, HD44780_LINE_LENGTH - shift);
+  }
+  // entry mode, display control, address counter
+  HD44780_PCF8574_SendInstruction(addr, entry);
+  HD44780_PCF8574_SendInstruction(addr, control);
+  if (ac != HD44780_AC_UNKNOWN) {
+    HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ac);
+  }
+}
+
+/**
+ * @desc    LCD scrub one DDRAM cell - low rate background check
+ *          Bus time is bounded: status read, cell read, at most one rewrite
+ *
+ * @param   char
+ *
+ * @return  char - PCF8574_SUCCESS, PCF8574_PENDING if busy, PCF8574_ERROR if repaired
+ */
+char HD44780_PCF8574_Scrub (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_SCRUB);
+  char data;
+  char status;
+  unsigned char ac = _hd44780_shadow.ac;
+  // cell to check
+  unsigned char row = _hd44780_scrub / HD44780_LINE_LENGTH;
+  unsigned char col = _hd44780_scrub % HD44780_LINE_LENGTH;
+
+  // address counter must match shadow
+  // -------------------------------------------------
+  status = HD44780_PCF8574_ReadStatus(addr);
+  // still executing
+  if (status & HD44780_BUSY_FLAG) {
+    return PCF8574_PENDING;
+  }
+  // controller reset falls back to 8 bit mode with AC = 0
+  // or nibble sync is lost, both read wrong AC
+  if ((ac != HD44780_AC_UNKNOWN) && ((unsigned char) status != ac)) {
+    // re-init and rewrite
+    HD44780_STATS_INC(recoveries);
+    HD44780_PCF8574_Recover(addr);
+    return PCF8574_ERROR;
+  }
+
+  // next cell
+  if (++_hd44780_scrub >= (2 * HD44780_LINE_LENGTH)) {
+    _hd44780_scrub = 0;
+  }
+
+  // compare cell with mirror
+  // -------------------------------------------------
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ((row ? HD44780_ROW2_START : HD44780_ROW1_START) + col));
+  data = HD44780_PCF8574_ReadData(addr);
+  // scrambled cell
+  if (data != _hd44780_shadow.ddram[row][col]) {
+    // rewrite from mirror
+    HD44780_STATS_INC(repairs);
+    HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ((row ? HD44780_ROW2_START : HD44780_ROW1_START) + col));
+    HD44780_PCF8574_SendData(addr, _hd44780_shadow.ddram[row][col]);
+    status = PCF8574_ERROR;
+  } else {
+    status = PCF8574_SUCCESS;
+  }
+  // restore address counter
+  if (ac != HD44780_AC_UNKNOWN) {
+    HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ac);
+  }
+  // result
+  return status;
+}
+
+/**
+ * @desc    LCD Send instruction 8 bits in 4 bits mode
+ *
+ * @param   char - none with SINGLE, PCF8574_ADDRESS
+ * @param   char
+ *
+ * @return  void
+ */
+#if HD44780_SINGLE
+void HD44780_PCF8574_SendInstruction_Single (char instruction)
+#else
 void HD44780_PCF8574_SendInstruction (char addr, char instruction)
+#endif
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_INSTRUCTION);
+  // address counter already there, elide
+  if ((instruction & HD44780_POSITION) && (_hd44780_shadow.ac == (unsigned char) (instruction & ~HD44780_POSITION))) {
+    HD44780_STATS_INC(elided);
+    return;
+  }
   // send instruction
-  HD44780_PCF8574_Send_8bits_M4b_I(addr, instruction, PCF8574_PIN_P3);
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, instruction, HD44780_BACKLIGHT_PIN);
   // check BF
   //HD44780_PCF8574_CheckBF(addr);
-  _delay_ms(50);
+#if !EXPANDER_FAST
+  // delay > 37us, clear and return home wait on their own
+  IDLE_DELAY_US(HD44780_EXEC_US);
+#endif
+}
+
+/**
+ * @desc    LCD send the same instruction count times in one TWI transaction
+ *
+ * @param   char
+ * @param   char
+ * @param   char
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_SendInstructions (char addr, char instruction, char count)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_INSTRUCTIONS);
+  // TWI: start, send SLAW
+  // -------------------------
+  EXPANDER_Start(addr);
+
+  // every instruction takes longer on bus than 37 us execution time
+  while (count-- > 0) {
+    HD44780_PCF8574_Write_8bits_M4b_I(instruction, HD44780_BACKLIGHT_PIN);
+  }
+
+  // TWI Stop
+  HD44780_PCF8574_Stop(addr);
+  // delay > 37us
+  IDLE_DELAY_US(HD44780_EXEC_US);
 }
 
+#if !HD44780_SINGLE
 /**
  * @desc    LCD Send data 8 bits in 4 bits mode
  *
@@ -252,14 +902,17 @@ void HD44780_PCF8574_SendInstruction (char addr, char instruction)
  */
 void HD44780_PCF8574_SendData (char addr, char data)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DATA);
   // send data
   // data/command -> pin RS High
   // backlight -> pin P3
-  HD44780_PCF8574_Send_8bits_M4b_I(addr, data, PCF8574_PIN_RS | PCF8574_PIN_P3);
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, data, PCF8574_PIN_RS | HD44780_BACKLIGHT_PIN);
   // check BF
   //HD44780_PCF8574_CheckBF(addr);
   //_delay_ms(50);
 }
+#endif
 
 /**
  * @desc    LCD Go to position x, y
@@ -272,6 +925,8 @@ void HD44780_PCF8574_SendData (char addr, char data)
  */
 char HD44780_PCF8574_PositionXY (char addr, char x, char y)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_POSITION_XY);
   if (x > HD44780_COLS || y > HD44780_ROWS) {
     // error
     return PCF8574_ERROR;
@@ -297,8 +952,35 @@ char HD44780_PCF8574_PositionXY (char addr, char x, char y)
  */
 void HD44780_PCF8574_DisplayClear (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_CLEAR);
   // Diplay clear
   HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_CLEAR);
+  // delay > 1.52ms
+  IDLE_DELAY_MS(HD44780_CLEAR_MS);
+}
+
+/**
+ * @desc    LCD display clear - resumable, call till it stops returning PCF8574_PENDING
+ *
+ * @param   char
+ *
+ * @return  char
+ */
+char HD44780_PCF8574_DisplayClearAsync (char addr)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_CLEAR_ASYNC);
+  PT_Thread *pt = &_hd44780_pt_clear;
+
+  PT_BEGIN(pt);
+
+  // Diplay clear
+  HD44780_PCF8574_Send_8bits_M4b_I(addr, HD44780_DISP_CLEAR, HD44780_BACKLIGHT_PIN);
+  // delay > 1.52ms
+  PT_WAIT_MS(pt, HD44780_CLEAR_MS);
+
+  PT_END(pt);
 }
 
 /**
@@ -310,6 +992,8 @@ void HD44780_PCF8574_DisplayClear (char addr)
  */
 void HD44780_PCF8574_DisplayOn (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DISPLAY_ON);
   // send instruction - display on
   HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_ON);
 }
@@ -323,6 +1007,8 @@ void HD44780_PCF8574_DisplayOn (char addr)
  */
 void HD44780_PCF8574_CursorOn (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_CURSOR_ON);
   // send instruction - cursor on
   HD44780_PCF8574_SendInstruction(addr, HD44780_CURSOR_ON);
 }
@@ -336,10 +1022,13 @@ void HD44780_PCF8574_CursorOn (char addr)
  */
 void HD44780_PCF8574_CursorBlink (char addr)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_CURSOR_BLINK);
   // send instruction - Cursor blink
   HD44780_PCF8574_SendInstruction(addr, HD44780_CURSOR_BLINK);
 }
 
+#if !HD44780_SINGLE
 /**
  * @desc    LCD draw char
  *
@@ -350,9 +1039,12 @@ void HD44780_PCF8574_CursorBlink (char addr)
  */
 void HD44780_PCF8574_DrawChar (char addr, char character)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DRAW_CHAR);
   // Draw character
   HD44780_PCF8574_SendData(addr, character);
 }
+#endif
 
 /**
  * @desc    LCD draw string
@@ -364,13 +1056,401 @@ void HD44780_PCF8574_DrawChar (char addr, char character)
  */
 void HD44780_PCF8574_DrawString (char addr, char *str)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DRAW_STRING);
   unsigned short int i = 0;
+#if CHARSET_UTF8
+  CHARSET_Stream utf8 = CHARSET_STREAM_INIT;
+  unsigned int cp;
+#endif
+  // transactions of string sent at once where supported
+  EXPANDER_Hold(1);
   // loop through chars
   while (str[i] != '\0') {
+#if CHARSET_UTF8
+    // ASCII the same as raw path
+    if (((unsigned char) str[i] < 0x80) && !utf8.left) {
+      HD44780_PCF8574_DrawChar(addr, str[i++]);
+    // code point drawn at last byte of its sequence
+    } else if (CHARSET_Decode(&utf8, str[i++], &cp)) {
+      HD44780_PCF8574_DrawChar(addr, CHARSET_Code(addr, &utf8, cp));
+    }
+#else
     // draw individual chars
     HD44780_PCF8574_DrawChar(addr, str[i++]);
+#endif
+  }
+  EXPANDER_Hold(0);
+}
+
+/**
+ * @desc    LCD draw one string per lane in lockstep - N displays in wall
+ *          time of one, shorter strings padded by spaces
+ *
+ * @param   char
+ * @param   char ** - EXPANDER_LANES strings
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_DrawStrings (char addr, char **str)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DRAW_STRINGS);
+  char chars[EXPANDER_LANES];
+  unsigned short int i = 0;
+  unsigned char ended = 0;
+  unsigned char lane;
+
+  // transactions of strings sent at once where supported
+  EXPANDER_Hold(1);
+  // loop through chars
+  while (1) {
+    // char of every lane, space after end
+    for (lane = 0; lane < EXPANDER_LANES; lane++) {
+      if (!(ended & (1 << lane)) && (str[lane][i] == '\0')) {
+        ended |= 1 << lane;
+      }
+      chars[lane] = (ended & (1 << lane)) ? ' ' : str[lane][i];
+    }
+    // all strings drawn
+    if (ended == (unsigned char) ((1 << EXPANDER_LANES) - 1)) {
+      break;
+    }
+    // data -> pin RS High, backlight -> pin P3
+    EXPANDER_Start(addr);
+    HD44780_PCF8574_Write_8bits_Lanes(chars, PCF8574_PIN_RS | HD44780_BACKLIGHT_PIN);
+    HD44780_PCF8574_Stop(addr);
+    i++;
   }
+  EXPANDER_Hold(0);
+}
+
+/**
+ * @desc    LCD draw pre-encoded screen from flash in one TWI transaction
+ *          Blob = 16 bit little endian length + ready PCF8574 bytes with
+ *          RS, E and backlight, no per-character computation but
+ *          backlight pin taken from shadow
+ *
+ * @param   char
+ * @param   const uint8_t * - blob generated by tools/lcdscreen
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_DrawScreen (char addr, const uint8_t *blob)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DRAW_SCREEN);
+  // length
+  unsigned int length = pgm_read_byte(blob) | (pgm_read_byte(blob + 1) << 8);
+  // position in 6 byte group
+  char i = 0;
+  char data;
+  char up_nibble = 0;
+  char low_nibble = 0;
+  // data
+  blob += 2;
+
+  // TWI: start, send SLAW
+  // -------------------------
+  EXPANDER_Start(addr);
+
+  // stream bytes, every byte takes longer than 37 us execution time
+  while (length--) {
+    // backlight as set, not as encoded
+    data = (pgm_read_byte(blob++) & ~PCF8574_PIN_P3) | HD44780_BACKLIGHT_PIN;
+    EXPANDER_Write(data);
+    // 6 bytes per instruction / data, nibbles at offset 0 and 3
+    if (++i == 1) {
+      up_nibble = data;
+    } else if (i == 4) {
+      low_nibble = data;
+    } else if (i == 6) {
+      // shadow registers
+      HD44780_PCF8574_Track((up_nibble & 0xF0) | ((low_nibble >> 4) & 0x0F), up_nibble);
+      i = 0;
+#if EXPANDER_FAST
+      // no bus time covers execution
+      IDLE_DELAY_US(HD44780_EXEC_US);
+#endif
+    }
+  }
+
+  // TWI Stop
+  HD44780_PCF8574_Stop(addr);
+}
+
+/**
+ * @desc    LCD update string at DDRAM address, only characters that differ
+ *          from DDRAM mirror are sent
+ *
+ * @param   char
+ * @param   unsigned char - DDRAM address, nothing drawn if not valid
+ * @param   char * - cut at end of line
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_UpdateString (char addr, unsigned char ddram, char *str)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_UPDATE_STRING);
+  // address outside line, no mirror cell
+  if (!HD44780_DDRAM_VALID(ddram)) {
+    return;
+  }
+  // transactions of string sent at once where supported
+  EXPANDER_Hold(1);
+  // loop through chars
+  while (*str != '\0') {
+    // character differs from glass
+    if (_hd44780_shadow.ddram[ddram >= HD44780_ROW2_START][ddram & ~HD44780_ROW2_START] != *str) {
+      // set address, elided if address counter is already there
+      HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ddram);
+      // draw char
+      HD44780_PCF8574_DrawChar(addr, *str);
+    }
+    str++;
+    // last cell of line written, rest has no cell
+    if ((ddram & ~HD44780_ROW2_START) == (HD44780_LINE_LENGTH - 1)) {
+      break;
+    }
+    // next address
+    ddram++;
+  }
+  EXPANDER_Hold(0);
+}
+
+#if !HD44780_SINGLE
+/**
+ * @desc    LCD draw dirty parts of screen image, only cells differing
+ *          from DDRAM mirror are sent
+ *
+ * @param   char addr
+ * @param   const volatile unsigned char * - codes, row after row
+ * @param   const volatile unsigned char * - 8 characters of 8 rows
+ * @param   unsigned char - cursor cell
+ * @param   unsigned char - control bit 2 display, 1 cursor, 0 blink
+ * @param   unsigned char - backlight, 0 off
+ * @param   unsigned int - HD44780_DIRTY_*
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_DrawImage (char addr, const volatile unsigned char *text, const volatile unsigned char *cgram, unsigned char cursor, unsigned char control, unsigned char backlight, unsigned int dirty)
+{
+  char row[HD44780_COLS + 1];
+  unsigned char i;
+  unsigned char j;
+
+  // latency histogram
+  PROF_ENTER(PROF_LCD_DRAW_IMAGE);
+  // nothing changed
+  if (!dirty) {
+    return;
+  }
+  // CGRAM first, drawn cells with its codes change at once
+  for (i = 0; i < 8; i++) {
+    if (dirty & (1 << i)) {
+      HD44780_PCF8574_SendInstruction(addr, HD44780_CGRAM | (i << 3));
+      for (j = 0; j < 8; j++) {
+        HD44780_PCF8574_SendData(addr, cgram[(i << 3) + j]);
+      }
+    }
+  }
+  // text, UpdateString skips cells equal to shadow
+  for (i = 0; i < HD44780_ROWS; i++) {
+    if (dirty & (HD44780_DIRTY_ROW0 << i)) {
+      for (j = 0; j < HD44780_COLS; j++) {
+        // CGRAM code 0 ends string, the same character at 8
+        row[j] = text[i * HD44780_COLS + j] ? text[i * HD44780_COLS + j] : 0x08;
+      }
+      row[HD44780_COLS] = '\0';
+      HD44780_PCF8574_UpdateString(addr, i ? HD44780_ROW2_START : HD44780_ROW1_START, row);
+    }
+  }
+  // backlight
+  if (dirty & HD44780_DIRTY_BACKLIGHT) {
+    HD44780_PCF8574_Backlight(addr, backlight != 0);
+  }
+  // display control if changed
+  if (_hd44780_shadow.control != (HD44780_DISP_OFF | (control & 0x07))) {
+    HD44780_PCF8574_SendInstruction(addr, HD44780_DISP_OFF | (control & 0x07));
+  }
+  // cursor back at its cell after drawing, elided if already there
+  cursor &= HD44780_ROWS * HD44780_COLS - 1;
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ((cursor >= HD44780_COLS) ? HD44780_ROW2_START : HD44780_ROW1_START) | (cursor % HD44780_COLS));
+}
+
+/**
+ * @desc    LCD init from firmware task, resumable. Whole image dirty
+ *          once done, parts written during init are drawn too
+ *
+ * @param   char addr
+ * @param   volatile unsigned int * - dirty flags of image
+ *
+ * @return  char - PCF8574_PENDING till init is done
+ */
+char HD44780_PCF8574_InitImage (char addr, volatile unsigned int *dirty)
+{
+  // yields during controller waits
+  char status = HD44780_PCF8574_InitAsync(addr);
+
+  // written by interrupt too
+  if (status != PCF8574_PENDING) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      *dirty = HD44780_DIRTY_ALL;
+    }
+  }
+
+  return status;
+}
+#endif
+
+/**
+ * @desc    LCD queue text at DDRAM address, drawn by pump. Only writer
+ *          moves head, so alarm can be queued from interrupt
+ *
+ * @param   char - lane {HD44780_LANE_BULK; HD44780_LANE_ALARM}
+ * @param   unsigned char - DDRAM address
+ * @param   const char * - text, cut at row length and line end
+ *
+ * @return  char - PCF8574_ERROR if lane is full or address not valid
+ */
+char HD44780_PCF8574_Queue (char lane, unsigned char ddram, const char *str)
+{
+  HD44780_PCF8574_Lane *queue = &_hd44780_queue[(unsigned char) lane];
+  HD44780_PCF8574_Write *write;
+  unsigned char length;
+  unsigned char i = 0;
+
+  // no DDRAM cell there, pump would read mirror out of bounds
+  if (!HD44780_DDRAM_VALID(ddram)) {
+    return PCF8574_ERROR;
+  }
+  // nothing to draw
+  if (*str == '\0') {
+    return PCF8574_SUCCESS;
+  }
+  // all slots taken
+  if ((unsigned char) (queue->head - queue->tail) >= HD44780_QUEUE_SIZE) {
+    return PCF8574_ERROR;
+  }
+  // row length
+  length = HD44780_LINE_LENGTH - (ddram & ~HD44780_ROW2_START);
+  if (length > HD44780_COLS) {
+    length = HD44780_COLS;
+  }
+  // free slot
+  write = &queue->write[queue->head & (HD44780_QUEUE_SIZE - 1)];
+  write->ddram = ddram;
+  while ((i < length) && (str[i] != '\0')) {
+    write->text[i] = str[i];
+    i++;
+  }
+  write->text[i] = '\0';
+  // visible to pump when complete
+  queue->head++;
+
+  // success
+  return PCF8574_SUCCESS;
+}
+
+/**
+ * @desc    LCD draw queued text, one cell per transaction. Alarm lane is
+ *          checked before every cell, bulk write goes on where it was
+ *          cut. Address counter of interrupted writer is restored after
+ *          alarm. Cells equal to DDRAM mirror cost nothing
+ *
+ * @param   char addr
+ * @param   unsigned char - max cells sent
+ *
+ * @return  char - PCF8574_SUCCESS if queue is empty, else PCF8574_PENDING
+ */
+char HD44780_PCF8574_Pump (char addr, unsigned char cells)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_PUMP);
+  HD44780_PCF8574_Lane *alarm = &_hd44780_queue[HD44780_LANE_ALARM];
+  HD44780_PCF8574_Lane *bulk = &_hd44780_queue[HD44780_LANE_BULK];
+  HD44780_PCF8574_Lane *queue;
+  HD44780_PCF8574_Write *write;
+  unsigned char ddram;
+  char character;
+  char status = PCF8574_PENDING;
+
+  // transactions of cells sent at once where supported
+  EXPANDER_Hold(1);
+  while (1) {
+    // alarm first, at every cell boundary
+    if (alarm->head != alarm->tail) {
+      queue = alarm;
+      // address counter of interrupted writer
+      if (_hd44780_resume == HD44780_RESUME_NONE) {
+        _hd44780_resume = _hd44780_shadow.ac;
+      }
+    } else {
+      queue = bulk;
+      // alarm done
+      if (_hd44780_resume != HD44780_RESUME_NONE) {
+        // cursor back, bulk write sets its own address
+        if ((bulk->head == bulk->tail) && (_hd44780_resume != HD44780_AC_UNKNOWN)) {
+          HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | _hd44780_resume);
+        }
+        _hd44780_resume = HD44780_RESUME_NONE;
+      }
+      // queue empty
+      if (bulk->head == bulk->tail) {
+        status = PCF8574_SUCCESS;
+        break;
+      }
+    }
+    // budget spent
+    if (cells == 0) {
+      break;
+    }
+    // next char of write in progress
+    write = &queue->write[queue->tail & (HD44780_QUEUE_SIZE - 1)];
+    ddram = write->ddram + queue->sent;
+    character = write->text[queue->sent++];
+    // character differs from glass
+    if (_hd44780_shadow.ddram[ddram >= HD44780_ROW2_START][ddram & ~HD44780_ROW2_START] != character) {
+      // set address, elided if address counter is already there
+      HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | ddram);
+      // draw char
+      HD44780_PCF8574_DrawChar(addr, character);
+      cells--;
+    }
+    // write done, slot free for writer
+    if (write->text[queue->sent] == '\0') {
+      queue->sent = 0;
+      queue->tail++;
+    }
+  }
+  EXPANDER_Hold(0);
+
+  // queue state
+  return status;
+}
+
+#if !HD44780_SINGLE
+/**
+ * @desc    LCD backlight on / off - pin P3 of every following port byte
+ *
+ * @param   char addr
+ * @param   char - 1 on, 0 off
+ *
+ * @return  void
+ */
+void HD44780_PCF8574_Backlight (char addr, char on)
+{
+  // latency histogram
+  PROF_ENTER(PROF_LCD_BACKLIGHT);
+  // kept in shadow, survives warm init
+  _hd44780_shadow.backlight = on ? PCF8574_PIN_P3 : 0;
+  // E low, nothing latched by controller
+  EXPANDER_Start(addr);
+  EXPANDER_Write(_hd44780_shadow.backlight);
+  HD44780_PCF8574_Stop(addr);
 }
+#endif
 
 /**
  * @desc    Shift cursor / display to left / right
@@ -383,6 +1463,8 @@ void HD44780_PCF8574_DrawString (char addr, char *str)
  */
 char HD44780_PCF8574_Shift (char addr, char item, char direction)
 {
+  // latency histogram
+  PROF_ENTER(PROF_LCD_SHIFT);
   // check if item is cursor or display or direction is left or right
   if ((item != HD44780_DISPLAY) && (item != HD44780_CURSOR)) {
     // error
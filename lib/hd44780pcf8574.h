@@ -10,7 +10,7 @@
  * @file        hd44780pcf8547.h
  * @tested      AVR Atmega328p
  *
- * @depend      twi, pcf8547
+ * @depend      expander, pt, prof
  * ---------------------------------------------------------------+
  */
 #ifndef __HD44780PCF8574_H__
@@ -18,10 +18,37 @@
 
 #include <avr/io.h>
 #include <avr/pgmspace.h>
+#include "pt.h"
+#include "prof.h"
+#include "expander.h"
 
   #define PCF8574_SUCCESS         0
   #define PCF8574_ERROR           1
-  #define PCF8574_ADDRESS      0x27
+  #define PCF8574_PENDING         PT_WAITING
+  // address of selected backend, make EXPANDER=...
+  #define PCF8574_ADDRESS      EXPANDER_ADDRESS
+
+  // one display at PCF8574_ADDRESS, make SINGLE=1 - HD44780_SINGLE in expander.h
+
+  // @const backlight after cold init, make BACKLIGHT=0 for off
+  #ifndef HD44780_BACKLIGHT
+    #define HD44780_BACKLIGHT  1
+  #endif
+  #define HD44780_BACKLIGHT_ON (HD44780_BACKLIGHT ? PCF8574_PIN_P3 : 0)
+
+  #if HD44780_SINGLE
+    // address argument ignored, constant at every bus access
+    #define HD44780_ADDR(ADDR)    PCF8574_ADDRESS
+    // backlight pin of every port byte fixed at compile time
+    #define HD44780_BACKLIGHT_PIN HD44780_BACKLIGHT_ON
+  #else
+    #define HD44780_ADDR(ADDR)    (ADDR)
+    #define HD44780_BACKLIGHT_PIN _hd44780_shadow.backlight
+  #endif
+
+  #if HD44780_SINGLE && (EXPANDER_LANES > 1)
+    #error "SINGLE drives one display, SWI2C_LANES must be 1"
+  #endif
 
 
   #define PCF8574_PIN_RS       0x01
@@ -33,7 +60,8 @@
   #define PCF8574_PIN_DB6      0x40
   #define PCF8574_PIN_DB7      0x80
 
-  #define HD44780_BUSY_FLAG    HD44780_DB7
+  #define HD44780_BUSY_FLAG    0x80
+  #define HD44780_BF_POLLS     10
   #define HD44780_INIT_SEQ     0x30
   #define HD44780_DISP_CLEAR   0x01
   #define HD44780_DISP_OFF     0x08
@@ -42,6 +70,9 @@
   #define HD44780_CURSOR_BLINK 0x0F
   #define HD44780_RETURN_HOME  0x02 
   #define HD44780_ENTRY_MODE   0x06
+  #define HD44780_ENTRY_SET    0x04
+  #define HD44780_ENTRY_ID     0x02
+  #define HD44780_CGRAM        0x40
   #define HD44780_4BIT_MODE    0x20
   #define HD44780_8BIT_MODE    0x30
   #define HD44780_2_ROWS       0x08
@@ -55,14 +86,119 @@
   #define HD44780_LEFT         0x00
   #define HD44780_RIGHT        0x04
 
+  // execution times
+  #define HD44780_POWER_ON_MS  16
+  #define HD44780_INIT_MS      5
+  #define HD44780_INIT_US      110
+  #define HD44780_EXEC_US      50
+  #define HD44780_CLEAR_MS     2
+
   #define HD44780_ROWS         2
   #define HD44780_COLS         16
 
+  #define HD44780_LINE_LENGTH  40
+  #define HD44780_AC_UNKNOWN   0xFF
+  #define HD44780_SHADOW_MAGIC 0x4478
+  #define HD44780_RESUME_NONE  0xFE
+
   #define HD44780_ROW1_START   0x00
   #define HD44780_ROW1_END     HD44780_COLS
   #define HD44780_ROW2_START   0x40
   #define HD44780_ROW2_END     HD44780_COLS
+  // DDRAM address in 0x00 - 0x27 or 0x40 - 0x67
+  #define HD44780_DDRAM_VALID(ADDR) ((((unsigned char) (ADDR)) & ~HD44780_ROW2_START) < HD44780_LINE_LENGTH)
+
+  // parts of screen image to draw, bit i = CGRAM character i
+  #define HD44780_DIRTY_CGRAM     0x00FF
+  #define HD44780_DIRTY_ROW0      0x0100
+  #define HD44780_DIRTY_ROW1      0x0200
+  #define HD44780_DIRTY_CURSOR    0x0400
+  #define HD44780_DIRTY_BACKLIGHT 0x0800
+  #define HD44780_DIRTY_ALL       0x0FFF
   
+  /** @struct shadow of controller registers */
+  typedef struct {
+    // HD44780_SHADOW_MAGIC if valid after reset
+    unsigned int magic;
+    // address counter in DDRAM, HD44780_AC_UNKNOWN if not known
+    unsigned char ac;
+    // display shift, number of columns shifted left, 0 .. HD44780_LINE_LENGTH - 1
+    unsigned char shift;
+    // entry mode set instruction
+    unsigned char entry;
+    // display on/off control instruction
+    unsigned char control;
+    // PCF8574_PIN_P3 or 0, backlight pin of every port byte
+    unsigned char backlight;
+    // mirror of DDRAM, both lines
+    char ddram[2][HD44780_LINE_LENGTH];
+  } HD44780_PCF8574_Shadow;
+
+  /* @var shadow of controller registers */
+  extern HD44780_PCF8574_Shadow _hd44780_shadow;
+
+  // @const lanes of queued writes, alarm lane goes first at every cell
+  #define HD44780_LANE_BULK    0
+  #define HD44780_LANE_ALARM   1
+  #define HD44780_QUEUE_LANES  2
+
+  // @const queued writes per lane, power of 2
+  #ifndef HD44780_QUEUE_SIZE
+    #define HD44780_QUEUE_SIZE 4
+  #endif
+
+  /** @struct queued write */
+  typedef struct {
+    // DDRAM address of first char
+    unsigned char ddram;
+    // text, at most one row
+    char text[HD44780_COLS + 1];
+  } HD44780_PCF8574_Write;
+
+  /** @struct lane of queued writes, head moved by writer, tail by pump */
+  typedef struct {
+    // ring of writes
+    HD44780_PCF8574_Write write[HD44780_QUEUE_SIZE];
+    // next free slot, free running
+    volatile unsigned char head;
+    // write in progress, free running
+    volatile unsigned char tail;
+    // chars of write in progress already done
+    unsigned char sent;
+  } HD44780_PCF8574_Lane;
+
+  // hot path counters, make STATS=1
+  #ifndef HD44780_STATS
+    #define HD44780_STATS      0
+  #endif
+
+  /** @struct hot path counters */
+  typedef struct {
+    // instructions sent
+    unsigned long int instructions;
+    // data writes
+    unsigned long int data;
+    // instructions elided by shadow
+    unsigned long int elided;
+    // bytes read back
+    unsigned long int reads;
+    // busy flag polls
+    unsigned long int polls;
+    // DDRAM cells repaired by scrub
+    unsigned int repairs;
+    // recoveries after controller reset
+    unsigned int recoveries;
+  } HD44780_PCF8574_Stats;
+
+  #if HD44780_STATS
+    // increment counter
+    #define HD44780_STATS_INC(FIELD)    { _hd44780_stats.FIELD++; }
+    /* @var hot path counters */
+    extern HD44780_PCF8574_Stats _hd44780_stats;
+  #else
+    #define HD44780_STATS_INC(FIELD)
+  #endif
+
   // set bit
   #define SETBIT(REG, BIT) { REG |= (1 << BIT); }
   // clear bit
@@ -79,6 +215,24 @@
    */
   char HD44780_PCF8574_Init (char);
 
+  /**
+   * @desc    LCD init - resumable, call till it stops returning PCF8574_PENDING
+   *
+   * @param   char
+   *
+   * @return  char
+   */
+  char HD44780_PCF8574_InitAsync (char);
+
+  /**
+   * @desc    LCD warm init - after MCU reset while LCD kept power
+   *
+   * @param   char
+   *
+   * @return  char - PCF8574_ERROR if cold init is needed
+   */
+  char HD44780_PCF8574_InitWarm (char);
+
   /**
    * @desc    LCD E pulse
    *
@@ -88,6 +242,19 @@
    */
   void HD44780_PCF8574_E_pulse (char);
 
+  #if HD44780_SINGLE
+  /**
+   * @desc    LCD send instruction to PCF8574_ADDRESS
+   *
+   * @param   char
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_SendInstruction_Single (char);
+
+  // address argument dropped at compile time
+  #define HD44780_PCF8574_SendInstruction(ADDR, INSTRUCTION) HD44780_PCF8574_SendInstruction_Single(INSTRUCTION)
+  #else
   /**
    * @desc    LCD send instruction
    *
@@ -97,6 +264,18 @@
    * @return  void
    */
   void HD44780_PCF8574_SendInstruction (char, char);
+  #endif
+
+  /**
+   * @desc    LCD send the same instruction count times in one TWI transaction
+   *
+   * @param   char
+   * @param   char
+   * @param   char
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_SendInstructions (char, char, char);
 
   /**
    * @desc    LCD Send data 8 bits in 4 bits mode
@@ -106,7 +285,9 @@
    *
    * @return  void
    */
+  #if !HD44780_SINGLE
   void HD44780_PCF8574_SendData (char, char);
+  #endif
 
   /**
    * @desc    LCD check BF
@@ -117,6 +298,42 @@
    */
   void HD44780_PCF8574_CheckBF (char);
 
+  /**
+   * @desc    LCD read busy flag and address counter
+   *
+   * @param   char
+   *
+   * @return  char - BF | AC
+   */
+  char HD44780_PCF8574_ReadStatus (char);
+
+  /**
+   * @desc    LCD read DDRAM at address counter, address counter moves
+   *
+   * @param   char
+   *
+   * @return  char
+   */
+  char HD44780_PCF8574_ReadData (char);
+
+  /**
+   * @desc    LCD recover after controller reset or lost nibble sync
+   *
+   * @param   char
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_Recover (char);
+
+  /**
+   * @desc    LCD scrub one DDRAM cell - low rate background check
+   *
+   * @param   char
+   *
+   * @return  char - PCF8574_SUCCESS, PCF8574_PENDING if busy, PCF8574_ERROR if repaired
+   */
+  char HD44780_PCF8574_Scrub (char);
+
   /**
    * @desc    LCD send 4bits in 4 bit mode
    *
@@ -126,6 +343,20 @@
    */
   void HD44780_PCF8574_Send_4bits_M4b_I (char);
 
+  #if HD44780_SINGLE
+  /**
+   * @desc    LCD send 8bits in 4 bit mode to PCF8574_ADDRESS
+   *
+   * @param   char
+   * @param   char
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_Send_8bits_M4b_I_Single (char, char);
+
+  // address argument dropped at compile time
+  #define HD44780_PCF8574_Send_8bits_M4b_I(ADDR, DATA, ANNEX) HD44780_PCF8574_Send_8bits_M4b_I_Single(DATA, ANNEX)
+  #else
   /**
    * @desc    LCD send 8bits in 4 bit mode
    *
@@ -136,6 +367,7 @@
    * @return  void
    */
   void HD44780_PCF8574_Send_8bits_M4b_I (char, char, char);
+  #endif
 
   /**
    * @desc    LCD display clear
@@ -146,6 +378,15 @@
    */
   void HD44780_PCF8574_DisplayClear (char);
 
+  /**
+   * @desc    LCD display clear - resumable, call till it stops returning PCF8574_PENDING
+   *
+   * @param   char
+   *
+   * @return  char
+   */
+  char HD44780_PCF8574_DisplayClearAsync (char);
+
   /**
    * @desc    LCD display on
    *
@@ -181,7 +422,9 @@
    *
    * @return  void
    */
+  #if !HD44780_SINGLE
   void HD44780_PCF8574_DrawChar (char, char);
+  #endif
 
   /**
    * @desc    LCD draw string
@@ -193,6 +436,16 @@
    */
   void HD44780_PCF8574_DrawString (char, char *);
 
+  /**
+   * @desc    LCD draw one string per lane in lockstep, see EXPANDER_LANES
+   *
+   * @param   char
+   * @param   char ** - EXPANDER_LANES strings
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_DrawStrings (char, char **);
+
   /**
    * @desc    LCD Go to position x, y
    *
@@ -204,6 +457,93 @@
    */
   char HD44780_PCF8574_PositionXY (char, char, char);
 
+  /**
+   * @desc    LCD update string at DDRAM address, only characters that differ
+   *          from DDRAM mirror are sent
+   *
+   * @param   char
+   * @param   unsigned char - DDRAM address, nothing drawn if not valid
+   * @param   char * - cut at end of line
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_UpdateString (char, unsigned char, char *);
+
+  /**
+   * @desc    LCD draw dirty parts of screen image, only cells differing
+   *          from DDRAM mirror are sent
+   *
+   * @param   char addr
+   * @param   const volatile unsigned char * - codes, row after row
+   * @param   const volatile unsigned char * - 8 characters of 8 rows
+   * @param   unsigned char - cursor cell
+   * @param   unsigned char - control bit 2 display, 1 cursor, 0 blink
+   * @param   unsigned char - backlight, 0 off
+   * @param   unsigned int - HD44780_DIRTY_*
+   *
+   * @return  void
+   */
+  #if !HD44780_SINGLE
+  void HD44780_PCF8574_DrawImage (char, const volatile unsigned char *, const volatile unsigned char *, unsigned char, unsigned char, unsigned char, unsigned int);
+  #endif
+
+  /**
+   * @desc    LCD init from firmware task, resumable. Whole image dirty
+   *          once done, parts written during init are drawn too
+   *
+   * @param   char addr
+   * @param   volatile unsigned int * - dirty flags of image
+   *
+   * @return  char - PCF8574_PENDING till init is done
+   */
+  #if !HD44780_SINGLE
+  char HD44780_PCF8574_InitImage (char, volatile unsigned int *);
+  #endif
+
+  /**
+   * @desc    LCD queue text at DDRAM address, drawn by pump
+   *
+   * @param   char - lane {HD44780_LANE_BULK; HD44780_LANE_ALARM}
+   * @param   unsigned char - DDRAM address
+   * @param   const char * - text, cut at row length and line end
+   *
+   * @return  char - PCF8574_ERROR if lane is full or address not valid
+   */
+  char HD44780_PCF8574_Queue (char, unsigned char, const char *);
+
+  /**
+   * @desc    LCD draw queued text, alarm lane before bulk at every cell,
+   *          address counter restored after alarm
+   *
+   * @param   char addr
+   * @param   unsigned char - max cells sent
+   *
+   * @return  char - PCF8574_SUCCESS if queue is empty, else PCF8574_PENDING
+   */
+  char HD44780_PCF8574_Pump (char, unsigned char);
+
+  /**
+   * @desc    LCD draw pre-encoded screen from flash in one TWI transaction
+   *
+   * @param   char
+   * @param   const uint8_t * - blob generated by tools/lcdscreen
+   *
+   * @return  void
+   */
+  void HD44780_PCF8574_DrawScreen (char, const uint8_t *);
+
+  /**
+   * @desc    LCD backlight on / off - pin P3 of every following port byte
+   *
+   * @param   char addr
+   * @param   char - 1 on, 0 off
+   *
+   * @return  void
+   */
+  #if !HD44780_SINGLE
+  void HD44780_PCF8574_Backlight (char, char);
+  #endif
+
   /**
    * @desc    Shift cursor / display to left / right
    *
@@ -215,4 +555,38 @@
    */
   char HD44780_PCF8574_Shift (char, char, char);
 
+  #if HD44780_SINGLE
+  /**
+   * @desc    LCD Send data 8 bits in 4 bits mode, inlined at call site
+   *
+   * @param   char - ignored, PCF8574_ADDRESS
+   * @param   char
+   *
+   * @return  void
+   */
+  static inline void HD44780_PCF8574_SendData (char addr, char data)
+  {
+    // latency histogram
+    PROF_ENTER(PROF_LCD_DATA);
+    // data -> pin RS High, fixed backlight
+    HD44780_PCF8574_Send_8bits_M4b_I(addr, data, PCF8574_PIN_RS | HD44780_BACKLIGHT_PIN);
+  }
+
+  /**
+   * @desc    LCD draw char, inlined at call site
+   *
+   * @param   char - ignored, PCF8574_ADDRESS
+   * @param   char
+   *
+   * @return  void
+   */
+  static inline void HD44780_PCF8574_DrawChar (char addr, char character)
+  {
+    // latency histogram
+    PROF_ENTER(PROF_LCD_DRAW_CHAR);
+    // Draw character
+    HD44780_PCF8574_SendData(addr, character);
+  }
+  #endif
+
 #endif
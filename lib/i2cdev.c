@@ -0,0 +1,248 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux userspace I2C - /dev/i2c-N, write-combined
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       20.12.2020
+ * @file        i2cdev.c
+ * @tested      Linux, i2c-dev
+ *
+ * @depend      i2cdev.h, expander.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include "expander.h"
+#include "i2cdev.h"
+
+#if EXPANDER == EXPANDER_LINUX
+
+#include <time.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// system calls, simulator links stand-ins of the same shape
+#ifndef I2CDEV_OPEN
+  #define I2CDEV_OPEN            open
+#endif
+#ifndef I2CDEV_IOCTL
+  #define I2CDEV_IOCTL           ioctl
+#endif
+int I2CDEV_OPEN (const char *, int, ...);
+int I2CDEV_IOCTL (int, unsigned long, ...);
+#ifdef I2CDEV_SLEEP
+void I2CDEV_SLEEP (double);
+#endif
+
+/** @var ioctl and open calls */
+unsigned long _i2cdev_syscalls = 0;
+
+/** @var failed transfers, e.g. no acknowledge */
+unsigned long _i2cdev_errors = 0;
+
+/** @var adapter, -1 = closed */
+static int _i2cdev_fd = -1;
+
+/** @var address and bytes of pending write */
+static unsigned char _i2cdev_addr;
+static unsigned char _i2cdev_buffer[I2CDEV_BUFFER];
+static unsigned int _i2cdev_length = 0;
+
+/** @var nesting of hold */
+static unsigned char _i2cdev_hold = 0;
+
+#ifndef I2CDEV_SLEEP
+/**
+ * @desc    Sleep
+ *
+ * @param   double - ns
+ *
+ * @return  void
+ */
+static void I2CDEV_Sleep (double ns)
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t) (ns / 1e9);
+  ts.tv_nsec = (long) (ns - ts.tv_sec * 1e9);
+  // interrupted sleep continues with rest
+  while (nanosleep(&ts, &ts));
+}
+#define I2CDEV_SLEEP             I2CDEV_Sleep
+#endif
+
+/**
+ * @desc    One message by I2C_RDWR ioctl
+ *
+ * @param   char addr
+ * @param   unsigned short - flags, I2C_M_RD for read
+ * @param   unsigned char * - bytes
+ * @param   unsigned int - count
+ *
+ * @return  char
+ */
+static char I2CDEV_Transfer (char addr, unsigned short flags, unsigned char *bytes, unsigned int count)
+{
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data data;
+
+  // START, address, bytes, STOP
+  msg.addr = addr;
+  msg.flags = flags;
+  msg.len = count;
+  msg.buf = bytes;
+  data.msgs = &msg;
+  data.nmsgs = 1;
+
+  _i2cdev_syscalls++;
+  if (I2CDEV_IOCTL(_i2cdev_fd, I2C_RDWR, &data) < 0) {
+    _i2cdev_errors++;
+    return I2CDEV_ERROR;
+  }
+
+  return I2CDEV_SUCCESS;
+}
+
+/**
+ * @desc    Open adapter, nothing if already open
+ *
+ * @param   const char * - device path
+ *
+ * @return  char
+ */
+char I2CDEV_Open (const char *path)
+{
+  // already open
+  if (_i2cdev_fd >= 0) {
+    return I2CDEV_SUCCESS;
+  }
+  _i2cdev_syscalls++;
+  _i2cdev_fd = I2CDEV_OPEN(path, O_RDWR);
+
+  return (_i2cdev_fd < 0) ? I2CDEV_ERROR : I2CDEV_SUCCESS;
+}
+
+/**
+ * @desc    Begin write transaction, other address sends buffer first
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void I2CDEV_Start (char addr)
+{
+  // one message has one address
+  if (_i2cdev_length && (_i2cdev_addr != (unsigned char) addr)) {
+    I2CDEV_Flush();
+  }
+  _i2cdev_addr = addr;
+}
+
+/**
+ * @desc    Append byte to buffer
+ *
+ * @param   unsigned char
+ *
+ * @return  void
+ */
+void I2CDEV_Write (unsigned char data)
+{
+  // full
+  if (_i2cdev_length == I2CDEV_BUFFER) {
+    I2CDEV_Flush();
+  }
+  _i2cdev_buffer[_i2cdev_length++] = data;
+}
+
+/**
+ * @desc    End write transaction, sent unless held
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void I2CDEV_Stop (void)
+{
+  // expander port keeps value between bytes, STOP carries no meaning
+  if (!_i2cdev_hold) {
+    I2CDEV_Flush();
+  }
+}
+
+/**
+ * @desc    Hold ended transactions in buffer, nested
+ *
+ * @param   char - 1 hold, 0 release and send
+ *
+ * @return  void
+ */
+void I2CDEV_Hold (char hold)
+{
+  if (hold) {
+    _i2cdev_hold++;
+  // outermost release
+  } else if (_i2cdev_hold && !--_i2cdev_hold) {
+    I2CDEV_Flush();
+  }
+}
+
+/**
+ * @desc    Send buffer by one ioctl
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char I2CDEV_Flush (void)
+{
+  unsigned int length = _i2cdev_length;
+
+  // nothing pending
+  if (!length) {
+    return I2CDEV_SUCCESS;
+  }
+  _i2cdev_length = 0;
+
+  return I2CDEV_Transfer(_i2cdev_addr, 0, _i2cdev_buffer, length);
+}
+
+/**
+ * @desc    Read one byte, buffer is sent first
+ *
+ * @param   char addr
+ * @param   unsigned char * - byte
+ *
+ * @return  char
+ */
+char I2CDEV_Read (char addr, unsigned char *data)
+{
+  // writes before read, e.g. E high
+  I2CDEV_Flush();
+
+  return I2CDEV_Transfer(addr, I2C_M_RD, data, 1);
+}
+
+/**
+ * @desc    Wait, longer than one byte on bus sends buffer first
+ *
+ * @param   double - ns
+ *
+ * @return  void
+ */
+void I2CDEV_Delay (double ns)
+{
+  // next byte comes one byte time later anyway
+  if (ns <= I2CDEV_BYTE_NS) {
+    return;
+  }
+  // ioctl returns after STOP, wait starts then
+  I2CDEV_Flush();
+  I2CDEV_SLEEP(ns);
+}
+
+#endif
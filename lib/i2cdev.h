@@ -0,0 +1,127 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux userspace I2C - /dev/i2c-N, write-combined
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       20.12.2020
+ * @file        i2cdev.h
+ * @tested      Linux, i2c-dev
+ *
+ * @depend      linux/i2c-dev.h
+ * ---------------------------------------------------------------+
+ * @usage       make linux, see README
+ *
+ *              Bytes of START..STOP sequence are collected in buffer and
+ *              sent by one I2C_RDWR ioctl. Transactions of one call are
+ *              joined while held, e.g. whole DrawString is one syscall.
+ *              Waits shorter than one byte on bus are covered by next
+ *              byte, longer waits send buffer first, then sleep.
+ */
+
+/** @definition */
+#ifndef __I2CDEV_H__
+#define __I2CDEV_H__
+
+  // @const adapter device
+  #ifndef I2CDEV_PATH
+    #define I2CDEV_PATH          "/dev/i2c-1"
+  #endif
+  // @const fastest possible bus clock of adapter in kHz
+  #ifndef I2CDEV_KHZ
+    #define I2CDEV_KHZ           400
+  #endif
+  // @const bytes of one ioctl, kernel limit is 8192
+  #ifndef I2CDEV_BUFFER
+    #define I2CDEV_BUFFER        256
+  #endif
+
+  // @const one byte with acknowledge on bus, shortest
+  #define I2CDEV_BYTE_NS         (9 * 1000000.0 / I2CDEV_KHZ)
+
+  // definitions
+  #define I2CDEV_SUCCESS         0
+  #define I2CDEV_ERROR           1
+
+  /** @var ioctl and open calls */
+  extern unsigned long _i2cdev_syscalls;
+
+  /** @var failed transfers, e.g. no acknowledge */
+  extern unsigned long _i2cdev_errors;
+
+  /**
+   * @desc    Open adapter, nothing if already open
+   *
+   * @param   const char * - device path
+   *
+   * @return  char
+   */
+  char I2CDEV_Open (const char *);
+
+  /**
+   * @desc    Begin write transaction, other address sends buffer first
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void I2CDEV_Start (char);
+
+  /**
+   * @desc    Append byte to buffer
+   *
+   * @param   unsigned char
+   *
+   * @return  void
+   */
+  void I2CDEV_Write (unsigned char);
+
+  /**
+   * @desc    End write transaction, sent unless held
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void I2CDEV_Stop (void);
+
+  /**
+   * @desc    Hold ended transactions in buffer, nested
+   *
+   * @param   char - 1 hold, 0 release and send
+   *
+   * @return  void
+   */
+  void I2CDEV_Hold (char);
+
+  /**
+   * @desc    Send buffer by one ioctl
+   *
+   * @param   void
+   *
+   * @return  char
+   */
+  char I2CDEV_Flush (void);
+
+  /**
+   * @desc    Read one byte, buffer is sent first
+   *
+   * @param   char addr
+   * @param   unsigned char * - byte
+   *
+   * @return  char
+   */
+  char I2CDEV_Read (char, unsigned char *);
+
+  /**
+   * @desc    Wait, longer than one byte on bus sends buffer first
+   *
+   * @param   double - ns
+   *
+   * @return  void
+   */
+  void I2CDEV_Delay (double);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Idle sleep during bus and controller waits
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       21.12.2020
+ * @file        idle.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      idle.h, twi.h
+ * ---------------------------------------------------------------+
+ */
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "idle.h"
+
+// compiled only with make SLEEP=1
+#if IDLE_SLEEP
+
+#include "twi.h"
+
+/** @var sleeping waits, host readable */
+IDLE_Stats _idle_stats;
+
+/** @var Timer2 compare reached */
+static volatile char _idle_match = 0;
+
+/**
+ * @desc    Start Timer1 for accounting, sleep mode idle
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void IDLE_Init (void)
+{
+  // normal mode, the same as PROF / STATS
+  TCCR1A = 0;
+  // prescaler 8, free running
+  TCCR1B = (1 << CS11);
+  // timers and TWI keep running
+  set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+#if IDLE_TWI
+/**
+ * @desc    TWI interrupt - wakes core only, TWINT stays set for driver
+ *
+ * @param   TWI_vect
+ *
+ * @return  void
+ */
+ISR(TWI_vect)
+{
+  // TWINT written 0 keeps flag, next TWINT clear enables again
+  TWI_TWCR &= (unsigned char) ~((1 << TWIE) | (1 << TWINT));
+}
+#endif
+
+/**
+ * @desc    Sleep till TWINT, TWI_vect wakes core
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void IDLE_WaitTWI (void)
+{
+  unsigned int start = TCNT1;
+
+  // nothing wakes core, spin
+  if (!(SREG & (1 << SREG_I))) {
+    while (!(TWI_TWCR & (1 << TWINT))) {
+      TWI_STATS_INC(waits);
+    }
+    return;
+  }
+  // TWINT checked with interrupts off, no wake up is lost
+  cli();
+  while (!(TWI_TWCR & (1 << TWINT))) {
+    TWI_STATS_INC(waits);
+    sleep_enable();
+    // sei is executed before sleep
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    cli();
+  }
+  sei();
+  // accounting
+  _idle_stats.slept += (unsigned int) (TCNT1 - start);
+  _idle_stats.waits++;
+}
+
+/**
+ * @desc    Timer2 compare match A - wakes core from delay
+ *
+ * @param   TIMER2_COMPA_vect
+ *
+ * @return  void
+ */
+ISR(TIMER2_COMPA_vect)
+{
+  // delay step done
+  _idle_match = 1;
+}
+
+/**
+ * @desc    Sleep at least us, Timer2 compare wakes core. Tick count
+ *          rounded up plus one tick of unknown prescaler phase
+ *
+ * @param   unsigned long int - us
+ *
+ * @return  void
+ */
+void IDLE_DelayUs (unsigned long int us)
+{
+  unsigned int start = TCNT1;
+  unsigned long int ticks = (us + IDLE_TICK_US - 1) / IDLE_TICK_US + 1;
+  unsigned char step;
+
+  // CTC, compare interrupt
+  TCCR2A = (1 << WGM21);
+  TIMSK2 = (1 << OCIE2A);
+  while (ticks > 0) {
+    // up to 256 ticks per compare
+    step = (ticks > 256) ? 255 : (unsigned char) (ticks - 1);
+    ticks -= (unsigned int) step + 1;
+    _idle_match = 0;
+    // from 0 to OCR2A
+    TCNT2 = 0;
+    OCR2A = step;
+    TIFR2 = (1 << OCF2A);
+    TCCR2B = IDLE_TCCR2B;
+    // flag checked with interrupts off, no wake up is lost
+    cli();
+    while (!_idle_match) {
+      sleep_enable();
+      // sei is executed before sleep
+      sei();
+      sleep_cpu();
+      sleep_disable();
+      cli();
+    }
+    sei();
+    // stop
+    TCCR2B = 0;
+  }
+  TIMSK2 = 0;
+  // accounting
+  _idle_stats.slept += (unsigned int) (TCNT1 - start);
+  _idle_stats.waits++;
+}
+
+#endif
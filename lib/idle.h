@@ -0,0 +1,108 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Idle sleep during bus and controller waits
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       21.12.2020
+ * @file        idle.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      avr/io.h, avr/sleep.h, expander.h
+ * ---------------------------------------------------------------+
+ * @usage       make SLEEP=1
+ *
+ *              Core sleeps in idle mode instead of spinning:
+ *              TWI byte   - TWIE set with every TWINT clear, TWI_vect
+ *                           wakes core, TWI_WAIT_TILL_TWINT_IS_SET
+ *              wait >= IDLE_MIN_US - Timer2 CTC compare wakes core,
+ *                           IDLE_DELAY_US / IDLE_DELAY_MS
+ *              Interrupts disabled - busy wait as before.
+ *              Time of sleeping waits is counted in Timer1 ticks,
+ *              started by IDLE_Init or PROF_Init.
+ */
+
+/** @definition */
+#ifndef __IDLE_H__
+#define __IDLE_H__
+
+#include <util/delay.h>
+#include <avr/io.h>
+#include "expander.h"
+
+  // idle sleep in waits, make SLEEP=1
+  #ifndef IDLE_SLEEP
+    #define IDLE_SLEEP           0
+  #endif
+
+  // @const shorter waits stay busy, wake up and interrupt cost more
+  #ifndef IDLE_MIN_US
+    #define IDLE_MIN_US          20
+  #endif
+
+  // @const TWI master waits sleep, backend on TWI peripheral
+  #define IDLE_TWI               (IDLE_SLEEP && ((EXPANDER == EXPANDER_PCF8574) || \
+                                  (EXPANDER == EXPANDER_PCF8574A) || (EXPANDER == EXPANDER_MCP23008)))
+
+  // @const Timer2 prescaler 64, CTC mode
+  //  @8MHz  -> 1 tick = 8 us, max 2048 us per compare
+  //  @16MHz -> 1 tick = 4 us, max 1024 us per compare
+  #define IDLE_TCCR2B            ((1 << CS22))
+  #define IDLE_TICK_US           ((unsigned int) (64000000UL / F_CPU))
+
+  #if IDLE_SLEEP && ((64000000UL % F_CPU) != 0)
+    #error "SLEEP needs F_CPU dividing 64 MHz, whole us Timer2 tick"
+  #endif
+
+  #if IDLE_SLEEP
+    // sleep if interrupts can wake core, constant US for busy wait
+    #define IDLE_DELAY_US(US)    { if (((US) >= IDLE_MIN_US) && (SREG & (1 << SREG_I))) { IDLE_DelayUs(US); } else { _delay_us(US); } }
+    #define IDLE_DELAY_MS(MS)    { if (SREG & (1 << SREG_I)) { IDLE_DelayUs((MS) * 1000UL); } else { _delay_ms(MS); } }
+  #else
+    #define IDLE_DELAY_US(US)    { _delay_us(US); }
+    #define IDLE_DELAY_MS(MS)    { _delay_ms(MS); }
+  #endif
+
+  /** @struct sleeping waits */
+  typedef struct {
+    // Timer1 ticks spent in sleeping waits
+    unsigned long int slept;
+    // number of sleeping waits
+    unsigned long int waits;
+  } IDLE_Stats;
+
+  #if IDLE_SLEEP
+    /* @var sleeping waits, host readable */
+    extern IDLE_Stats _idle_stats;
+  #endif
+
+  /**
+   * @desc    Start Timer1 for accounting, sleep mode idle
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void IDLE_Init (void);
+
+  /**
+   * @desc    Sleep till TWINT, TWI_vect wakes core
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void IDLE_WaitTWI (void);
+
+  /**
+   * @desc    Sleep at least us, Timer2 compare wakes core
+   *
+   * @param   unsigned long int - us
+   *
+   * @return  void
+   */
+  void IDLE_DelayUs (unsigned long int);
+
+#endif
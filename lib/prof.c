@@ -0,0 +1,260 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Per call latency histograms with Timer1 timestamps
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       14.12.2020
+ * @file        prof.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      prof.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include "prof.h"
+
+// compiled only with make PROF=1
+#if PROF
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "uart.h"
+
+/** @var histograms, host readable */
+PROF_Site _prof_sites[PROF_SITES];
+
+/** @var sites of running calls, outermost first */
+unsigned char _prof_stack[PROF_DEPTH];
+
+/** @var number of running calls */
+unsigned char _prof_depth = 0;
+
+/** @var site names, same order as enum */
+static const char _prof_names[PROF_SITES][PROF_NAME] PROGMEM = {
+  "Init", "InitAsync", "InitWarm", "E_pulse", "Send_4bits", "Send_8bits",
+  "CheckBF", "ReadStatus", "ReadData", "Recover", "Scrub",
+  "SendInstruction", "SendInstructions", "SendData", "PositionXY",
+  "DisplayClear", "DisplayClearAsync", "DisplayOn", "CursorOn", "CursorBlink",
+  "DrawChar", "DrawString", "DrawStrings", "DrawScreen", "UpdateString", "DrawImage", "Pump", "Backlight", "Shift",
+  "TWI_Init", "TWI_MT_Start", "TWI_SLAW", "TWI_SLAR", "TWI_Byte",
+  "TWI_Receive", "TWI_Stop", "TWI_Transfer",
+  "user"
+};
+
+/**
+ * @desc    Start Timer1, zero histograms
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void PROF_Init (void)
+{
+  // normal mode
+  TCCR1A = 0;
+  // prescaler 8, free running
+  TCCR1B = (1 << CS11);
+  // histograms
+  PROF_Reset();
+}
+
+/**
+ * @desc    Zero histograms
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void PROF_Reset (void)
+{
+  unsigned char i;
+
+  // all sites
+  memset(_prof_sites, 0, sizeof(_prof_sites));
+  // min not seen yet
+  for (i = 0; i < PROF_SITES; i++) {
+    _prof_sites[i].min = 0xFFFF;
+  }
+}
+
+/**
+ * @desc    Call entry, used by PROF_ENTER
+ *
+ * @param   unsigned char - site
+ *
+ * @return  PROF_Call
+ */
+PROF_Call PROF_Enter (unsigned char site)
+{
+  PROF_Call call;
+
+  // site
+  call.site = site;
+  // call stack
+  if (_prof_depth < PROF_DEPTH) {
+    _prof_stack[_prof_depth] = site;
+  }
+  _prof_depth++;
+#if IDLE_SLEEP
+  // sleeping waits so far
+  call.slept = _idle_stats.slept;
+#endif
+  // timestamp as late as possible
+  call.start = TCNT1;
+
+  return call;
+}
+
+/**
+ * @desc    Call exit, used by PROF_ENTER
+ *
+ * @param   PROF_Call *
+ *
+ * @return  void
+ */
+void PROF_Exit (PROF_Call *call)
+{
+  // timestamp as soon as possible, 16 bit wrap is fine
+  unsigned int ticks = TCNT1 - call->start;
+  PROF_Site *site = &_prof_sites[call->site];
+  unsigned int rest = ticks;
+  unsigned char b = 0;
+
+  // call stack
+  _prof_depth--;
+  // log2 bucket
+  while ((rest > 1) && (b < (PROF_BUCKETS - 1))) {
+    rest >>= 1;
+    b++;
+  }
+  site->bucket[b]++;
+  site->count++;
+  // extremes
+  if (ticks < site->min) {
+    site->min = ticks;
+  }
+  if (ticks > site->max) {
+    site->max = ticks;
+  }
+#if IDLE_SLEEP
+  // sleeping waits of call, nested calls included
+  site->ticks += ticks;
+  site->slept += _idle_stats.slept - call->slept;
+#endif
+}
+
+/**
+ * @desc    Percentile of site from histogram, upper bound of bucket
+ *
+ * @param   unsigned char - site
+ * @param   unsigned char - percent 1 .. 100
+ *
+ * @return  unsigned int - ticks
+ */
+unsigned int PROF_Percentile (unsigned char site, unsigned char percent)
+{
+  PROF_Site *s = &_prof_sites[site];
+  unsigned long int rank = (s->count * percent + 99) / 100;
+  unsigned long int sum = 0;
+  unsigned char b;
+
+  // walk buckets till rank
+  for (b = 0; b < (PROF_BUCKETS - 1); b++) {
+    sum += s->bucket[b];
+    if (sum >= rank) {
+      // upper bound, never above max
+      return (((2U << b) - 1) < s->max) ? ((2U << b) - 1) : s->max;
+    }
+  }
+  // last bucket is open
+  return s->max;
+}
+
+/**
+ * @desc    Active part of time in calls of site, rest slept in waits
+ *
+ * @param   unsigned char - site
+ *
+ * @return  unsigned char - percent, 100 without make SLEEP=1
+ */
+unsigned char PROF_Active (unsigned char site)
+{
+#if IDLE_SLEEP
+  PROF_Site *s = &_prof_sites[site];
+
+  // not called
+  if ((s->ticks == 0) || (s->slept >= s->ticks)) {
+    return (s->ticks == 0) ? 100 : 0;
+  }
+  // rounded up, any awake time shows
+  return 100 - (unsigned char) ((s->slept * 100) / s->ticks);
+#else
+  // always awake
+  (void) site;
+  return 100;
+#endif
+}
+
+/**
+ * @desc    Name of site
+ *
+ * @param   unsigned char - site
+ * @param   char * - buffer, PROF_NAME chars
+ *
+ * @return  char *
+ */
+char *PROF_Name (unsigned char site, char *name)
+{
+  // from flash
+  return strcpy_P(name, _prof_names[site]);
+}
+
+/**
+ * @desc    Print min, max and percentiles of called sites over UART
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void PROF_Dump (void)
+{
+  char name[PROF_NAME];
+  char str[80];
+  unsigned char i;
+  PROF_Site *s;
+
+  // header
+#if IDLE_SLEEP
+  UART_PutString("\r\nsite               calls    min    p50    p90    p99    max [us] active [%]\r\n");
+#else
+  UART_PutString("\r\nsite               calls    min    p50    p90    p99    max [us]\r\n");
+#endif
+  // called sites only
+  for (i = 0; i < PROF_SITES; i++) {
+    s = &_prof_sites[i];
+    if (s->count == 0) {
+      continue;
+    }
+    PROF_Name(i, name);
+    sprintf(str, "%-17s %7lu %6u %6u %6u %6u %6u", name, s->count,
+      s->min / PROF_TICKS_PER_US,
+      PROF_Percentile(i, 50) / PROF_TICKS_PER_US,
+      PROF_Percentile(i, 90) / PROF_TICKS_PER_US,
+      PROF_Percentile(i, 99) / PROF_TICKS_PER_US,
+      s->max / PROF_TICKS_PER_US);
+    UART_PutString(str);
+#if IDLE_SLEEP
+    // awake part, rest slept in waits
+    sprintf(str, " %10u", PROF_Active(i));
+    UART_PutString(str);
+#endif
+    UART_PutString("\r\n");
+  }
+}
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Per call latency histograms with Timer1 timestamps
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       14.12.2020
+ * @file        prof.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      avr/io.h, idle.h
+ * ---------------------------------------------------------------+
+ * @usage       make PROF=1
+ *
+ *              PROF_ENTER(site) at the top of function body - time
+ *              from here to any return is added to histogram of site.
+ *              Nested calls are included in time of caller.
+ *              Table _prof_sites is readable by debugger or simulator,
+ *              _prof_stack holds sites of running calls.
+ */
+
+/** @definition */
+#ifndef __PROF_H__
+#define __PROF_H__
+
+#include <avr/io.h>
+#include "idle.h"
+
+  // latency histograms, make PROF=1
+  #ifndef PROF
+    #define PROF                 0
+  #endif
+
+  // @const Timer1 prescaler 8, free running
+  //  @8MHz  -> 1 tick = 1 us
+  //  @16MHz -> 1 tick = 0.5 us
+  #define PROF_TICKS_PER_US      ((unsigned int) (F_CPU / 8 / 1000000))
+  // @const log2 buckets, bucket b = [2^b; 2^(b+1)) ticks, last one open
+  #define PROF_BUCKETS           12
+  // @const max depth of call stack
+  #define PROF_DEPTH             8
+  // @const max length of site name including '\0'
+  #define PROF_NAME              18
+
+  // @const call sites
+  enum {
+    // HD44780 driver
+    PROF_LCD_INIT,
+    PROF_LCD_INIT_ASYNC,
+    PROF_LCD_INIT_WARM,
+    PROF_LCD_E_PULSE,
+    PROF_LCD_SEND_4BITS,
+    PROF_LCD_SEND_8BITS,
+    PROF_LCD_CHECK_BF,
+    PROF_LCD_READ_STATUS,
+    PROF_LCD_READ_DATA,
+    PROF_LCD_RECOVER,
+    PROF_LCD_SCRUB,
+    PROF_LCD_INSTRUCTION,
+    PROF_LCD_INSTRUCTIONS,
+    PROF_LCD_DATA,
+    PROF_LCD_POSITION_XY,
+    PROF_LCD_CLEAR,
+    PROF_LCD_CLEAR_ASYNC,
+    PROF_LCD_DISPLAY_ON,
+    PROF_LCD_CURSOR_ON,
+    PROF_LCD_CURSOR_BLINK,
+    PROF_LCD_DRAW_CHAR,
+    PROF_LCD_DRAW_STRING,
+    PROF_LCD_DRAW_STRINGS,
+    PROF_LCD_DRAW_SCREEN,
+    PROF_LCD_UPDATE_STRING,
+    PROF_LCD_DRAW_IMAGE,
+    PROF_LCD_PUMP,
+    PROF_LCD_BACKLIGHT,
+    PROF_LCD_SHIFT,
+    // TWI
+    PROF_TWI_INIT,
+    PROF_TWI_START,
+    PROF_TWI_SLAW,
+    PROF_TWI_SLAR,
+    PROF_TWI_BYTE,
+    PROF_TWI_RECEIVE,
+    PROF_TWI_STOP,
+    PROF_TWI_TRANSFER,
+    // application, e.g. PositionXY + DrawString in control loop
+    PROF_USER,
+    // number of sites
+    PROF_SITES
+  };
+
+  /** @struct histogram of one call site */
+  typedef struct {
+    // number of calls
+    unsigned long int count;
+    // shortest call in ticks
+    unsigned int min;
+    // longest call in ticks, calls over 65535 ticks wrap
+    unsigned int max;
+    // log2 histogram
+    unsigned int bucket[PROF_BUCKETS];
+  #if IDLE_SLEEP
+    // ticks of all calls
+    unsigned long int ticks;
+    // ticks slept in waits of all calls
+    unsigned long int slept;
+  #endif
+  } PROF_Site;
+
+  /** @struct running call */
+  typedef struct {
+    // call site
+    unsigned char site;
+    // Timer1 at entry
+    unsigned int start;
+  #if IDLE_SLEEP
+    // slept ticks at entry
+    unsigned long int slept;
+  #endif
+  } PROF_Call;
+
+  #if PROF && (F_CPU < 8000000)
+    #error "PROF needs F_CPU >= 8 MHz, 1 us Timer1 tick"
+  #endif
+
+  #if PROF
+    // time till end of enclosing block, any return counts
+    #define PROF_ENTER(SITE)     PROF_Call _prof_call __attribute__ ((cleanup (PROF_Exit))) = PROF_Enter(SITE)
+    /* @var histograms, host readable */
+    extern PROF_Site _prof_sites[PROF_SITES];
+    /* @var sites of running calls, outermost first */
+    extern unsigned char _prof_stack[PROF_DEPTH];
+    /* @var number of running calls, can exceed PROF_DEPTH */
+    extern unsigned char _prof_depth;
+  #else
+    #define PROF_ENTER(SITE)
+  #endif
+
+  /**
+   * @desc    Start Timer1, zero histograms
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void PROF_Init (void);
+
+  /**
+   * @desc    Zero histograms
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void PROF_Reset (void);
+
+  /**
+   * @desc    Call entry, used by PROF_ENTER
+   *
+   * @param   unsigned char - site
+   *
+   * @return  PROF_Call
+   */
+  PROF_Call PROF_Enter (unsigned char);
+
+  /**
+   * @desc    Call exit, used by PROF_ENTER
+   *
+   * @param   PROF_Call *
+   *
+   * @return  void
+   */
+  void PROF_Exit (PROF_Call *);
+
+  /**
+   * @desc    Percentile of site from histogram, upper bound of bucket
+   *
+   * @param   unsigned char - site
+   * @param   unsigned char - percent 1 .. 100
+   *
+   * @return  unsigned int - ticks
+   */
+  unsigned int PROF_Percentile (unsigned char, unsigned char);
+
+  /**
+   * @desc    Active part of time in calls of site, rest slept in waits
+   *
+   * @param   unsigned char - site
+   *
+   * @return  unsigned char - percent, 100 without make SLEEP=1
+   */
+  unsigned char PROF_Active (unsigned char);
+
+  /**
+   * @desc    Name of site
+   *
+   * @param   unsigned char - site
+   * @param   char * - buffer, PROF_NAME chars
+   *
+   * @return  char *
+   */
+  char *PROF_Name (unsigned char, char *);
+
+  /**
+   * @desc    Print min, max and percentiles of called sites over UART
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void PROF_Dump (void);
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Protothreads - stackless resumable functions
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       04.12.2020
+ * @file        pt.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      scheduler.h
+ * @inspir      http://dunkels.com/adam/pt/
+ * ---------------------------------------------------------------+
+ */
+
+/** @definition */
+#ifndef __PT_H__
+#define __PT_H__
+
+#include "scheduler.h"
+
+  // @const return values of protothread
+  #define PT_ENDED               0
+  #define PT_WAITING             2
+
+  /** @struct protothread state */
+  typedef struct {
+    // local continuation - line to resume at, 0 = start
+    unsigned int lc;
+    // timestamp of wait start in ms
+    unsigned int stamp;
+  } PT_Thread;
+
+  // Local variables of protothread function are not kept between calls.
+  // Switch statement cannot be used inside protothread body.
+
+  // begin of protothread body
+  #define PT_BEGIN(PT)               switch ((PT)->lc) { case 0:
+
+  // yield till condition is true, then continue
+  #define PT_WAIT_UNTIL(PT, COND)    (PT)->lc = __LINE__; case __LINE__: if (!(COND)) { return PT_WAITING; }
+
+  // yield for at least MS milliseconds, +1 tick covers tick phase
+  #define PT_WAIT_MS(PT, MS)         (PT)->stamp = SCHED_Millis(); PT_WAIT_UNTIL(PT, (unsigned int) (SCHED_Millis() - (PT)->stamp) > (MS))
+
+  // restart protothread
+  #define PT_RESTART(PT)             { (PT)->lc = 0; return PT_WAITING; }
+
+  // end of protothread body
+  #define PT_END(PT)                 } (PT)->lc = 0; return PT_ENDED;
+
+#endif
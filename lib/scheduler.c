@@ -0,0 +1,224 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Cooperative task scheduler with Timer0 ms tick
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       02.12.2020
+ * @file        scheduler.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      scheduler.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "scheduler.h"
+
+/** @var tasks */
+static volatile SCHED_Task _sched_tasks[SCHED_MAX_TASKS];
+
+/** @var milliseconds counter */
+static volatile unsigned int _sched_millis = 0;
+
+/**
+ * @desc   Scheduler init - Timer0 1 ms tick, sleep mode idle
+ *
+ * @param  void
+ *
+ * @return void
+ */
+void SCHED_Init (void)
+{
+  unsigned char i;
+  // clear task table
+  for (i = 0; i < SCHED_MAX_TASKS; i++) {
+    // free slot
+    _sched_tasks[i].task = 0;
+  }
+  // Timer0 CTC mode
+  TCCR0A = (1 << WGM01);
+  // compare value for 1 ms
+  OCR0A = SCHED_OCR0A;
+  // enable compare match A interrupt
+  TIMSK0 |= (1 << OCIE0A);
+  // prescaler 64 -> start timer
+  TCCR0B = (1 << CS01) | (1 << CS00);
+  // idle keeps timers and TWI running
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  // enable global interrupts
+  sei();
+}
+
+/**
+ * @desc   Add task
+ *
+ * @param  void (*)(void) - task function
+ * @param  unsigned int - delay in ticks before first run, 0 = next dispatch
+ * @param  unsigned int - period in ticks, 0 = one-shot task
+ *
+ * @return char - task id or SCHED_NO_TASK
+ */
+char SCHED_AddTask (void (*task)(void), unsigned int delay, unsigned int period)
+{
+  unsigned char i;
+  // find free slot
+  for (i = 0; i < SCHED_MAX_TASKS; i++) {
+    // free slot found
+    if (_sched_tasks[i].task == 0) {
+      // tick isr must not see half written slot
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // release immediately or after delay
+        if (delay == 0) {
+          _sched_tasks[i].run = 1;
+          _sched_tasks[i].delay = period;
+        } else {
+          _sched_tasks[i].run = 0;
+          _sched_tasks[i].delay = delay;
+        }
+        _sched_tasks[i].period = period;
+        _sched_tasks[i].task = task;
+      }
+      // task id
+      return i;
+    }
+  }
+  // table full
+  return SCHED_NO_TASK;
+}
+
+/**
+ * @desc   Delete task
+ *
+ * @param  char - task id
+ *
+ * @return char
+ */
+char SCHED_DeleteTask (char id)
+{
+  // check id
+  if ((id < 0) || (id >= SCHED_MAX_TASKS) || (_sched_tasks[(unsigned char) id].task == 0)) {
+    // error
+    return SCHED_ERROR;
+  }
+  // free slot
+  _sched_tasks[(unsigned char) id].task = 0;
+  // success
+  return SCHED_SUCCESS;
+}
+
+/**
+ * @desc   Dispatch released tasks, then sleep till next tick
+ *
+ * @param  void
+ *
+ * @return void
+ */
+void SCHED_Dispatch (void)
+{
+  unsigned char i;
+  char pending = 0;
+  void (*task)(void);
+
+  // run released tasks
+  for (i = 0; i < SCHED_MAX_TASKS; i++) {
+    // released task
+    if ((_sched_tasks[i].task != 0) && (_sched_tasks[i].run > 0)) {
+      // local copy, one-shot task may reuse its slot
+      task = _sched_tasks[i].task;
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // consume release
+        _sched_tasks[i].run--;
+      }
+      // one-shot task free its slot before run
+      if (_sched_tasks[i].period == 0) {
+        _sched_tasks[i].task = 0;
+      }
+      // run task
+      task();
+    }
+  }
+
+  // sleep only if nothing was released meanwhile
+  cli();
+  for (i = 0; i < SCHED_MAX_TASKS; i++) {
+    // released task
+    if ((_sched_tasks[i].task != 0) && (_sched_tasks[i].run > 0)) {
+      pending = 1;
+    }
+  }
+  if (!pending) {
+    // sleep enable
+    sleep_enable();
+    // sei is executed before sleep, no wakeup is lost
+    sei();
+    // sleep till next interrupt
+    sleep_cpu();
+    // sleep disable
+    sleep_disable();
+  }
+  sei();
+}
+
+/**
+ * @desc   Milliseconds since SCHED_Init, overflows after 65535 ms
+ *
+ * @param  void
+ *
+ * @return unsigned int
+ */
+unsigned int SCHED_Millis (void)
+{
+  unsigned int millis;
+  // 16 bit read is not atomic
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    millis = _sched_millis;
+  }
+  // milliseconds
+  return millis;
+}
+
+/**
+ * @desc   Tick running - SCHED_Init called, Timer0 interrupt enabled
+ *
+ * @param  void
+ *
+ * @return char - 0 if SCHED_Millis stands still
+ */
+char SCHED_Running (void)
+{
+  // compare interrupt and prescaler set by SCHED_Init
+  return (TIMSK0 & (1 << OCIE0A)) && (TCCR0B & ((1 << CS02) | (1 << CS01) | (1 << CS00)));
+}
+
+/**
+ * @desc   Timer0 compare match A - 1 ms tick
+ *
+ * @param  TIMER0_COMPA_vect
+ *
+ * @return void
+ */
+ISR(TIMER0_COMPA_vect)
+{
+  unsigned char i;
+  // tick
+  _sched_millis++;
+  // release tasks
+  for (i = 0; i < SCHED_MAX_TASKS; i++) {
+    // active task waiting for release
+    if ((_sched_tasks[i].task != 0) && (_sched_tasks[i].delay > 0)) {
+      // delay elapsed
+      if (--_sched_tasks[i].delay == 0) {
+        // release
+        _sched_tasks[i].run++;
+        // reload periodic task, one-shot stays at 0
+        _sched_tasks[i].delay = _sched_tasks[i].period;
+      }
+    }
+  }
+}
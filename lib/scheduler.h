@@ -0,0 +1,105 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Cooperative task scheduler with Timer0 ms tick
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       02.12.2020
+ * @file        scheduler.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      avr/io.h, avr/interrupt.h, avr/sleep.h
+ * ---------------------------------------------------------------+
+ */
+
+/** @definition */
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <avr/io.h>
+
+  // @const max number of tasks
+  #define SCHED_MAX_TASKS        8
+  // @const tick in ms
+  #define SCHED_TICK_MS          1
+  // @const Timer0 prescaler 64, CTC mode, compare value for 1 ms tick
+  //  @8MHz  -> 8 000 000 / 64 / 1000 - 1 = 124
+  //  @16MHz -> 16 000 000 / 64 / 1000 - 1 = 249
+  #define SCHED_OCR0A            ((F_CPU / 64 / 1000) - 1)
+
+  // definitions
+  #define SCHED_SUCCESS          0
+  #define SCHED_ERROR            1
+  #define SCHED_NO_TASK         -1
+
+  /** @struct task */
+  typedef struct {
+    // task function, 0 = free slot
+    void (*task)(void);
+    // ticks till next release
+    unsigned int delay;
+    // period in ticks, 0 = one-shot task
+    unsigned int period;
+    // number of pending releases
+    unsigned char run;
+  } SCHED_Task;
+
+  /**
+   * @desc   Scheduler init - Timer0 1 ms tick, sleep mode idle
+   *
+   * @param  void
+   *
+   * @return void
+   */
+  void SCHED_Init (void);
+
+  /**
+   * @desc   Add task
+   *
+   * @param  void (*)(void) - task function
+   * @param  unsigned int - delay in ticks before first run, 0 = next dispatch
+   * @param  unsigned int - period in ticks, 0 = one-shot task
+   *
+   * @return char - task id or SCHED_NO_TASK
+   */
+  char SCHED_AddTask (void (*)(void), unsigned int, unsigned int);
+
+  /**
+   * @desc   Delete task
+   *
+   * @param  char - task id
+   *
+   * @return char
+   */
+  char SCHED_DeleteTask (char);
+
+  /**
+   * @desc   Dispatch released tasks, then sleep till next tick
+   *
+   * @param  void
+   *
+   * @return void
+   */
+  void SCHED_Dispatch (void);
+
+  /**
+   * @desc   Milliseconds since SCHED_Init, overflows after 65535 ms
+   *
+   * @param  void
+   *
+   * @return unsigned int
+   */
+  unsigned int SCHED_Millis (void);
+
+  /**
+   * @desc   Tick running - SCHED_Init called, Timer0 interrupt enabled
+   *
+   * @param  void
+   *
+   * @return char - 0 if SCHED_Millis stands still
+   */
+  char SCHED_Running (void);
+
+#endif
@@ -0,0 +1,263 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Hot path counters dump over UART
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       13.12.2020
+ * @file        stats.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      stats.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+// compiled only with make STATS=1 or PROF=1
+#if STATS_UART
+
+#include "scheduler.h"
+#include "uart.h"
+
+#if TWI_STATS && HD44780_STATS
+
+/** @var counters at last dump */
+static TWI_Stats _stats_twi;
+
+/** @var counters at last dump */
+static HD44780_PCF8574_Stats _stats_lcd;
+
+/** @var contention at last dump */
+static TWI_Contention _stats_contention;
+
+/** @var ms of last dump */
+static unsigned int _stats_stamp = 0;
+
+#endif
+
+/** @var ms since last periodic dump */
+static unsigned int _stats_elapsed = 0;
+
+#if TWI_STATS && HD44780_STATS
+
+/**
+ * @desc    Print one counter with rate per second
+ *
+ * @param   char * - name
+ * @param   unsigned long int - counter now
+ * @param   unsigned long int - counter at last dump
+ * @param   unsigned int - ms since last dump
+ *
+ * @return  void
+ */
+static void STATS_Line (char *name, unsigned long int now, unsigned long int last, unsigned int ms)
+{
+  char str[48];
+
+  // avoid division by zero
+  if (ms == 0) {
+    ms = 1;
+  }
+  // total, per second
+  sprintf(str, "%-12s %10lu %8lu/s\r\n", name, now, ((now - last) * 1000UL) / ms);
+  UART_PutString(str);
+}
+
+/**
+ * @desc    Print counters and rates per second since last dump
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STATS_Dump (void)
+{
+  char str[32];
+  unsigned char i;
+  unsigned int now = SCHED_Millis();
+  unsigned int ms = now - _stats_stamp;
+
+  // header
+  sprintf(str, "\r\n-- %u ms\r\n", ms);
+  UART_PutString(str);
+  // TWI
+  STATS_Line("twi.starts", _twi_stats.starts, _stats_twi.starts, ms);
+  STATS_Line("twi.bytes", _twi_stats.bytes, _stats_twi.bytes, ms);
+  STATS_Line("twi.waits", _twi_stats.waits, _stats_twi.waits, ms);
+  // other masters, backoff in us
+  STATS_Line("twi.lost", _twi_contention.lost, _stats_contention.lost, ms);
+  STATS_Line("twi.retries", _twi_contention.retries, _stats_contention.retries, ms);
+  STATS_Line("twi.aborted", _twi_contention.aborted, _stats_contention.aborted, ms);
+  STATS_Line("twi.backoff", _twi_contention.slots * TWI_BACKOFF_US, _stats_contention.slots * TWI_BACKOFF_US, ms);
+  // HD44780
+  STATS_Line("lcd.instr", _hd44780_stats.instructions, _stats_lcd.instructions, ms);
+  STATS_Line("lcd.data", _hd44780_stats.data, _stats_lcd.data, ms);
+  STATS_Line("lcd.elided", _hd44780_stats.elided, _stats_lcd.elided, ms);
+  STATS_Line("lcd.reads", _hd44780_stats.reads, _stats_lcd.reads, ms);
+  STATS_Line("lcd.polls", _hd44780_stats.polls, _stats_lcd.polls, ms);
+  STATS_Line("lcd.repairs", _hd44780_stats.repairs, _stats_lcd.repairs, ms);
+  STATS_Line("lcd.recover", _hd44780_stats.recoveries, _stats_lcd.recoveries, ms);
+  // errors by TWI_STATUS code, only seen ones
+  for (i = 0; i < 32; i++) {
+    if (_twi_stats.status[i] != 0) {
+      sprintf(str, "twi.0x%02X     %10u\r\n", i << 3, _twi_stats.status[i]);
+      UART_PutString(str);
+    }
+  }
+  // base for next rates
+  memcpy(&_stats_twi, &_twi_stats, sizeof(TWI_Stats));
+  memcpy(&_stats_lcd, &_hd44780_stats, sizeof(HD44780_PCF8574_Stats));
+  memcpy(&_stats_contention, &_twi_contention, sizeof(TWI_Contention));
+  _stats_stamp = now;
+}
+
+#endif
+
+#if TWI_TRACE
+
+/**
+ * @desc    Print bus trace, oldest first, one record per line
+ *          <event> <stamp> <data> <status>, all hex
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STATS_Trace (void)
+{
+  char str[24];
+  unsigned char i;
+  unsigned char n = _twi_trace.count;
+  // oldest record
+  unsigned char index = (_twi_trace.head + TWI_TRACE_SIZE - n) % TWI_TRACE_SIZE;
+  TWI_Record *record;
+
+  // header, Timer1 ticks per us
+  sprintf(str, "\r\n# twitrace %u\r\n", PROF_TICKS_PER_US);
+  UART_PutString(str);
+  // records
+  for (i = 0; i < n; i++) {
+    record = &_twi_trace.record[index];
+    sprintf(str, "%c %04X %02X %02X\r\n", record->event, record->stamp, (unsigned char) record->data, (unsigned char) record->status);
+    UART_PutString(str);
+    index = (index + 1) % TWI_TRACE_SIZE;
+  }
+  // footer
+  UART_PutString("# end\r\n");
+}
+
+#endif
+
+/**
+ * @desc    Zero all counters
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void STATS_Reset (void)
+{
+#if TWI_STATS && HD44780_STATS
+  // counters
+  memset(&_twi_stats, 0, sizeof(TWI_Stats));
+  memset(&_hd44780_stats, 0, sizeof(HD44780_PCF8574_Stats));
+  memset(&_twi_contention, 0, sizeof(TWI_Contention));
+  // base for rates
+  memset(&_stats_twi, 0, sizeof(TWI_Stats));
+  memset(&_stats_lcd, 0, sizeof(HD44780_PCF8574_Stats));
+  memset(&_stats_contention, 0, sizeof(TWI_Contention));
+  _stats_stamp = SCHED_Millis();
+#endif
+#if PROF
+  // histograms
+  PROF_Reset();
+#endif
+#if TWI_TRACE
+  // bus trace
+  _twi_trace.head = 0;
+  _twi_trace.count = 0;
+#endif
+}
+
+/**
+ * @desc    Stats task - command poll and periodic dump
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void STATS_Task (void)
+{
+  // command
+  switch (UART_GetChar()) {
+#if TWI_STATS && HD44780_STATS
+    // dump now
+    case STATS_CMD_DUMP:
+      STATS_Dump();
+      _stats_elapsed = 0;
+      break;
+#endif
+#if PROF
+    // latencies
+    case STATS_CMD_PROF:
+      PROF_Dump();
+      break;
+#endif
+#if TWI_TRACE
+    // bus trace
+    case STATS_CMD_TRACE:
+      STATS_Trace();
+      break;
+#endif
+    // zero counters
+    case STATS_CMD_RESET:
+      STATS_Reset();
+      _stats_elapsed = 0;
+      break;
+  }
+#if TWI_STATS && HD44780_STATS
+  // periodic dump
+  if ((STATS_PERIOD > 0) && ((_stats_elapsed += STATS_POLL_MS) >= STATS_PERIOD)) {
+    STATS_Dump();
+    _stats_elapsed = 0;
+  }
+#endif
+}
+
+/**
+ * @desc    Init UART and add scheduler task
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char STATS_Init (void)
+{
+  // 38400 8N1
+  UART_Init(UART_UBRR(UART_BAUD));
+#if PROF
+  // Timer1 timestamps
+  PROF_Init();
+#elif TWI_TRACE
+  // Timer1 timestamps, same as PROF_Init
+  TCCR1A = 0;
+  TCCR1B = (1 << CS11);
+#endif
+  // rates from now
+  STATS_Reset();
+  // poll UART
+  if (SCHED_AddTask(STATS_Task, 0, STATS_POLL_MS) == SCHED_NO_TASK) {
+    // error
+    return PCF8574_ERROR;
+  }
+  // success
+  return PCF8574_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Hot path counters dump over UART
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       13.12.2020
+ * @file        stats.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      twi.h, hd44780pcf8574.h, prof.h, scheduler.h, uart.h
+ * ---------------------------------------------------------------+
+ * @usage       make STATS=1, PROF=1 and / or TRACE=1, 38400 8N1
+ *              's' dumps counters, 'p' latencies, 't' bus trace,
+ *              'r' zeroes all
+ */
+
+/** @definition */
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "twi.h"
+#include "hd44780pcf8574.h"
+#include "prof.h"
+
+  // @const UART dump compiled in
+  #define STATS_UART             ((TWI_STATS && HD44780_STATS) || PROF || TWI_TRACE)
+
+  // @const periodic dump of counters in ms, 0 = only on command
+  #ifndef STATS_PERIOD
+    #define STATS_PERIOD         1000
+  #endif
+  // @const UART poll period in ms
+  #define STATS_POLL_MS          10
+  // @const UART command - dump now
+  #define STATS_CMD_DUMP         's'
+  // @const UART command - dump latency histograms
+  #define STATS_CMD_PROF         'p'
+  // @const UART command - dump bus trace for tools/twitrace
+  #define STATS_CMD_TRACE        't'
+  // @const UART command - zero counters
+  #define STATS_CMD_RESET        'r'
+
+  /**
+   * @desc    Print counters and rates per second since last dump
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void STATS_Dump (void);
+
+  /**
+   * @desc    Print bus trace, oldest first, one record per line
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void STATS_Trace (void);
+
+  /**
+   * @desc    Zero all counters
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void STATS_Reset (void);
+
+  /**
+   * @desc    Init UART and add scheduler task
+   *
+   * @param   void
+   *
+   * @return  char
+   */
+  char STATS_Init (void);
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Software I2C - N buses in lockstep, one SCL
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       19.12.2020
+ * @file        swi2c.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      swi2c.h, expander.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <util/delay.h>
+#include "expander.h"
+#include "swi2c.h"
+
+#if EXPANDER == EXPANDER_SWI2C
+
+/** @var lanes without acknowledge since SWI2C_Nack, bit i = lane i */
+unsigned char _swi2c_nack = 0;
+
+/** @var lines pulled low now */
+static unsigned char _swi2c_pull = 0;
+
+// @const SCL bit
+#define SWI2C_SCL_BIT            ((unsigned char) (1 << SWI2C_SCL))
+
+/**
+ * @desc    Pull given lines low, release the others - one port write
+ *
+ * @param   unsigned char
+ *
+ * @return  void
+ */
+static void SWI2C_Lines (unsigned char pull)
+{
+  // other pins of port kept
+  SWI2C_DDR = (SWI2C_DDR & (unsigned char) ~SWI2C_MASK) | pull;
+  // state
+  _swi2c_pull = pull;
+}
+
+/**
+ * @desc    Init - all lines released
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SWI2C_Init (void)
+{
+  // open drain, pulled low only by DDR
+  SWI2C_PORT &= (unsigned char) ~SWI2C_MASK;
+  // bus free
+  SWI2C_Lines(0);
+  _delay_us(SWI2C_HALF_US);
+}
+
+/**
+ * @desc    Start condition on all lanes, repeated start too
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SWI2C_Start (void)
+{
+  // SCL low, SDA released - no condition while SCL low
+  SWI2C_Lines(_swi2c_pull | SWI2C_SCL_BIT);
+  SWI2C_Lines(SWI2C_SCL_BIT);
+  _delay_us(SWI2C_HALF_US);
+  // SCL high
+  SWI2C_Lines(0);
+  _delay_us(SWI2C_HALF_US);
+  // SDA falls while SCL high
+  SWI2C_Lines(SWI2C_SDA_MASK);
+  _delay_us(SWI2C_HALF_US);
+  // SCL low
+  SWI2C_Lines(SWI2C_SDA_MASK | SWI2C_SCL_BIT);
+}
+
+/**
+ * @desc    Stop condition on all lanes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SWI2C_Stop (void)
+{
+  // SCL low, then SDA low
+  SWI2C_Lines(_swi2c_pull | SWI2C_SCL_BIT);
+  SWI2C_Lines(SWI2C_SDA_MASK | SWI2C_SCL_BIT);
+  _delay_us(SWI2C_HALF_US);
+  // SCL high
+  SWI2C_Lines(SWI2C_SDA_MASK);
+  _delay_us(SWI2C_HALF_US);
+  // SDA rises while SCL high
+  SWI2C_Lines(0);
+  _delay_us(SWI2C_HALF_US);
+}
+
+/**
+ * @desc    Transmit one byte per lane in lockstep
+ *
+ * @param   const unsigned char * - SWI2C_LANES bytes
+ *
+ * @return  unsigned char - lanes without acknowledge
+ */
+unsigned char SWI2C_Write (const unsigned char *bytes)
+{
+  unsigned char bit;
+  unsigned char lane;
+  unsigned char pull;
+  unsigned char nack;
+
+  // MSB first
+  for (bit = 0x80; bit; bit >>= 1) {
+    // SDA of lanes with 0
+    pull = 0;
+    for (lane = 0; lane < SWI2C_LANES; lane++) {
+      if (!(bytes[lane] & bit)) {
+        pull |= 1 << (SWI2C_SDA + lane);
+      }
+    }
+    // SCL low, then data - SDA never changes while SCL high
+    SWI2C_Lines(_swi2c_pull | SWI2C_SCL_BIT);
+    SWI2C_Lines(pull | SWI2C_SCL_BIT);
+    _delay_us(SWI2C_HALF_US);
+    // SCL high, slaves sample
+    SWI2C_Lines(pull);
+    _delay_us(SWI2C_HALF_US);
+  }
+
+  // acknowledge clock, SDA released
+  SWI2C_Lines(_swi2c_pull | SWI2C_SCL_BIT);
+  SWI2C_Lines(SWI2C_SCL_BIT);
+  _delay_us(SWI2C_HALF_US);
+  SWI2C_Lines(0);
+  _delay_us(SWI2C_HALF_US);
+  // SDA high = not acknowledged
+  nack = (SWI2C_PIN >> SWI2C_SDA) & ((1 << SWI2C_LANES) - 1);
+  // SCL low
+  SWI2C_Lines(SWI2C_SCL_BIT);
+
+  // sticky
+  _swi2c_nack |= nack;
+
+  return nack;
+}
+
+/**
+ * @desc    Transmit the same byte on all lanes
+ *
+ * @param   unsigned char
+ *
+ * @return  unsigned char - lanes without acknowledge
+ */
+unsigned char SWI2C_WriteAll (unsigned char data)
+{
+  unsigned char bytes[SWI2C_LANES];
+  unsigned char lane;
+
+  for (lane = 0; lane < SWI2C_LANES; lane++) {
+    bytes[lane] = data;
+  }
+
+  return SWI2C_Write(bytes);
+}
+
+/**
+ * @desc    Receive one byte per lane in lockstep, master NACK
+ *
+ * @param   unsigned char * - SWI2C_LANES bytes
+ *
+ * @return  void
+ */
+void SWI2C_Read (unsigned char *bytes)
+{
+  unsigned char bit;
+  unsigned char lane;
+  unsigned char pin;
+
+  // SDA released, slaves drive
+  SWI2C_Lines(_swi2c_pull | SWI2C_SCL_BIT);
+  SWI2C_Lines(SWI2C_SCL_BIT);
+  for (lane = 0; lane < SWI2C_LANES; lane++) {
+    bytes[lane] = 0;
+  }
+
+  // MSB first, 8 data bits and NACK clock
+  for (bit = 0; bit < 9; bit++) {
+    _delay_us(SWI2C_HALF_US);
+    // SCL high
+    SWI2C_Lines(0);
+    _delay_us(SWI2C_HALF_US);
+    // sample all lanes at once
+    pin = SWI2C_PIN >> SWI2C_SDA;
+    // SCL low
+    SWI2C_Lines(SWI2C_SCL_BIT);
+    // data bit, NACK clock not sampled
+    if (bit < 8) {
+      for (lane = 0; lane < SWI2C_LANES; lane++) {
+        bytes[lane] = (bytes[lane] << 1) | ((pin >> lane) & 0x01);
+      }
+    }
+  }
+}
+
+/**
+ * @desc    Lanes without acknowledge since last call, cleared
+ *
+ * @param   void
+ *
+ * @return  unsigned char
+ */
+unsigned char SWI2C_Nack (void)
+{
+  unsigned char nack = _swi2c_nack;
+
+  _swi2c_nack = 0;
+
+  return nack;
+}
+
+#endif
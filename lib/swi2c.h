@@ -0,0 +1,127 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Software I2C - N buses in lockstep, one SCL
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       19.12.2020
+ * @file        swi2c.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      avr/io.h
+ * ---------------------------------------------------------------+
+ * @usage       make EXPANDER=SWI2C
+ *
+ *              Lanes are SDA lines of one port sharing SCL, every lane
+ *              is own bus - the same address on all of them. Lines are
+ *              open drain with external pull ups: PORT bits stay 0,
+ *              DDR bit 1 pulls low, 0 releases. Every bit phase of all
+ *              lanes is one DDR write, N buses take wall time of one.
+ */
+
+/** @definition */
+#ifndef __SWI2C_H__
+#define __SWI2C_H__
+
+#include <avr/io.h>
+
+  // @const port of lanes and SCL
+  #ifndef SWI2C_PORT
+    #define SWI2C_PORT           PORTB
+    #define SWI2C_DDR            DDRB
+    #define SWI2C_PIN            PINB
+  #endif
+  // @const SCL bit, PB0
+  #ifndef SWI2C_SCL
+    #define SWI2C_SCL            0
+  #endif
+  // @const number of lanes, SDA of lane i at bit SWI2C_SDA + i, PB1 - PB4
+  #ifndef SWI2C_LANES
+    #define SWI2C_LANES          4
+  #endif
+  #ifndef SWI2C_SDA
+    #define SWI2C_SDA            1
+  #endif
+  // @const half of SCL period in us, 5 us ~ 100 kHz
+  #ifndef SWI2C_HALF_US
+    #define SWI2C_HALF_US        5
+  #endif
+
+  // @const SDA lines of all lanes
+  #define SWI2C_SDA_MASK         ((unsigned char) (((1 << SWI2C_LANES) - 1) << SWI2C_SDA))
+  // @const lines owned by module
+  #define SWI2C_MASK             ((unsigned char) (SWI2C_SDA_MASK | (1 << SWI2C_SCL)))
+
+  #if (SWI2C_SDA + SWI2C_LANES > 8) || ((SWI2C_SCL >= SWI2C_SDA) && (SWI2C_SCL < SWI2C_SDA + SWI2C_LANES))
+    #error "SWI2C lanes and SCL must be different bits of one port"
+  #endif
+
+  /** @var lanes without acknowledge since SWI2C_Nack, bit i = lane i */
+  extern unsigned char _swi2c_nack;
+
+  /**
+   * @desc    Init - all lines released
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void SWI2C_Init (void);
+
+  /**
+   * @desc    Start condition on all lanes, repeated start too
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void SWI2C_Start (void);
+
+  /**
+   * @desc    Stop condition on all lanes
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void SWI2C_Stop (void);
+
+  /**
+   * @desc    Transmit one byte per lane in lockstep
+   *
+   * @param   const unsigned char * - SWI2C_LANES bytes
+   *
+   * @return  unsigned char - lanes without acknowledge
+   */
+  unsigned char SWI2C_Write (const unsigned char *);
+
+  /**
+   * @desc    Transmit the same byte on all lanes
+   *
+   * @param   unsigned char
+   *
+   * @return  unsigned char - lanes without acknowledge
+   */
+  unsigned char SWI2C_WriteAll (unsigned char);
+
+  /**
+   * @desc    Receive one byte per lane in lockstep, master NACK
+   *
+   * @param   unsigned char * - SWI2C_LANES bytes
+   *
+   * @return  void
+   */
+  void SWI2C_Read (unsigned char *);
+
+  /**
+   * @desc    Lanes without acknowledge since last call, cleared
+   *
+   * @param   void
+   *
+   * @return  unsigned char
+   */
+  unsigned char SWI2C_Nack (void);
+
+#endif
@@ -0,0 +1,312 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Terminal on LCD - wrap, newline, scroll, VT100 subset
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       23.12.2020
+ * @file        term.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      term.h, hd44780pcf8574.h, expander.h, charset.h
+ * ---------------------------------------------------------------+
+ */
+#include <string.h>
+#include "term.h"
+
+// compiled only with make TERM=1
+#if TERM
+
+#include "expander.h"
+#include "hd44780pcf8574.h"
+
+// DDRAM address of cell
+#define TERM_DDRAM(ROW, COL)     (((ROW) ? HD44780_ROW2_START : HD44780_ROW1_START) + (COL))
+
+/** @var cursor and parser */
+static TERM_State _term;
+
+/**
+ * @desc    Write cell if glass differs, address elided if already there
+ *
+ * @param   char addr
+ * @param   unsigned char - row
+ * @param   unsigned char - column
+ * @param   char
+ *
+ * @return  void
+ */
+static void TERM_Cell (char addr, unsigned char row, unsigned char col, char c)
+{
+  // DDRAM mirror already shows it
+  if (_hd44780_shadow.ddram[row][col] == c) {
+    return;
+  }
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | TERM_DDRAM(row, col));
+  HD44780_PCF8574_DrawChar(addr, c);
+}
+
+/**
+ * @desc    Blank cells of row
+ *
+ * @param   char addr
+ * @param   unsigned char - row
+ * @param   unsigned char - first column
+ * @param   unsigned char - column after last
+ *
+ * @return  void
+ */
+static void TERM_Clear (char addr, unsigned char row, unsigned char from, unsigned char to)
+{
+  while (from < to) {
+    TERM_Cell(addr, row, from++, ' ');
+  }
+}
+
+/**
+ * @desc    Rows up by one, last row blank - only changed cells sent
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+static void TERM_Scroll (char addr)
+{
+  unsigned char row;
+  unsigned char col;
+
+  // row below from DDRAM mirror
+  for (row = 0; row < HD44780_ROWS - 1; row++) {
+    for (col = 0; col < HD44780_COLS; col++) {
+      TERM_Cell(addr, row, col, _hd44780_shadow.ddram[row + 1][col]);
+    }
+  }
+  TERM_Clear(addr, HD44780_ROWS - 1, 0, HD44780_COLS);
+}
+
+/**
+ * @desc    Column 0 of next row, scroll at last row
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+static void TERM_Newline (char addr)
+{
+  _term.col = 0;
+  _term.wrap = 0;
+  if (_term.row < HD44780_ROWS - 1) {
+    _term.row++;
+  } else {
+    TERM_Scroll(addr);
+  }
+}
+
+/**
+ * @desc    Printable character at cursor
+ *
+ * @param   char addr
+ * @param   char
+ *
+ * @return  void
+ */
+static void TERM_Print (char addr, char c)
+{
+  // wrap deferred, full row followed by newline adds no empty row
+  if (_term.wrap) {
+    TERM_Newline(addr);
+  }
+  TERM_Cell(addr, _term.row, _term.col, c);
+  // cursor stays at last column till next printable
+  if (_term.col < HD44780_COLS - 1) {
+    _term.col++;
+  } else {
+    _term.wrap = 1;
+  }
+}
+
+/**
+ * @desc    Execute CSI sequence, parameters 0 = default
+ *
+ * @param   char addr
+ * @param   char - final byte
+ *
+ * @return  void
+ */
+static void TERM_Csi (char addr, char final)
+{
+  unsigned char n = _term.param[0];
+  // moves by at least one
+  unsigned char count = n ? n : 1;
+  unsigned char row;
+
+  _term.wrap = 0;
+  switch (final) {
+    // cursor position, from 1
+    case 'H':
+    case 'f':
+      _term.row = (n > HD44780_ROWS) ? HD44780_ROWS - 1 : (n ? n - 1 : 0);
+      n = _term.param[1];
+      _term.col = (n > HD44780_COLS) ? HD44780_COLS - 1 : (n ? n - 1 : 0);
+      break;
+    // cursor moves, stop at border
+    case 'A':
+      _term.row = (count > _term.row) ? 0 : _term.row - count;
+      break;
+    case 'B':
+      _term.row = (count >= HD44780_ROWS - _term.row) ? HD44780_ROWS - 1 : _term.row + count;
+      break;
+    case 'C':
+      _term.col = (count >= HD44780_COLS - _term.col) ? HD44780_COLS - 1 : _term.col + count;
+      break;
+    case 'D':
+      _term.col = (count > _term.col) ? 0 : _term.col - count;
+      break;
+    // erase in line - 0 to end, 1 from start, 2 whole
+    case 'K':
+      TERM_Clear(addr, _term.row, (n == 0) ? _term.col : 0, (n == 1) ? _term.col + 1 : HD44780_COLS);
+      break;
+    // erase in display - 0 to end, 1 from start, 2 whole
+    case 'J':
+      for (row = 0; row < HD44780_ROWS; row++) {
+        // rows before cursor kept by 0, after cursor by 1
+        if (((n == 0) && (row < _term.row)) || ((n == 1) && (row > _term.row))) {
+          continue;
+        }
+        TERM_Clear(addr, row, ((n == 0) && (row == _term.row)) ? _term.col : 0, ((n == 1) && (row == _term.row)) ? _term.col + 1 : HD44780_COLS);
+      }
+      break;
+    // not supported
+    default:
+      break;
+  }
+}
+
+/**
+ * @desc    Clear screen, cursor home
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void TERM_Init (char addr)
+{
+  unsigned char row;
+
+  // cursor home, text state
+  memset(&_term, 0, sizeof(_term));
+  // transactions sent at once where supported
+  EXPANDER_Hold(1);
+  for (row = 0; row < HD44780_ROWS; row++) {
+    TERM_Clear(addr, row, 0, HD44780_COLS);
+  }
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | TERM_DDRAM(0, 0));
+  EXPANDER_Hold(0);
+}
+
+/**
+ * @desc    Put character - printable, control or part of escape sequence
+ *
+ * @param   char addr
+ * @param   char
+ *
+ * @return  void
+ */
+void TERM_Putc (char addr, char c)
+{
+  unsigned char b = (unsigned char) c;
+#if CHARSET_UTF8
+  unsigned int cp;
+#endif
+
+  // escape, only CSI sequences known
+  if (_term.state == TERM_STATE_ESC) {
+    _term.state = (c == '[') ? TERM_STATE_CSI : TERM_STATE_TEXT;
+    _term.param[0] = 0;
+    _term.param[1] = 0;
+    _term.params = 0;
+    return;
+  }
+  // CSI parameters, final byte executes
+  if (_term.state == TERM_STATE_CSI) {
+    if ((c >= '0') && (c <= '9')) {
+      // larger values clamp at border anyway
+      if ((_term.params < TERM_PARAMS) && (_term.param[_term.params] < 25)) {
+        _term.param[_term.params] = _term.param[_term.params] * 10 + (c - '0');
+      }
+    } else if (c == ';') {
+      if (_term.params < TERM_PARAMS) {
+        _term.params++;
+      }
+    } else if ((b >= 0x40) && (b <= 0x7E)) {
+      _term.state = TERM_STATE_TEXT;
+      TERM_Csi(addr, c);
+    }
+    // private and intermediate bytes ignored
+    return;
+  }
+
+  switch (c) {
+    case '\x1B':
+      _term.state = TERM_STATE_ESC;
+      break;
+    case '\n':
+      TERM_Newline(addr);
+      break;
+    case '\r':
+      _term.col = 0;
+      _term.wrap = 0;
+      break;
+    // cursor left, cell kept
+    case '\b':
+      if (_term.col > 0) {
+        _term.col--;
+      }
+      _term.wrap = 0;
+      break;
+    default:
+      // other control characters ignored
+      if (b < 0x20) {
+        break;
+      }
+#if CHARSET_UTF8
+      // code point drawn at last byte of its sequence
+      if ((b >= 0x80) || _term.utf8.left) {
+        if (CHARSET_Decode(&_term.utf8, c, &cp)) {
+          TERM_Print(addr, CHARSET_Code(addr, &_term.utf8, cp));
+        }
+        break;
+      }
+#endif
+      TERM_Print(addr, c);
+      break;
+  }
+}
+
+/**
+ * @desc    Put string in one held transaction, LCD cursor at end
+ *
+ * @param   char addr
+ * @param   const char *
+ *
+ * @return  void
+ */
+void TERM_Puts (char addr, const char *str)
+{
+  // transactions of string sent at once where supported
+  EXPANDER_Hold(1);
+#if CHARSET_UTF8
+  // glyphs of earlier strings may be reused once off glass
+  _term.utf8.pinned = 0;
+#endif
+  while (*str != '\0') {
+    TERM_Putc(addr, *str++);
+  }
+  // LCD cursor at terminal cursor, elided if already there
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | TERM_DDRAM(_term.row, _term.col));
+  EXPANDER_Hold(0);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Terminal on LCD - wrap, newline, scroll, VT100 subset
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       23.12.2020
+ * @file        term.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      hd44780pcf8574.h, charset.h
+ * ---------------------------------------------------------------+
+ * @usage       make TERM=1
+ *
+ *              TERM_Puts(addr, "adc ok\n") - cursor is tracked, text
+ *              wraps at HD44780_COLS into next row, newline at last
+ *              row scrolls up. Screen is DDRAM mirror of driver, every
+ *              cell is sent only if it differs, so scroll rewrites only
+ *              changed cells. Display shift must be 0.
+ *
+ *              \n       next row, column 0
+ *              \r       column 0
+ *              \b       one column left, not erased
+ *              ESC[r;cH ESC[r;cf  cursor to row r, column c, from 1
+ *              ESC[nA B C D       cursor up, down, right, left by n
+ *              ESC[K 1K 2K        clear to end, from start, whole line
+ *              ESC[J 1J 2J        clear to end, from start, whole screen
+ */
+
+/** @definition */
+#ifndef __TERM_H__
+#define __TERM_H__
+
+#include "charset.h"
+
+  // terminal on LCD, make TERM=1
+  #ifndef TERM
+    #define TERM                 0
+  #endif
+
+  // @const escape sequence parser
+  #define TERM_STATE_TEXT        0
+  #define TERM_STATE_ESC         1
+  #define TERM_STATE_CSI         2
+
+  // @const numeric parameters of CSI sequence
+  #define TERM_PARAMS            2
+
+  /** @struct terminal state */
+  typedef struct {
+    // cursor cell
+    unsigned char row;
+    unsigned char col;
+    // last column written, next printable wraps first
+    char wrap;
+    // escape sequence parser
+    char state;
+    unsigned char param[TERM_PARAMS];
+    unsigned char params;
+#if CHARSET_UTF8
+    // UTF-8 sequence may span calls
+    CHARSET_Stream utf8;
+#endif
+  } TERM_State;
+
+  /**
+   * @desc    Clear screen, cursor home
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void TERM_Init (char);
+
+  /**
+   * @desc    Put character - printable, control or part of escape sequence
+   *
+   * @param   char addr
+   * @param   char
+   *
+   * @return  void
+   */
+  void TERM_Putc (char, char);
+
+  /**
+   * @desc    Put string in one held transaction, LCD cursor at end
+   *
+   * @param   char addr
+   * @param   const char *
+   *
+   * @return  void
+   */
+  void TERM_Puts (char, const char *);
+
+#endif
@@ -13,11 +13,35 @@
  */
  
 // include libraries
+#include <util/delay.h>
+#include "prof.h"
 #include "twi.h"
 
 /* @var error status */  
 char _twi_error_stat = TWI_ERROR_NONE;
 
+/* @var cost of other masters on bus */
+TWI_Contention _twi_contention;
+
+/* @var bus lost to other master, steps skipped till next START */
+static char _twi_lost = 0;
+
+/* @var transaction aborted since TWI_Dropped, slave got part of it */
+static char _twi_dropped = 0;
+
+/* @var backoff LFSR */
+static unsigned int _twi_lfsr = TWI_BACKOFF_SEED;
+
+#if TWI_STATS
+/* @var hot path counters */
+TWI_Stats _twi_stats;
+#endif
+
+#if TWI_TRACE
+/* @var bus trace, host readable */
+TWI_Trace _twi_trace;
+#endif
+
 /**
  * @desc    TWI init - initialize frequency
  *
@@ -27,6 +51,8 @@ char _twi_error_stat = TWI_ERROR_NONE;
  */
 void TWI_Init(void)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_INIT);
   // +++++++++++++++++++++++++++++++++++++++++++++
   // Calculation fclk:
   //
@@ -49,6 +75,78 @@ void TWI_Init(void)
   TWI_FREQ(8, 1);
 }
 
+/**
+ * @desc    TWI arbitration lost - other master owns bus, released
+ *          without STOP, rest of transaction skipped
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void TWI_Abort(void)
+{
+  // not addressed slave
+  TWI_RELEASE();
+  _twi_contention.lost++;
+  _twi_contention.aborted++;
+  // till STOP or next START
+  _twi_lost = 1;
+  // caller repairs what slave got
+  _twi_dropped = 1;
+}
+
+/**
+ * @desc    TWI transaction aborted since last call - lost to other master
+ *          after slave got part of it, or retries exhausted
+ *
+ * @param   void
+ *
+ * @return  char - 1 aborted, flag cleared
+ */
+char TWI_Dropped(void)
+{
+  char dropped = _twi_dropped;
+
+  _twi_dropped = 0;
+
+  return dropped;
+}
+
+/**
+ * @desc    TWI arbitration lost in SLA - nothing of transaction sent
+ *          yet, START repeated after random backoff
+ *
+ * @param   unsigned char - retry, 1 = first
+ *
+ * @return  char - 1 START sent again, 0 retries exhausted
+ */
+static char TWI_Retry(unsigned char retry)
+{
+  unsigned char slots;
+
+  // give up, counted as aborted
+  if (retry > TWI_RETRIES) {
+    TWI_Abort();
+    return 0;
+  }
+  // not addressed slave
+  TWI_RELEASE();
+  _twi_contention.lost++;
+  _twi_contention.retries++;
+  // Galois LFSR x^16 + x^14 + x^13 + x^11 + 1
+  _twi_lfsr = (_twi_lfsr >> 1) ^ ((unsigned int) -(_twi_lfsr & 1) & 0xB400);
+  // window doubles every retry, masters out of step after collision
+  slots = 1 + (_twi_lfsr & ((1 << retry) - 1) & TWI_BACKOFF_WINDOW);
+  _twi_contention.slots += slots;
+  while (slots--) {
+    IDLE_DELAY_US(TWI_BACKOFF_US);
+  }
+  // START waits till bus free
+  TWI_MT_Start();
+
+  return 1;
+}
+
 /**
  * @desc    TWI MT Start
  *
@@ -58,16 +156,23 @@ void TWI_Init(void)
  */
 void TWI_MT_Start(void)
 { 
+  // latency histogram
+  PROF_ENTER(PROF_TWI_START);
   // init status
   char status = TWI_STATUS_INIT;
   // START
   // ----------------------------------------------
+  // new transaction
+  _twi_lost = 0;
   // request for bus
   TWI_START();
+  TWI_STATS_INC(starts);
   // wait till flag set
   TWI_WAIT_TILL_TWINT_IS_SET();
   // status read
   status = TWI_STATUS;
+  // trace
+  TWI_TRACE_ADD(TWI_EVENT_START, 0, status);
   // test if start or repeated start acknowledged
   if ((status != TWI_START_ACK) && (status != TWI_REP_START_ACK)) {
     // error status
@@ -84,17 +189,30 @@ void TWI_MT_Start(void)
  */
 void TWI_Transmit_SLAW(char address)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_SLAW);
   // init status
   char status = TWI_STATUS_INIT;
+  unsigned char retry = 0;
+  // given up
+  if (_twi_lost) {
+    return;
+  }
   // SLA+W
   // ----------------------------------------------
-  TWI_TWDR = (address << 1);
-  // enable
-  TWI_MSTR_ENABLE_ACK();
-  // wait till flag set
-  TWI_WAIT_TILL_TWINT_IS_SET();
-  // status read
-  status = TWI_STATUS;
+  do {
+    TWI_TWDR = (address << 1);
+    TWI_STATS_INC(bytes);
+    // enable
+    TWI_MSTR_ENABLE_ACK();
+    // wait till flag set
+    TWI_WAIT_TILL_TWINT_IS_SET();
+    // status read
+    status = TWI_STATUS;
+    // trace
+    TWI_TRACE_ADD(TWI_EVENT_SLAW, address << 1, status);
+  // other master won, whole transaction again
+  } while (TWI_LOST(status) && TWI_Retry(++retry));
   // find
   if (status != TWI_MT_SLAW_ACK) {
     // error status
@@ -111,17 +229,30 @@ void TWI_Transmit_SLAW(char address)
  */
 void TWI_Transmit_SLAR(char address)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_SLAR);
   // init status
   char status = TWI_STATUS_INIT;
+  unsigned char retry = 0;
+  // given up
+  if (_twi_lost) {
+    return;
+  }
   // SLA+R
   // ----------------------------------------------
-  TWI_TWDR = (address << 1) | TWI_READ;
-  // enable
-  TWI_MSTR_ENABLE_ACK();
-  // wait till flag set
-  TWI_WAIT_TILL_TWINT_IS_SET();
-  // status read
-  status = TWI_STATUS;
+  do {
+    TWI_TWDR = (address << 1) | TWI_READ;
+    TWI_STATS_INC(bytes);
+    // enable
+    TWI_MSTR_ENABLE_ACK();
+    // wait till flag set
+    TWI_WAIT_TILL_TWINT_IS_SET();
+    // status read
+    status = TWI_STATUS;
+    // trace
+    TWI_TRACE_ADD(TWI_EVENT_SLAR, (address << 1) | TWI_READ, status);
+  // other master won, whole transaction again
+  } while (TWI_LOST(status) && TWI_Retry(++retry));
   // find
   if (status != TWI_MR_SLAR_ACK) {
     // error status
@@ -138,17 +269,30 @@ void TWI_Transmit_SLAR(char address)
  */
 void TWI_Transmit_Byte(char data)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_BYTE);
   // init status
   char status = TWI_STATUS_INIT;
+  // given up
+  if (_twi_lost) {
+    return;
+  }
   // DATA SEND
   // ----------------------------------------------
   TWI_TWDR = data;
+  TWI_STATS_INC(bytes);
   // enable
   TWI_MSTR_ENABLE_ACK();
   // wait till flag set
   TWI_WAIT_TILL_TWINT_IS_SET();
   // status read
   status = TWI_STATUS;
+  // trace
+  TWI_TRACE_ADD(TWI_EVENT_BYTE, data, status);
+  // other master addressed the same slave, bytes already sent
+  if (TWI_LOST(status)) {
+    TWI_Abort();
+  }
   // send with success
   if (status != TWI_MT_DATA_ACK) {
     // error status
@@ -165,16 +309,29 @@ void TWI_Transmit_Byte(char data)
  */
 char TWI_Receive_Byte(void)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_RECEIVE);
   // init status
   char status = TWI_STATUS_INIT;
+  // given up
+  if (_twi_lost) {
+    return TWI_TWDR;
+  }
   // DATA RECEIVE
   // ----------------------------------------------
   // enable with NACK
   TWI_MSTR_ENABLE_NACK();
+  TWI_STATS_INC(bytes);
   // wait till flag set
   TWI_WAIT_TILL_TWINT_IS_SET();
   // status read
   status = TWI_STATUS;
+  // trace
+  TWI_TRACE_ADD(TWI_EVENT_RECEIVE, TWI_TWDR, status);
+  // other master addressed the same slave, bytes already sent
+  if (TWI_LOST(status)) {
+    TWI_Abort();
+  }
   // send with success
   if (status != TWI_MR_DATA_NACK) {
     // error status
@@ -184,6 +341,47 @@ char TWI_Receive_Byte(void)
   return TWI_TWDR;
 }
 
+/**
+ * @desc    TWI Receive 1 byte, ACK - more bytes follow
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char TWI_Receive_Byte_ACK(void)
+{
+  // latency histogram
+  PROF_ENTER(PROF_TWI_RECEIVE);
+  // init status
+  char status = TWI_STATUS_INIT;
+  // given up
+  if (_twi_lost) {
+    return TWI_TWDR;
+  }
+  // DATA RECEIVE
+  // ----------------------------------------------
+  // enable with ACK
+  TWI_MSTR_ENABLE_ACK();
+  TWI_STATS_INC(bytes);
+  // wait till flag set
+  TWI_WAIT_TILL_TWINT_IS_SET();
+  // status read
+  status = TWI_STATUS;
+  // trace
+  TWI_TRACE_ADD(TWI_EVENT_RECEIVE, TWI_TWDR, status);
+  // other master addressed the same slave, bytes already sent
+  if (TWI_LOST(status)) {
+    TWI_Abort();
+  }
+  // send with success
+  if (status != TWI_MR_DATA_ACK) {
+    // error status
+    TWI_Error(status, TWI_MR_DATA_ACK);
+  }
+  // received data
+  return TWI_TWDR;
+}
+
 /**
  * @desc    TWI stop
  *
@@ -193,14 +391,101 @@ char TWI_Receive_Byte(void)
  */
 void TWI_Stop(void)
 {
+  // latency histogram
+  PROF_ENTER(PROF_TWI_STOP);
+  // bus released already
+  if (_twi_lost) {
+    _twi_lost = 0;
+    return;
+  }
   // End TWI
   // -------------------------------------------------
   // send stop sequence
   TWI_STOP();
+  // trace
+  TWI_TRACE_ADD(TWI_EVENT_STOP, 0, TWI_STATUS_NONE);
   // wait for TWINT flag is set
 //  TWI_WAIT_TILL_TWINT_IS_SET();
 }
 
+/**
+ * @desc    TWI combined transfer - write and read segments joined by
+ *          repeated START, one STOP at end, no other master between
+ *
+ * @param   const TWI_Segment *
+ * @param   unsigned char - number of segments
+ *
+ * @return  char - TWI_SUCCESS, TWI_ERROR at first unexpected status
+ */
+char TWI_Transfer(const TWI_Segment *segment, unsigned char count)
+{
+  // latency histogram
+  PROF_ENTER(PROF_TWI_TRANSFER);
+  unsigned char i;
+
+  // no error yet
+  _twi_error_stat = TWI_ERROR_NONE;
+
+  // segments
+  // ----------------------------------------------
+  while (count--) {
+    // START, repeated START after first segment
+    TWI_MT_Start();
+    // read, ACK all bytes but last
+    if (segment->direction == TWI_READ) {
+      TWI_Transmit_SLAR(segment->address);
+      for (i = 0; (i < segment->length) && (_twi_error_stat == TWI_ERROR_NONE); i++) {
+        segment->data[i] = (i + 1 < segment->length) ? TWI_Receive_Byte_ACK() : TWI_Receive_Byte();
+      }
+    // write
+    } else {
+      TWI_Transmit_SLAW(segment->address);
+      for (i = 0; (i < segment->length) && (_twi_error_stat == TWI_ERROR_NONE); i++) {
+        TWI_Transmit_Byte(segment->data[i]);
+      }
+    }
+    // no use to continue, e.g. slave not acknowledged
+    if (_twi_error_stat != TWI_ERROR_NONE) {
+      break;
+    }
+    segment++;
+  }
+
+  // one STOP for all segments
+  TWI_Stop();
+
+  return (_twi_error_stat == TWI_ERROR_NONE) ? TWI_SUCCESS : TWI_ERROR;
+}
+
+#if TWI_TRACE
+/**
+ * @desc    TWI trace - append record, Timer1 must run
+ *
+ * @param   char - event
+ * @param   char - address or data
+ * @param   char - status
+ *
+ * @return  void
+ */
+void TWI_TraceAdd(char event, char data, char status)
+{
+  // next record
+  TWI_Record *record = &_twi_trace.record[_twi_trace.head];
+
+  // fill
+  record->event = event;
+  record->data = data;
+  record->status = status;
+  record->stamp = TCNT1;
+  // ring
+  _twi_trace.head = (_twi_trace.head + 1) % TWI_TRACE_SIZE;
+  // full ring overwrites oldest
+  if (_twi_trace.count < TWI_TRACE_SIZE) {
+    _twi_trace.count++;
+  }
+}
+#endif
+
 /**
  * @desc    TWI Error
  *
@@ -211,8 +496,9 @@ void TWI_Stop(void)
  */
 void TWI_Error(char status, char expected)
 { 
-  // some procedure
-  
-  // error status  
-//  _twi_error_stat = TWI_STATUS_INIT;
+  // count by status code
+  TWI_STATS_STATUS(status);
+
+  // error status, cleared by TWI_Transfer, bus error 0x00 kept non zero
+  _twi_error_stat = status ? status : TWI_STATUS_INIT;
 }
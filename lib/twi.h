@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <avr/io.h>
+#include "idle.h"
 
 #ifndef __TWI_H__
 #define __TWI_H__
@@ -42,22 +43,33 @@
   //      1     1    -    64
   #define TWI_FREQ(BIT_RATE, PRESCALER) { TWI_TWBR = BIT_RATE; TWI_TWSR |= (TWI_TWSR & 0x03) | PRESCALER; }
 
+  // TWI interrupt with every TWINT clear, wakes core from idle sleep, make SLEEP=1
+  #if IDLE_TWI
+    #define TWI_TWIE                    (1 << TWIE)
+  #else
+    #define TWI_TWIE                    0
+  #endif
   // TWI start condition
   // (1 <<  TWEN) - TWI Enable
   // (1 << TWINT) - TWI Interrupt Flag - must be cleared by set
   // (1 << TWSTA) - TWI Start
-  #define TWI_START()                   { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWSTA); }
+  #define TWI_START()                   { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWSTA) | TWI_TWIE; }
 
   // TWI MASTER enable with NACK
   // (1 <<  TWEN) - TWI Enable
   // (1 << TWINT) - TWI Interrupt Flag - must be cleared by set
-  #define TWI_MSTR_ENABLE_NACK()        { TWI_TWCR = (1 << TWEN) | (1 << TWINT); }
+  #define TWI_MSTR_ENABLE_NACK()        { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | TWI_TWIE; }
 
   // TWI MASTER enable with ACK
   // (1 <<  TWEN) - TWI Enable
   // (1 << TWINT) - TWI Interrupt Flag - must be cleared by set
   // (1 <<  TWEA) - TWI Master Receiver will return ACK
-  #define TWI_MSTR_ENABLE_ACK()         { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWEA); }
+  #define TWI_MSTR_ENABLE_ACK()         { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWEA) | TWI_TWIE; }
+
+  // TWI release bus after arbitration lost, not addressed slave
+  // (1 <<  TWEN) - TWI Enable
+  // (1 << TWINT) - TWI Interrupt Flag - must be cleared by set
+  #define TWI_RELEASE()                 { TWI_TWCR = (1 << TWEN) | (1 << TWINT); }
 
   // TWI stop condition
   // (1 <<  TWEN) - TWI Enable
@@ -65,8 +77,12 @@
   // (1 << TWSTO) - TWI Stop
   #define TWI_STOP()                    { TWI_TWCR = (1 << TWEN) | (1 << TWINT) | (1 << TWSTO); }
 
-  // TWI test if TWINT Flag is set
-  #define TWI_WAIT_TILL_TWINT_IS_SET()  { while (!(TWI_TWCR & (1 << TWINT))); }
+  // TWI test if TWINT Flag is set, idle sleep till TWI_vect with make SLEEP=1
+  #if IDLE_TWI
+    #define TWI_WAIT_TILL_TWINT_IS_SET()  { IDLE_WaitTWI(); }
+  #else
+    #define TWI_WAIT_TILL_TWINT_IS_SET()  { while (!(TWI_TWCR & (1 << TWINT))) { TWI_STATS_INC(waits); } }
+  #endif
 
   // definitions
   #define TWI_STATUS_INIT       0xFF
@@ -74,6 +90,23 @@
   #define TWI_ERROR                1
   #define TWI_ERROR_NONE           0 
 
+  // multi-master, START + SLA repeated after arbitration lost
+  #ifndef TWI_RETRIES
+    #define TWI_RETRIES         8
+  #endif
+  // @const backoff slot in us, about one byte at 400 kHz
+  #ifndef TWI_BACKOFF_US
+    #define TWI_BACKOFF_US      25
+  #endif
+  // @const backoff window limit, slots = LFSR & window, window doubles per retry
+  #ifndef TWI_BACKOFF_WINDOW
+    #define TWI_BACKOFF_WINDOW  0x1F
+  #endif
+  // @const LFSR seed, make it differ on every master of bus
+  #ifndef TWI_BACKOFF_SEED
+    #define TWI_BACKOFF_SEED    0xACE1
+  #endif
+
   // ++++++++++++++++++++++++++++++++++++++++++
   //
   //        M A S T E R   M O D E
@@ -93,6 +126,9 @@
   #define TWI_MR_SLAR_NACK      0x48  // SLA+R has been transmitted; NOT ACK has been received
   #define TWI_MR_DATA_ACK       0x50  // Data byte has been received; ACK has been received
   #define TWI_MR_DATA_NACK      0x58  // Data byte has been received; NOT ACK has been received
+  // Arbitration lost, as master or addressed as slave right after
+  #define TWI_LOST(STATUS)      (((unsigned char) (STATUS) == TWI_FLAG_ARB_LOST) || ((unsigned char) (STATUS) == TWI_SR_ALMOA_ACK) || \
+                                 ((unsigned char) (STATUS) == TWI_SR_ALMGA_ACK) || ((unsigned char) (STATUS) == TWI_ST_ALMOA_ACK))
   
   // ++++++++++++++++++++++++++++++++++++++++++
   //
@@ -117,9 +153,114 @@
   #define TWI_ST_DATA_LOST_ACK  0xC8  // Last data byte in TWDR has been transmitted (TWEA = '0'); ACK has been received
 
 
-  /* @var error status */  
+  // hot path counters, make STATS=1
+  #ifndef TWI_STATS
+    #define TWI_STATS           0
+  #endif
+
+  /** @struct hot path counters */
+  typedef struct {
+    // START conditions
+    unsigned long int starts;
+    // bytes sent / received, address included
+    unsigned long int bytes;
+    // busy wait iterations on TWINT
+    unsigned long int waits;
+    // unexpected status, index TWI_STATUS >> 3
+    unsigned int status[32];
+  } TWI_Stats;
+
+  #if TWI_STATS
+    // increment counter
+    #define TWI_STATS_INC(FIELD)        { _twi_stats.FIELD++; }
+    // count unexpected status
+    #define TWI_STATS_STATUS(STATUS)    { _twi_stats.status[((STATUS) >> 3) & 0x1F]++; }
+    /* @var hot path counters */
+    extern TWI_Stats _twi_stats;
+  #else
+    #define TWI_STATS_INC(FIELD)
+    #define TWI_STATS_STATUS(STATUS)
+  #endif
+
+  // bus trace into RAM ring, make TRACE=1
+  #ifndef TWI_TRACE
+    #define TWI_TRACE           0
+  #endif
+  // @const number of records, oldest overwritten, max 255
+  #ifndef TWI_TRACE_SIZE
+    #define TWI_TRACE_SIZE      64
+  #endif
+  // @const trace events
+  #define TWI_EVENT_START       'S'
+  #define TWI_EVENT_SLAW        'W'
+  #define TWI_EVENT_SLAR        'R'
+  #define TWI_EVENT_BYTE        'B'
+  #define TWI_EVENT_RECEIVE     'r'
+  #define TWI_EVENT_STOP        'P'
+  // @const stop has no status
+  #define TWI_STATUS_NONE       0xF8
+
+  /** @struct one bus event */
+  typedef struct {
+    // TWI_EVENT_*
+    char event;
+    // address or data byte
+    char data;
+    // TWI_STATUS after event
+    char status;
+    // Timer1 ticks at end of event
+    unsigned int stamp;
+  } TWI_Record;
+
+  /** @struct ring of bus events */
+  typedef struct {
+    // records
+    TWI_Record record[TWI_TRACE_SIZE];
+    // next record to write
+    unsigned char head;
+    // number of valid records
+    unsigned char count;
+  } TWI_Trace;
+
+  #if TWI_TRACE
+    // append record
+    #define TWI_TRACE_ADD(EVENT, DATA, STATUS)  TWI_TraceAdd(EVENT, DATA, STATUS)
+    /* @var bus trace, host readable */
+    extern TWI_Trace _twi_trace;
+  #else
+    #define TWI_TRACE_ADD(EVENT, DATA, STATUS)
+  #endif
+
+  /** @struct segment of combined transfer, joined by repeated START */
+  typedef struct {
+    // 7 bit address
+    char address;
+    // TWI_WRITE or TWI_READ
+    char direction;
+    // bytes sent or received
+    char *data;
+    // number of bytes
+    unsigned char length;
+  } TWI_Segment;
+
+  /** @struct cost of other masters on bus */
+  typedef struct {
+    // arbitration lost, any step
+    unsigned int lost;
+    // START + SLA repeated after backoff
+    unsigned int retries;
+    // transactions given up - retries exhausted or lost after address
+    unsigned int aborted;
+    // backoff slots of TWI_BACKOFF_US waited
+    unsigned long int slots;
+  } TWI_Contention;
+
+  /* @var error status, last unexpected status */  
   extern char _twi_error_stat;
 
+  /** @var cost of other masters on bus */
+  extern TWI_Contention _twi_contention;
+
   /**
    * @desc    TWI init - initialise communication
    *
@@ -174,6 +315,15 @@
    */
   char TWI_Receive_Byte (void);
 
+  /**
+   * @desc    TWI Receive 1 byte, ACK - more bytes follow
+   *
+   * @param   void
+   *
+   * @return  char
+   */
+  char TWI_Receive_Byte_ACK (void);
+
   /**
    * @desc    TWI stop
    *
@@ -183,6 +333,38 @@
    */
   void TWI_Stop (void);
 
+  /**
+   * @desc    TWI transaction aborted since last call - lost to other master
+   *          after slave got part of it, or retries exhausted
+   *
+   * @param   void
+   *
+   * @return  char - 1 aborted, flag cleared
+   */
+  char TWI_Dropped (void);
+
+  /**
+   * @desc    TWI combined transfer - write and read segments joined by
+   *          repeated START, one STOP at end, no other master between
+   *
+   * @param   const TWI_Segment *
+   * @param   unsigned char - number of segments
+   *
+   * @return  char - TWI_SUCCESS, TWI_ERROR at first unexpected status
+   */
+  char TWI_Transfer (const TWI_Segment *, unsigned char);
+
+  /**
+   * @desc    TWI trace - append record, Timer1 must run
+   *
+   * @param   char - event
+   * @param   char - address or data
+   * @param   char - status
+   *
+   * @return  void
+   */
+  void TWI_TraceAdd (char, char, char);
+
   /**
    * @desc    TWI Error
    *
@@ -0,0 +1,85 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UART - polled transmit / receive
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        uart.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      uart.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include "uart.h"
+
+/**
+ * @desc    UART init - 8N1, double speed
+ *
+ * @param   unsigned int - UART_UBRR(BAUD)
+ *
+ * @return  void
+ */
+void UART_Init (unsigned int ubrr)
+{
+  // baud rate
+  UBRR0H = (unsigned char) (ubrr >> 8);
+  UBRR0L = (unsigned char) ubrr;
+  // double speed
+  UCSR0A = (1 << U2X0);
+  // receiver, transmitter
+  UCSR0B = (1 << RXEN0) | (1 << TXEN0);
+  // 8 data bits, 1 stop bit, no parity
+  UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+}
+
+/**
+ * @desc    UART send char
+ *
+ * @param   char
+ *
+ * @return  void
+ */
+void UART_PutChar (char data)
+{
+  // wait for empty transmit buffer
+  while (!(UCSR0A & (1 << UDRE0)));
+  // send
+  UDR0 = data;
+}
+
+/**
+ * @desc    UART send string
+ *
+ * @param   char *
+ *
+ * @return  void
+ */
+void UART_PutString (char *str)
+{
+  // loop through chars
+  while (*str != '\0') {
+    UART_PutChar(*str++);
+  }
+}
+
+/**
+ * @desc    UART receive char without waiting
+ *
+ * @param   void
+ *
+ * @return  int - char or UART_NO_DATA
+ */
+int UART_GetChar (void)
+{
+  // nothing received
+  if (!(UCSR0A & (1 << RXC0))) {
+    return UART_NO_DATA;
+  }
+  // received char
+  return UDR0;
+}
@@ -0,0 +1,74 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        UART - polled transmit / receive
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        uart.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      avr/io.h
+ * ---------------------------------------------------------------+
+ */
+
+/** @definition */
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <avr/io.h>
+
+  // @const baud rate
+  #define UART_BAUD              38400
+  // @const baud rate register, double speed U2X0, rounded to nearest
+  //  @8MHz 38400 -> 25, error 0.2%
+  //  @8MHz 115200 -> 8, error -3.5%
+  #define UART_UBRR(BAUD)        ((F_CPU + 4UL * (BAUD)) / (8UL * (BAUD)) - 1)
+  // @const baud rate generated by register, double speed
+  #define UART_RATE(UBRR)        (F_CPU / (8UL * ((UBRR) + 1)))
+  // @const generated baud rate within 2% of wanted, usable by #if
+  #define UART_BAUD_OK(BAUD)     (((UART_RATE(UART_UBRR(BAUD)) > (BAUD)) ? \
+                                   (UART_RATE(UART_UBRR(BAUD)) - (BAUD)) : \
+                                   ((BAUD) - UART_RATE(UART_UBRR(BAUD)))) * 50 <= (BAUD))
+  // @const no character received
+  #define UART_NO_DATA           -1
+
+  /**
+   * @desc    UART init - 8N1, double speed
+   *
+   * @param   unsigned int - UART_UBRR(BAUD)
+   *
+   * @return  void
+   */
+  void UART_Init (unsigned int);
+
+  /**
+   * @desc    UART send char
+   *
+   * @param   char
+   *
+   * @return  void
+   */
+  void UART_PutChar (char);
+
+  /**
+   * @desc    UART send string
+   *
+   * @param   char *
+   *
+   * @return  void
+   */
+  void UART_PutString (char *);
+
+  /**
+   * @desc    UART receive char without waiting
+   *
+   * @param   void
+   *
+   * @return  int - char or UART_NO_DATA
+   */
+  int UART_GetChar (void);
+
+#endif
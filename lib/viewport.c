@@ -0,0 +1,272 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Viewport over 40 column DDRAM with hardware shift
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       10.12.2020
+ * @file        viewport.c
+ * @tested      AVR Atmega328p
+ *
+ * @depend      viewport.h
+ * ---------------------------------------------------------------+
+ */
+
+// include libraries
+#include <string.h>
+#include <util/delay.h>
+#include "scheduler.h"
+#include "idle.h"
+#include "hd44780pcf8574.h"
+#include "viewport.h"
+
+/** @var marquee address */
+static char _viewport_addr = PCF8574_ADDRESS;
+
+/** @var marquee direction */
+static char _viewport_direction = HD44780_LEFT;
+
+/** @var marquee task id */
+static char _viewport_task = SCHED_NO_TASK;
+
+/**
+ * @desc    Write long text once into whole DDRAM line, padded with spaces
+ *
+ * @param   char addr
+ * @param   char row
+ * @param   char * - text, max HD44780_LINE_LENGTH chars
+ *
+ * @return  char
+ */
+char VIEWPORT_Write (char addr, char row, char *str)
+{
+  char i;
+
+  // check row
+  if ((row < 0) || (row >= HD44780_ROWS)) {
+    // error
+    return PCF8574_ERROR;
+  }
+  // start of DDRAM line, independent of display shift
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | (row == 0 ? HD44780_ROW1_START : HD44780_ROW2_START));
+  // whole line
+  for (i = 0; i < HD44780_LINE_LENGTH; i++) {
+    // text, then spaces
+    if (*str != '\0') {
+      HD44780_PCF8574_DrawChar(addr, *str++);
+    } else {
+      HD44780_PCF8574_DrawChar(addr, ' ');
+    }
+  }
+  // success
+  return PCF8574_SUCCESS;
+}
+
+/**
+ * @desc    Pan viewport, leftmost visible column = offset
+ *          Shortest way around 40 column ring is used
+ *
+ * @param   char addr
+ * @param   char offset 0 .. HD44780_LINE_LENGTH - 1
+ *
+ * @return  char
+ */
+char VIEWPORT_Pan (char addr, char offset)
+{
+  // columns to shift left
+  char delta;
+
+  // check offset
+  if ((offset < 0) || (offset >= HD44780_LINE_LENGTH)) {
+    // error
+    return PCF8574_ERROR;
+  }
+  delta = (offset - _hd44780_shadow.shift + HD44780_LINE_LENGTH) % HD44780_LINE_LENGTH;
+  // left is shorter, all shifts in one transaction
+  if (delta <= (HD44780_LINE_LENGTH / 2)) {
+    HD44780_PCF8574_SendInstructions(addr, HD44780_SHIFT | HD44780_DISPLAY | HD44780_LEFT, delta);
+  // right is shorter
+  } else {
+    HD44780_PCF8574_SendInstructions(addr, HD44780_SHIFT | HD44780_DISPLAY | HD44780_RIGHT, HD44780_LINE_LENGTH - delta);
+  }
+  // success
+  return PCF8574_SUCCESS;
+}
+
+/**
+ * @desc    Scroll viewport by one column
+ *
+ * @param   char addr
+ * @param   char direction {HD44780_RIGHT; HD44780_LEFT} - direction of text movement
+ *
+ * @return  char
+ */
+char VIEWPORT_Scroll (char addr, char direction)
+{
+  // one instruction
+  return HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, direction);
+}
+
+/**
+ * @desc    Marquee task - one column per release
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void VIEWPORT_MarqueeTask (void)
+{
+  // one instruction per step
+  VIEWPORT_Scroll(_viewport_addr, _viewport_direction);
+}
+
+/**
+ * @desc    Start marquee - auto scroll by scheduler task
+ *
+ * @param   char addr
+ * @param   char direction {HD44780_RIGHT; HD44780_LEFT}
+ * @param   unsigned int period in ms per column
+ *
+ * @return  char
+ */
+char VIEWPORT_MarqueeStart (char addr, char direction, unsigned int period)
+{
+  // check direction and period
+  if (((direction != HD44780_RIGHT) && (direction != HD44780_LEFT)) || (period == 0)) {
+    // error
+    return PCF8574_ERROR;
+  }
+  // restart with new parameters
+  VIEWPORT_MarqueeStop();
+  _viewport_addr = addr;
+  _viewport_direction = direction;
+  // first step after one period
+  _viewport_task = SCHED_AddTask(VIEWPORT_MarqueeTask, period, period);
+  // task table full
+  if (_viewport_task == SCHED_NO_TASK) {
+    // error
+    return PCF8574_ERROR;
+  }
+  // success
+  return PCF8574_SUCCESS;
+}
+
+/**
+ * @desc    Stop marquee
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void VIEWPORT_MarqueeStop (void)
+{
+  // running
+  if (_viewport_task != SCHED_NO_TASK) {
+    SCHED_DeleteTask(_viewport_task);
+    _viewport_task = SCHED_NO_TASK;
+  }
+}
+
+/**
+ * @desc    Current viewport offset
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char VIEWPORT_Offset (void)
+{
+  // from shadow
+  return _hd44780_shadow.shift;
+}
+
+/**
+ * @desc    Hidden page - DDRAM column where next screen is rendered
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char VIEWPORT_PageHidden (void)
+{
+  // page 1 visible -> render into page 0
+  return (_hd44780_shadow.shift == VIEWPORT_PAGE_1) ? VIEWPORT_PAGE_0 : VIEWPORT_PAGE_1;
+}
+
+/**
+ * @desc    Draw string into hidden page, only changed characters are sent
+ *
+ * @param   char addr
+ * @param   char x
+ * @param   char y
+ * @param   char * - text, clipped to page width
+ *
+ * @return  char
+ */
+char VIEWPORT_PageDraw (char addr, char x, char y, char *str)
+{
+  unsigned char i = 0;
+  char line[HD44780_COLS + 1];
+
+  // check position
+  if ((x < 0) || (x >= HD44780_COLS) || (y < 0) || (y >= HD44780_ROWS)) {
+    // error
+    return PCF8574_ERROR;
+  }
+  // clip to page
+  while ((str[i] != '\0') && ((x + i) < HD44780_COLS)) {
+    line[i] = str[i];
+    i++;
+  }
+  line[i] = '\0';
+  // diff against DDRAM mirror
+  HD44780_PCF8574_UpdateString(addr, (y == 0 ? HD44780_ROW1_START : HD44780_ROW2_START) + VIEWPORT_PageHidden() + x, line);
+  // success
+  return PCF8574_SUCCESS;
+}
+
+/**
+ * @desc    Clear hidden page, only non space characters are sent
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void VIEWPORT_PageClear (char addr)
+{
+  char y;
+  char line[HD44780_COLS + 1];
+
+  // spaces
+  memset(line, ' ', HD44780_COLS);
+  line[HD44780_COLS] = '\0';
+  // both rows
+  for (y = 0; y < HD44780_ROWS; y++) {
+    VIEWPORT_PageDraw(addr, 0, y, line);
+  }
+}
+
+/**
+ * @desc    Reveal hidden page
+ *          page 0 - return home, single instruction
+ *          page 1 - display shifts in one TWI transaction
+ *
+ * @param   char addr
+ *
+ * @return  void
+ */
+void VIEWPORT_PageFlip (char addr)
+{
+  // page 0
+  if (VIEWPORT_PageHidden() == VIEWPORT_PAGE_0) {
+    // shift = 0 and address counter = 0
+    HD44780_PCF8574_SendInstruction(addr, HD44780_RETURN_HOME);
+    // delay > 1.52ms
+    IDLE_DELAY_MS(HD44780_CLEAR_MS);
+  // page 1
+  } else {
+    VIEWPORT_Pan(addr, VIEWPORT_PAGE_1);
+  }
+}
@@ -0,0 +1,130 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Viewport over 40 column DDRAM with hardware shift
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       10.12.2020
+ * @file        viewport.h
+ * @tested      AVR Atmega328p
+ *
+ * @depend      hd44780pcf8574.h, scheduler.h
+ * ---------------------------------------------------------------+
+ */
+
+/** @definition */
+#ifndef __VIEWPORT_H__
+#define __VIEWPORT_H__
+
+  // @const page columns in DDRAM, page 1 is hidden while page 0 is shown
+  #define VIEWPORT_PAGE_0        0
+  #define VIEWPORT_PAGE_1        HD44780_COLS
+
+  // Display shift moves both rows together, viewport offset is common
+  // for both lines. Every step is one instruction (one byte on HD44780).
+
+  /**
+   * @desc    Write long text once into whole DDRAM line, padded with spaces
+   *
+   * @param   char addr
+   * @param   char row
+   * @param   char * - text, max HD44780_LINE_LENGTH chars
+   *
+   * @return  char
+   */
+  char VIEWPORT_Write (char, char, char *);
+
+  /**
+   * @desc    Pan viewport, leftmost visible column = offset
+   *          Shortest way around 40 column ring is used
+   *
+   * @param   char addr
+   * @param   char offset 0 .. HD44780_LINE_LENGTH - 1
+   *
+   * @return  char
+   */
+  char VIEWPORT_Pan (char, char);
+
+  /**
+   * @desc    Scroll viewport by one column
+   *
+   * @param   char addr
+   * @param   char direction {HD44780_RIGHT; HD44780_LEFT} - direction of text movement
+   *
+   * @return  char
+   */
+  char VIEWPORT_Scroll (char, char);
+
+  /**
+   * @desc    Start marquee - auto scroll by scheduler task
+   *
+   * @param   char addr
+   * @param   char direction {HD44780_RIGHT; HD44780_LEFT}
+   * @param   unsigned int period in ms per column
+   *
+   * @return  char
+   */
+  char VIEWPORT_MarqueeStart (char, char, unsigned int);
+
+  /**
+   * @desc    Stop marquee
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void VIEWPORT_MarqueeStop (void);
+
+  /**
+   * @desc    Current viewport offset
+   *
+   * @param   void
+   *
+   * @return  char
+   */
+  char VIEWPORT_Offset (void);
+
+  /**
+   * @desc    Hidden page - DDRAM column where next screen is rendered
+   *
+   * @param   void
+   *
+   * @return  char
+   */
+  char VIEWPORT_PageHidden (void);
+
+  /**
+   * @desc    Draw string into hidden page, only changed characters are sent
+   *
+   * @param   char addr
+   * @param   char x
+   * @param   char y
+   * @param   char * - text, clipped to page width
+   *
+   * @return  char
+   */
+  char VIEWPORT_PageDraw (char, char, char, char *);
+
+  /**
+   * @desc    Clear hidden page, only non space characters are sent
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void VIEWPORT_PageClear (char);
+
+  /**
+   * @desc    Reveal hidden page
+   *          page 0 - return home, single instruction
+   *          page 1 - display shifts in one TWI transaction
+   *
+   * @param   char addr
+   *
+   * @return  void
+   */
+  void VIEWPORT_PageFlip (char);
+
+#endif
@@ -10,13 +10,177 @@
  * @file        voltmeter.c
  * @tested      AVR Atmega328p
  *
- * @depend      hd44780pcf8574.h, adc.h, voltmeter.h
+ * @depend      hd44780pcf8574.h, adc.h, binding.h, pt.h, prof.h, screens.h, scheduler.h, stats.h, voltmeter.h
  * ---------------------------------------------------------------+
  */
-#include <util/delay.h>
+#include <avr/wdt.h>
 #include "adc.h"
+#include "binding.h"
+#include "pt.h"
+#include "screens.h"
+#include "scheduler.h"
 #include "voltmeter.h"
 #include "hd44780pcf8574.h"
+#include "prof.h"
+#include "stats.h"
+
+/** @var last adc value */
+static unsigned int _voltmeter_adc = 0;
+
+/** @var voltage field */
+static BIND_Field _voltmeter_field;
+
+/** @var display setup state */
+static PT_Thread _voltmeter_pt;
+
+/** @var display setup task id */
+static char _voltmeter_setup = SCHED_NO_TASK;
+
+/** @var reset cause, MCUSR */
+static unsigned char _voltmeter_reset = 0;
+
+/** @var display ready flag */
+static char _voltmeter_ready = 0;
+
+// tasks
+static void VoltmeterSetup (void);
+static void VoltmeterSample (void);
+static void VoltmeterFormat (void);
+static void VoltmeterRefresh (void);
+static void VoltmeterScrub (void);
+
+/**
+ * @desc   Voltmeter display setup - resumable
+ *
+ * @param  void
+ *
+ * @return char
+ */
+static char VoltmeterDisplay (void)
+{
+  PT_Thread *pt = &_voltmeter_pt;
+
+  PT_BEGIN(pt);
+
+  // watchdog reset while LCD kept power - content stays, no cold init
+  if (!(_voltmeter_reset & (1 << WDRF)) || (HD44780_PCF8574_InitWarm(PCF8574_ADDRESS) != PCF8574_SUCCESS)) {
+
+    // init LCD with address, yields during controller waits
+    PT_WAIT_UNTIL(pt, HD44780_PCF8574_InitAsync(PCF8574_ADDRESS) != PCF8574_PENDING);
+
+    // DISPLAY - SCREEN TEXT
+    // -------------------------------------------------
+    // display on
+    HD44780_PCF8574_DisplayOn(PCF8574_ADDRESS);
+    // labels, pre-encoded from screens/voltmeter.scr
+    HD44780_PCF8574_DrawScreen(PCF8574_ADDRESS, HD44780_SCREEN_VOLTMETER);
+  }
+
+  PT_END(pt);
+}
+
+/**
+ * @desc   Voltmeter task - display setup, released every tick till done
+ *
+ * @param  void
+ *
+ * @return void
+ */
+static void VoltmeterSetup (void)
+{
+  // setup done
+  if (VoltmeterDisplay() == PT_ENDED) {
+    // stop polling
+    SCHED_DeleteTask(_voltmeter_setup);
+    // display ready
+    _voltmeter_ready = 1;
+    // show last value
+    SCHED_AddTask(VoltmeterRefresh, 0, 0);
+    // background check of DDRAM
+    SCHED_AddTask(VoltmeterScrub, VOLTMETER_SCRUB_PERIOD, VOLTMETER_SCRUB_PERIOD);
+  }
+}
+
+/**
+ * @desc   Format field bound to ADC counts as voltage
+ *
+ * @param  unsigned long int - ADC counts
+ * @param  char *
+ *
+ * @return char *
+ */
+static char * VoltmeterToStr (unsigned long int adc, char *str)
+{
+  // mV
+  return AdcValToDecStr((long) (VOLTMETER_FACTOR * adc), str);
+}
+
+/**
+ * @desc   Voltmeter task - read adc value
+ *
+ * @param  void
+ *
+ * @return void
+ */
+static void VoltmeterSample (void)
+{
+  // main loop alive
+  wdt_reset();
+  // read value
+  _voltmeter_adc = AdcReadADC(VOLTMETER_CHANNEL);
+  // format in the next dispatch
+  SCHED_AddTask(VoltmeterFormat, 0, 0);
+}
+
+/**
+ * @desc   Voltmeter task - calculate voltage and format string if changed
+ *
+ * @param  void
+ *
+ * @return void
+ */
+static void VoltmeterFormat (void)
+{
+  // format string only if change is outside deadband, counts converted
+  // to voltage by formatting function
+  if (BIND_Set(&_voltmeter_field, _voltmeter_adc)) {
+    // refresh in the next dispatch
+    SCHED_AddTask(VoltmeterRefresh, 0, 0);
+  }
+}
+
+/**
+ * @desc   Voltmeter task - refresh display
+ *
+ * @param  void
+ *
+ * @return void
+ */
+static void VoltmeterRefresh (void)
+{
+  // time stolen from control loop, PositionXY + DrawChar
+  PROF_ENTER(PROF_USER);
+
+  // display still in setup
+  if (!_voltmeter_ready) {
+    return;
+  }
+  // draw changed digits
+  BIND_Flush(PCF8574_ADDRESS, &_voltmeter_field);
+}
+
+/**
+ * @desc   Voltmeter task - check one DDRAM cell, repair garbled display
+ *
+ * @param  void
+ *
+ * @return void
+ */
+static void VoltmeterScrub (void)
+{
+  // one cell per release
+  HD44780_PCF8574_Scrub(PCF8574_ADDRESS);
+}
 
 /**
  * @desc   Voltmeter
@@ -27,48 +191,42 @@
  */
 void Voltmeter (void)
 {
-  char *str = " ERR0R ";
-  char addr = PCF8574_ADDRESS;
-  unsigned int adc_value;
-  unsigned long int voltage;
+  // RESET CAUSE
+  // -------------------------------------------------
+  // keep for warm init of display
+  _voltmeter_reset = MCUSR;
+  // WDRF must be cleared, otherwise watchdog stays enabled
+  MCUSR = 0;
+  wdt_disable();
 
-  // factor calculation
-  // Umax = 32.2V
-  // Udiv =  2.0V at Umax
-  float k = 32200 / (1024 * (2.00/5.00));
+  // TASKS
+  // -------------------------------------------------
+  // init scheduler, 1 ms tick
+  SCHED_Init();
+  // display setup, power on wait runs from now
+  _voltmeter_setup = SCHED_AddTask(VoltmeterSetup, 0, 1);
+
+  // voltage field at 7, 0 - 1 LSB deadband, forced refresh
+  BIND_Init(&_voltmeter_field, 7, 0, VOLTMETER_WIDTH, VoltmeterToStr, VOLTMETER_DEADBAND, VOLTMETER_MAX_AGE);
 
   // INIT PERIPHERAL
-  // -------------------------------------------------   
-  // init ADC
+  // -------------------------------------------------
+  // init ADC, overlaps with display setup
   AdcInit();
-  // init LCD with address
-  HD44780_PCF8574_Init(addr);
+  // sample every VOLTMETER_PERIOD ms
+  SCHED_AddTask(VoltmeterSample, 0, VOLTMETER_PERIOD);
 
-  // DISPLAY - SCREEN TEXT
-  // -------------------------------------------------
-  // display clear
-  HD44780_PCF8574_DisplayClear(addr);
-  // display on
-  HD44780_PCF8574_DisplayOn(addr);
-  // draw char
-  HD44780_PCF8574_DrawString(addr, "U [V]:");
-  // position
-  HD44780_PCF8574_PositionXY(addr, 0, 1);
-  // draw char
-  HD44780_PCF8574_DrawString(addr, "I [A]:");
+#if STATS_UART
+  // counters and latencies over UART
+  STATS_Init();
+#endif
+
+  // watchdog, fed by sample task
+  wdt_enable(WDTO_1S);
 
   // infinitive loop
   while (1) {
-    // read value
-    adc_value = AdcReadADC(2);
-    // calculate voltage
-    voltage = (long) (k * adc_value);
-    // set position
-    HD44780_PCF8574_PositionXY(addr, 7, 0);
-    // draw string
-    HD44780_PCF8574_DrawString(addr, AdcValToDecStr(voltage, str));
-    // delay
-    // in future -> replace with timer
-    _delay_ms(500);
+    // run released tasks, idle till next tick
+    SCHED_Dispatch();
   }
 }
@@ -16,6 +16,24 @@
 #ifndef __VOLTMETER_H__
 #define __VOLTMETER_H__
 
+  // @const adc channel
+  #define VOLTMETER_CHANNEL    2
+  // @const sample period in ms
+  #define VOLTMETER_PERIOD     500
+  // @const DDRAM scrub period in ms, one cell per period
+  #define VOLTMETER_SCRUB_PERIOD 100
+  // @const width of voltage field
+  #define VOLTMETER_WIDTH      6
+  // @const deadband in ADC counts, field is bound to raw value - one
+  //  LSB is 78 or 79 mV after truncation, so deadband in mV can't work
+  #define VOLTMETER_DEADBAND   1
+  // @const forced refresh in ms
+  #define VOLTMETER_MAX_AGE    5000
+  // @const factor calculation
+  //  Umax = 32.2V
+  //  Udiv =  2.0V at Umax
+  #define VOLTMETER_FACTOR     (32200 / (1024 * (2.00/5.00)))
+
   /**
    * @desc   Voltmeter
    *
@@ -0,0 +1,11 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux port shim - no MCU registers
+ * ---------------------------------------------------------------+
+ */
+#ifndef __LINUX_AVR_IO_H__
+#define __LINUX_AVR_IO_H__
+
+#include <stdint.h>
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux example - HD44780 behind /dev/i2c-N
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       20.12.2020
+ * @file        main.c
+ * @tested      Linux, i2c-dev
+ *
+ * @usage       lcd [/dev/i2c-N] [text]
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lib/hd44780pcf8574.h"
+#include "lib/i2cdev.h"
+
+/**
+ * @desc    Milliseconds since start, time base of async calls
+ *
+ * @param   void
+ *
+ * @return  unsigned int
+ */
+unsigned int SCHED_Millis (void)
+{
+  static struct timespec start;
+  struct timespec now;
+
+  // first call
+  if (!start.tv_sec && !start.tv_nsec) {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (unsigned int) ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+/**
+ * @desc    Time base always running
+ *
+ * @param   void
+ *
+ * @return  char
+ */
+char SCHED_Running (void)
+{
+  return 1;
+}
+
+/**
+ * @desc    Main function
+ *
+ * @param   int
+ * @param   char **
+ *
+ * @return  int
+ */
+int main (int argc, char **argv)
+{
+  char addr = PCF8574_ADDRESS;
+
+  // adapter, default I2CDEV_PATH
+  if (I2CDEV_Open((argc > 1) ? argv[1] : I2CDEV_PATH) != I2CDEV_SUCCESS) {
+    perror((argc > 1) ? argv[1] : I2CDEV_PATH);
+    return EXIT_FAILURE;
+  }
+
+  // init, text
+  HD44780_PCF8574_Init(addr);
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_DisplayClear(addr);
+  HD44780_PCF8574_DrawString(addr, "HD44780 PCF8574");
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawString(addr, (argc > 2) ? argv[2] : "Linux i2c-dev");
+
+  printf("%lu syscalls, %lu errors\n", _i2cdev_syscalls, _i2cdev_errors);
+
+  return _i2cdev_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux port shim - atomic block, no interrupts
+ * ---------------------------------------------------------------+
+ */
+#ifndef __LINUX_UTIL_ATOMIC_H__
+#define __LINUX_UTIL_ATOMIC_H__
+
+#define ATOMIC_RESTORESTATE  0
+#define ATOMIC_BLOCK(TYPE)   for (int _linux_atomic = 1; _linux_atomic; _linux_atomic = 0)
+
+#endif
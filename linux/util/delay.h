@@ -0,0 +1,16 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Linux port shim - waits go through I2C transport
+ * ---------------------------------------------------------------+
+ *              Short waits are covered by bus time of buffered bytes,
+ *              longer ones send buffer and sleep, see i2cdev.h.
+ */
+#ifndef __LINUX_UTIL_DELAY_H__
+#define __LINUX_UTIL_DELAY_H__
+
+void I2CDEV_Delay (double);
+
+#define _delay_us(US)        I2CDEV_Delay((US) * 1000.0)
+#define _delay_ms(MS)        I2CDEV_Delay((MS) * 1000000.0)
+
+#endif
@@ -12,6 +12,8 @@
  * ---------------------------------------------------+
  */
 #include "lib/voltmeter.h"
+#include "lib/copro.h"
+#include "lib/bridge.h"
 
 /**
  * @desc   Main function
@@ -22,8 +24,16 @@
  */
 int main(void)
 {
+#if COPRO
+  // display coprocessor, make COPRO=1
+  Copro();
+#elif BRIDGE
+  // UART bridge, make BRIDGE=1
+  Bridge();
+#else
   // voltmeter
   Voltmeter();
+#endif
 
   // EXIT
   // ------------------------------------------------- 
@@ -0,0 +1,18 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - interrupts, vectors called by simulator
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_AVR_INTERRUPT_H__
+#define __SIM_AVR_INTERRUPT_H__
+
+#include <avr/io.h>
+
+// global interrupt flag
+extern volatile uint8_t sim_sreg_i;
+
+#define ISR(VECTOR)          void VECTOR (void)
+#define sei()                { sim_sreg_i = 1; }
+#define cli()                { sim_sreg_i = 0; }
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - ATmega328p registers for simulator
+ * ---------------------------------------------------------------+
+ *              Plain registers are variables. TWCR, TCNT1, UCSR0A,
+ *              ADCSRA, ADCL, ADCH, PORTD, DDRD, PIND and DDRB, PINB are
+ *              hooks into simulator - TWI bus, virtual time, UART, mocked
+ *              ADC input, GPIO wired LCD and software I2C lanes.
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_AVR_IO_H__
+#define __SIM_AVR_IO_H__
+
+#include <stdint.h>
+
+#define __AVR_ATmega328P__   1
+
+// plain registers
+#define SIM_REG(NAME)        extern volatile uint8_t NAME;
+SIM_REG(TWAR) SIM_REG(TWBR) SIM_REG(TWDR) SIM_REG(TWSR)
+SIM_REG(TCCR0A) SIM_REG(TCCR0B) SIM_REG(OCR0A) SIM_REG(TIMSK0) SIM_REG(TCNT0) SIM_REG(TIFR0)
+SIM_REG(TCCR1A) SIM_REG(TCCR1B) SIM_REG(TIMSK1) SIM_REG(TIFR1)
+SIM_REG(TCCR2A) SIM_REG(OCR2A) SIM_REG(TIMSK2) SIM_REG(TCNT2) SIM_REG(TIFR2) SIM_REG(ASSR)
+SIM_REG(ADMUX) SIM_REG(MCUSR)
+SIM_REG(UCSR0B) SIM_REG(UCSR0C) SIM_REG(UBRR0H) SIM_REG(UBRR0L)
+SIM_REG(PORTB) SIM_REG(PORTC) SIM_REG(DDRC) SIM_REG(PINC)
+extern volatile uint16_t OCR1A, UBRR0, ADC;
+// transmit sentinel 0xFFFF = empty
+extern volatile uint16_t UDR0;
+// global interrupt flag, read only
+extern volatile uint8_t sim_sreg_i;
+#define SREG                 ((uint8_t) (sim_sreg_i << SREG_I))
+#define SREG_I               7
+
+// hooks
+volatile uint8_t *sim_twcr (void);
+volatile uint16_t *sim_tcnt1 (void);
+volatile uint8_t *sim_tccr2b (void);
+volatile uint8_t *sim_ucsr0a (void);
+volatile uint8_t *sim_adcsra (void);
+volatile uint8_t *sim_adcl (void);
+volatile uint8_t *sim_adch (void);
+volatile uint8_t *sim_portd (void);
+volatile uint8_t *sim_ddrd (void);
+volatile uint8_t *sim_pind (void);
+volatile uint8_t *sim_ddrb (void);
+volatile uint8_t *sim_pinb (void);
+#define TWCR                 (*sim_twcr())
+#define TCNT1                (*sim_tcnt1())
+#define TCCR2B               (*sim_tccr2b())
+#define UCSR0A               (*sim_ucsr0a())
+#define ADCSRA               (*sim_adcsra())
+#define ADCL                 (*sim_adcl())
+#define ADCH                 (*sim_adch())
+#define PORTD                (*sim_portd())
+#define DDRD                 (*sim_ddrd())
+#define PIND                 (*sim_pind())
+#define DDRB                 (*sim_ddrb())
+#define PINB                 (*sim_pinb())
+
+// TWI
+#define TWINT                7
+#define TWEA                 6
+#define TWSTA                5
+#define TWSTO                4
+#define TWWC                 3
+#define TWEN                 2
+#define TWIE                 0
+#define TWPS1                1
+#define TWPS0                0
+#define TWGCE                0
+// timers
+#define WGM01                1
+#define CS02                 2
+#define CS01                 1
+#define CS00                 0
+#define OCIE0A               1
+#define OCF0A                1
+#define CS12                 2
+#define CS11                 1
+#define CS10                 0
+#define WGM21                1
+#define CS22                 2
+#define CS21                 1
+#define CS20                 0
+#define OCIE2A               1
+#define OCF2A                1
+// ADC
+#define REFS0                6
+#define REFS1                7
+#define ADLAR                5
+#define ADEN                 7
+#define ADSC                 6
+#define ADIF                 4
+#define ADIE                 3
+#define ADPS2                2
+#define ADPS1                1
+#define ADPS0                0
+// reset cause
+#define WDRF                 3
+#define BORF                 2
+#define EXTRF                1
+#define PORF                 0
+// UART
+#define RXC0                 7
+#define TXC0                 6
+#define UDRE0                5
+#define DOR0                 3
+#define U2X0                 1
+#define RXCIE0               7
+#define UDRIE0               5
+#define RXEN0                4
+#define TXEN0                3
+#define UCSZ01               2
+#define UCSZ00               1
+// ports
+#define PC4                  4
+#define PC5                  5
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - flash is ordinary memory
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_AVR_PGMSPACE_H__
+#define __SIM_AVR_PGMSPACE_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(STR)            (STR)
+#define pgm_read_byte(ADDR)  (*(const uint8_t *) (ADDR))
+#define pgm_read_word(ADDR)  (*(const uint16_t *) (ADDR))
+#define strcpy_P(DST, SRC)   strcpy((DST), (SRC))
+#define memcpy_P(DST, SRC, N) memcpy((DST), (SRC), (N))
+
+#endif
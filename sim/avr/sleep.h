@@ -0,0 +1,20 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - sleep skips virtual time to next tick
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_AVR_SLEEP_H__
+#define __SIM_AVR_SLEEP_H__
+
+#include <avr/io.h>
+
+void sim_sleep (void);
+
+#define SLEEP_MODE_IDLE      0
+#define set_sleep_mode(MODE)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()          sim_sleep()
+#define sleep_mode()         sim_sleep()
+
+#endif
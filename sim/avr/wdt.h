@@ -0,0 +1,15 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - watchdog, not simulated
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_AVR_WDT_H__
+#define __SIM_AVR_WDT_H__
+
+#define WDTO_500MS           5
+#define WDTO_1S              6
+#define wdt_reset()
+#define wdt_disable()
+#define wdt_enable(TIMEOUT)
+
+#endif
@@ -0,0 +1,718 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - golden screen regression test
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       17.12.2020
+ * @file        golden.c
+ * @tested      gcc, Linux
+ *
+ * @usage       golden [-u] <api|voltmeter|copro|utf8|term|bridge> <golden file>
+ *
+ *              Runs scenario against HD44780 model, snapshots visible
+ *              16x2 characters, display control and CGRAM after each
+ *              step and compares them with golden file. Option -u
+ *              writes golden file instead. Exit status 1 on first
+ *              difference or on any timing violation.
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <util/crc16.h>
+#include "lib/hd44780pcf8574.h"
+#include "lib/viewport.h"
+#include "lib/voltmeter.h"
+#include "lib/copro.h"
+#include "lib/charset.h"
+#include "lib/term.h"
+#include "lib/bridge.h"
+#include "lib/screens.h"
+#include "hd44780.h"
+#include "sim.h"
+
+// @const voltmeter run length in ms
+#define GOLDEN_END_MS        8000
+
+/** @var snapshots of scenario */
+static FILE *_golden_out;
+
+/** @var step of voltmeter scenario */
+static int _golden_step = 0;
+
+/**
+ * @desc    Snapshot of visible panel
+ *
+ * @param   const char * - step name
+ *
+ * @return  void
+ */
+static void snapshot (const char *name)
+{
+  uint8_t c;
+  int row;
+  int col;
+  int i;
+
+  // frame with visible text, display shift applied
+  fprintf(_golden_out, "== %s\n+----------------+\n", name);
+  for (row = 0; row < HD44780_ROWS; row++) {
+    fputc('|', _golden_out);
+    for (col = 0; col < HD44780_COLS; col++) {
+      c = hd44780[0].ddram[(row ? 0x40 : 0x00) + (col + hd44780[0].shift) % HD44780_LINE];
+      // CGRAM and non ASCII codes listed below frame
+      fputc(((c < 0x20) || (c > 0x7E)) ? '?' : c, _golden_out);
+    }
+    fprintf(_golden_out, "|\n");
+  }
+  fprintf(_golden_out, "+----------------+\n");
+  // codes behind '?'
+  for (row = 0; row < HD44780_ROWS; row++) {
+    for (col = 0; col < HD44780_COLS; col++) {
+      c = hd44780[0].ddram[(row ? 0x40 : 0x00) + (col + hd44780[0].shift) % HD44780_LINE];
+      if ((c < 0x20) || (c > 0x7E)) {
+        fprintf(_golden_out, "code %d,%d 0x%02X\n", col, row, c);
+      }
+    }
+  }
+  // display control
+  fprintf(_golden_out, "display %s, cursor %s, blink %s",
+    (hd44780[0].control & 0x04) ? "on" : "off",
+    (hd44780[0].control & 0x02) ? "on" : "off",
+    (hd44780[0].control & 0x01) ? "on" : "off");
+  // cursor position only if visible
+  if (hd44780[0].control & 0x02) {
+    fprintf(_golden_out, " at 0x%02X", hd44780[0].ac);
+  }
+  fprintf(_golden_out, "\n");
+  // CGRAM, 8 characters of 8 rows
+  for (i = 0; i < 0x40; i++) {
+    fprintf(_golden_out, "%s%02X%s", (i % 8) ? " " : "cgram ", hd44780[0].cgram[i] & 0x1F, ((i % 8) == 7) ? "\n" : "");
+  }
+}
+
+/**
+ * @desc    Public API, every step snapshot
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_api (void)
+{
+  // custom character - arrow
+  static const uint8_t arrow[8] = { 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 };
+  char addr = PCF8574_ADDRESS;
+  int i;
+
+  // cold init
+  HD44780_PCF8574_Init(addr);
+  snapshot("init");
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_DisplayClear(addr);
+  snapshot("display on, clear");
+
+  // text
+  HD44780_PCF8574_PositionXY(addr, 0, 0);
+  HD44780_PCF8574_DrawString(addr, "HD44780 PCF8574");
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawChar(addr, '>');
+  HD44780_PCF8574_DrawString(addr, "golden");
+  snapshot("draw string, char");
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW2_START + 1, "screen");
+  snapshot("update string");
+  // overlong string stops at last cell of line, seen after shift right
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START + HD44780_LINE_LENGTH - 2, "<>lost");
+  HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, HD44780_RIGHT);
+  snapshot("update string at line end");
+  HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, HD44780_LEFT);
+
+  // custom character 0 at last column
+  HD44780_PCF8574_SendInstruction(addr, HD44780_CGRAM | 0x00);
+  for (i = 0; i < 8; i++) {
+    HD44780_PCF8574_SendData(addr, arrow[i]);
+  }
+  HD44780_PCF8574_PositionXY(addr, 15, 1);
+  HD44780_PCF8574_DrawChar(addr, 0x00);
+  snapshot("custom character");
+
+  // display shift
+  HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, HD44780_LEFT);
+  snapshot("shift left");
+  HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, HD44780_RIGHT);
+  snapshot("shift right");
+
+  // cursor
+  HD44780_PCF8574_PositionXY(addr, 8, 0);
+  HD44780_PCF8574_CursorOn(addr);
+  snapshot("cursor on");
+  HD44780_PCF8574_CursorBlink(addr);
+  snapshot("cursor blink");
+  HD44780_PCF8574_DisplayOn(addr);
+
+  // pre-encoded screen
+  HD44780_PCF8574_DisplayClear(addr);
+  HD44780_PCF8574_DrawScreen(addr, HD44780_SCREEN_VOLTMETER);
+  snapshot("draw screen");
+
+  // page flipping
+  VIEWPORT_PageDraw(addr, 0, 0, "Page 1");
+  VIEWPORT_PageDraw(addr, 0, 1, "hidden till flip");
+  snapshot("page drawn");
+  VIEWPORT_PageFlip(addr);
+  snapshot("page flip");
+  VIEWPORT_PageFlip(addr);
+  snapshot("page flip back");
+
+  // glass garbled, repaired cell by cell from mirror
+  hd44780[0].ddram[0x00] = '#';
+  hd44780[0].ddram[0x45] = '#';
+  snapshot("garbled");
+  for (i = 0; i < 2 * HD44780_LINE; ) {
+    if (HD44780_PCF8574_Scrub(addr) != PCF8574_PENDING) {
+      i++;
+    }
+  }
+  snapshot("scrubbed");
+
+  // controller reset, DDRAM and CGRAM lost
+  hd44780_brownout(0);
+  snapshot("controller reset");
+  HD44780_PCF8574_Recover(addr);
+  snapshot("recovered");
+}
+
+/**
+ * @desc    Voltmeter steps at idle of main loop
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void voltmeter_idle (void)
+{
+  // step time in ms, new ADC input or -1
+  static const struct {
+    unsigned int ms;
+    int adc;
+    const char *name;
+  } steps[] = {
+    { 10,    -1,  "power on wait" },
+    { 100,   -1,  "setup done, 100 LSB" },
+    { 700,   101, "input 101 LSB" },
+    { 1200,  -1,  "sampled inside deadband" },
+    { 1300,  301, "input 301 LSB" },
+    { 1700,  302, "sampled new value" },
+    { 2200,  300, "sampled 302 inside deadband" },
+    { 2700,  -1,  "sampled 300 inside deadband" },
+    { 2800,  -1,  "glass garbled" },
+    { 4500,  -1,  "label repaired by scrub" },
+    { 7000,  -1,  "digits rewritten by max age" },
+  };
+
+  // next step due
+  if ((_golden_step < (int) (sizeof(steps) / sizeof(steps[0]))) && (sim_ns >= steps[_golden_step].ms * 1000000ULL)) {
+    // input for next samples
+    if (steps[_golden_step].adc >= 0) {
+      sim_adc[VOLTMETER_CHANNEL] = steps[_golden_step].adc;
+    }
+    // digit of value and label behind driver
+    if (!strcmp(steps[_golden_step].name, "glass garbled")) {
+      hd44780[0].ddram[0x08] = '#';
+      hd44780[0].ddram[0x41] = '#';
+    }
+    snapshot(steps[_golden_step].name);
+    _golden_step++;
+  }
+  // leave endless loop
+  if (sim_ns >= GOLDEN_END_MS * 1000000ULL) {
+    longjmp(sim_exit, 1);
+  }
+}
+
+/**
+ * @desc    Voltmeter main loop with mocked ADC, every step snapshot
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_voltmeter (void)
+{
+  // 100 LSB at input
+  sim_adc[VOLTMETER_CHANNEL] = 100;
+  sim_idle = voltmeter_idle;
+  // never returns
+  if (!setjmp(sim_exit)) {
+    Voltmeter();
+  }
+  sim_idle = NULL;
+}
+
+#if COPRO
+/**
+ * @desc    Main controller writes coprocessor registers, every write
+ *          snapshot after flush with LCD traffic it caused
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void copro_idle (void)
+{
+  // step time in ms, register write, register first
+  static const struct {
+    unsigned int ms;
+    const char *name;
+    int n;
+    uint8_t data[20];
+  } steps[] = {
+    { 5,    "written during LCD setup", 17, { COPRO_REG_TEXT, 'H', 'D', '4', '4', '7', '8', '0', ' ', 'c', 'o', 'p', 'r', 'o', ' ', ' ', ' ' } },
+    { 100,  "row 1",                    17, { COPRO_REG_TEXT + 16, 'v', 'a', 'l', 'u', 'e', ' ', ' ', ' ', '1', '7', ' ', 'm', 'V', ' ', ' ', ' ' } },
+    { 200,  "two cells",                 3, { COPRO_REG_TEXT + 24, '4', '2' } },
+    { 300,  "cgram arrow",               9, { COPRO_REG_CGRAM + 8, 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00 } },
+    { 400,  "arrow shown",               2, { COPRO_REG_TEXT + 31, 0x01 } },
+    { 500,  "cursor blink at 5",         3, { COPRO_REG_CURSOR, 0x05, COPRO_CONTROL_DISPLAY | COPRO_CONTROL_CURSOR | COPRO_CONTROL_BLINK } },
+    { 600,  "backlight off",             2, { COPRO_REG_BACKLIGHT, 0 } },
+    { 700,  "same text again",          17, { COPRO_REG_TEXT, 'H', 'D', '4', '4', '7', '8', '0', ' ', 'c', 'o', 'p', 'r', 'o', ' ', ' ', ' ' } },
+  };
+  static unsigned long data = 0;
+  static unsigned long instructions = 0;
+  uint8_t back[5];
+
+  // step due, previous one flushed by now
+  if ((_golden_step <= (int) (sizeof(steps) / sizeof(steps[0]))) &&
+      ((_golden_step == (int) (sizeof(steps) / sizeof(steps[0]))) ? (sim_ns >= 800 * 1000000ULL) : (sim_ns >= steps[_golden_step].ms * 1000000ULL))) {
+    // result of previous write
+    if (_golden_step > 0) {
+      snapshot(steps[_golden_step - 1].name);
+      fprintf(_golden_out, "backlight %s, %lu data, %lu instructions\n",
+        (hd44780[0].bus.pins & PCF8574_PIN_P3) ? "on" : "off", hd44780[0].data - data, hd44780[0].instructions - instructions);
+    }
+    data = hd44780[0].data;
+    instructions = hd44780[0].instructions;
+    // next write
+    if (_golden_step < (int) (sizeof(steps) / sizeof(steps[0]))) {
+      if (sim_slave_write(COPRO_ADDRESS, steps[_golden_step].data, steps[_golden_step].n)) {
+        fprintf(_golden_out, "not acknowledged\n");
+      }
+    }
+    _golden_step++;
+  }
+  // read back status and cells, leave endless loop
+  if (sim_ns >= 900 * 1000000ULL) {
+    sim_slave_read(COPRO_ADDRESS, COPRO_REG_STATUS, back, 1);
+    sim_slave_read(COPRO_ADDRESS, COPRO_REG_TEXT + 24, back + 1, 4);
+    fprintf(_golden_out, "== read back\nstatus 0x%02X, cells %c%c%c%c\n", back[0], back[1], back[2], back[3], back[4]);
+    longjmp(sim_exit, 1);
+  }
+}
+
+/**
+ * @desc    Coprocessor firmware driven by register writes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_copro (void)
+{
+  sim_idle = copro_idle;
+  // never returns
+  if (!setjmp(sim_exit)) {
+    Copro();
+  }
+  sim_idle = NULL;
+}
+#endif
+
+#if BRIDGE
+/**
+ * @desc    Host sends frame, CRC optionally corrupted
+ *
+ * @param   const uint8_t * - payload
+ * @param   int - length
+ * @param   uint8_t - xor of CRC
+ *
+ * @return  void
+ */
+static void bridge_send (const uint8_t *payload, int n, uint8_t corrupt)
+{
+  uint8_t frame[3 + 255];
+  uint8_t crc;
+  int i;
+
+  frame[0] = BRIDGE_SYNC;
+  frame[1] = (uint8_t) n;
+  crc = _crc8_ccitt_update(0, (uint8_t) n);
+  for (i = 0; i < n; i++) {
+    frame[2 + i] = payload[i];
+    crc = _crc8_ccitt_update(crc, payload[i]);
+  }
+  frame[2 + n] = crc ^ corrupt;
+  if (sim_uart_write(frame, n + 3)) {
+    fprintf(_golden_out, "host queue full\n");
+  }
+}
+
+/**
+ * @desc    Host sends full screen frame
+ *
+ * @param   const char * - 32 characters
+ *
+ * @return  void
+ */
+static void bridge_screen (const char *text)
+{
+  uint8_t payload[3 + BRIDGE_CELLS] = { BRIDGE_CMD_CELLS, 0, BRIDGE_CELLS };
+
+  memcpy(payload + 3, text, BRIDGE_CELLS);
+  bridge_send(payload, sizeof(payload), 0);
+}
+
+/**
+ * @desc    Host streams frames, every step snapshot after flush with LCD
+ *          traffic and receiver counters
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void bridge_idle (void)
+{
+  static const char *names[] = {
+    "full frame during LCD setup",
+    "30 full frames back to back",
+    "bad CRC dropped",
+    "noise, glyph, cell, cursor",
+    "backlight off, unknown command",
+    "same frame again",
+  };
+  static const uint8_t glyph[] = {
+    BRIDGE_CMD_GLYPH, 1, 0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00,
+    BRIDGE_CMD_CELLS, 31, 1, 0x01,
+    BRIDGE_CMD_CURSOR, 5, BRIDGE_CONTROL_DISPLAY | BRIDGE_CONTROL_CURSOR | BRIDGE_CONTROL_BLINK
+  };
+  static const uint8_t noise[] = { 0x42, 0x17 };
+  static const uint8_t corrupted[] = { BRIDGE_CMD_CELLS, 16, 9, 'c', 'o', 'r', 'r', 'u', 'p', 't', 'e', 'd' };
+  static const uint8_t backlight[] = { BRIDGE_CMD_BACKLIGHT, 0 };
+  static const uint8_t unknown[] = { 0x09, 'x' };
+  static unsigned long data = 0;
+  static unsigned long instructions = 0;
+  char text[BRIDGE_CELLS + 1];
+  int steps = (int) (sizeof(names) / sizeof(names[0]));
+  int i;
+
+  // step due every 200 ms from 5 ms, previous one flushed by now
+  if ((_golden_step > steps) || (sim_ns < (_golden_step ? _golden_step * 200 : 5) * 1000000ULL)) {
+    return;
+  }
+  // result of previous step
+  if (_golden_step > 0) {
+    snapshot(names[_golden_step - 1]);
+    fprintf(_golden_out, "backlight %s, %lu data, %lu instructions, frames %u, errors %u, overruns %u\n",
+      (hd44780[0].bus.pins & PCF8574_PIN_P3) ? "on" : "off", hd44780[0].data - data, hd44780[0].instructions - instructions,
+      _bridge_stats.frames, _bridge_stats.errors, _bridge_stats.overruns);
+  }
+  data = hd44780[0].data;
+  instructions = hd44780[0].instructions;
+  switch (_golden_step++) {
+    case 0:
+      bridge_screen("HD44780 bridge  frame 0         ");
+      break;
+    // 1140 bytes, about 150 ms of line at 76800
+    case 1:
+      for (i = 1; i <= 30; i++) {
+        snprintf(text, sizeof(text), "HD44780 bridge  frame %-10d", i);
+        bridge_screen(text);
+      }
+      break;
+    case 2:
+      bridge_send(corrupted, sizeof(corrupted), 0x5A);
+      break;
+    case 3:
+      sim_uart_write(noise, sizeof(noise));
+      bridge_send(glyph, sizeof(glyph), 0);
+      break;
+    case 4:
+      bridge_send(backlight, sizeof(backlight), 0);
+      bridge_send(unknown, sizeof(unknown), 0);
+      break;
+    case 5:
+      snprintf(text, sizeof(text), "HD44780 bridge  frame %-10d", 30);
+      text[31] = 0x01;
+      bridge_screen(text);
+      break;
+    // leave endless loop
+    default:
+      longjmp(sim_exit, 1);
+  }
+}
+
+/**
+ * @desc    Bridge firmware driven by frames of host on UART
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_bridge (void)
+{
+  sim_idle = bridge_idle;
+  // never returns
+  if (!setjmp(sim_exit)) {
+    Bridge();
+  }
+  sim_idle = NULL;
+}
+#endif
+
+#if CHARSET_UTF8
+/**
+ * @desc    UTF-8 text - ROM codes, CGRAM glyphs, slot reuse, recovery
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_utf8 (void)
+{
+  char addr = PCF8574_ADDRESS;
+  char codes[HD44780_COLS + 1];
+
+  HD44780_PCF8574_Init(addr);
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_DisplayClear(addr);
+
+  // units and symbols, ROM where it has them
+  HD44780_PCF8574_PositionXY(addr, 0, 0);
+  HD44780_PCF8574_DrawString(addr, "23.5\u00B0C 10\u00B5A 5\u03A9");
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawString(addr, "\u00A5100 \u2192\u2190 \uFF76\uFF85 \u00F7\u221A\u221E");
+  snapshot("units");
+
+  // accented text, glyphs uploaded into CGRAM
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawString(addr, "Cr\u00E8me br\u00FBl\u00E9e    ");
+  snapshot("accents");
+
+  // more glyphs than free slots, cells on glass keep theirs
+  HD44780_PCF8574_PositionXY(addr, 0, 0);
+  HD44780_PCF8574_DrawString(addr, "\u010D\u0161\u0159\u017E\u00FD \u00E1\u00ED\u011B\u016F\u0148     ");
+  snapshot("slots full");
+
+  // row cleared, least recently used slots taken again
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawString(addr, "                ");
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawString(addr, "\u00C4\u00D6\u00DC \u20AC\u2191\u2193 \xF0\x9F\x98\x80 \x80");
+  snapshot("slots reused");
+
+  // translated for diff update, only changed cells sent
+  CHARSET_Translate(addr, codes, "\u010D\u0161\u0159\u017E\u00FD \u00E9t\u00E9", sizeof(codes));
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START, codes);
+  snapshot("translate, update");
+
+  // controller reset, glyphs uploaded again
+  hd44780_brownout(0);
+  HD44780_PCF8574_Recover(addr);
+  snapshot("recovered");
+
+  // overlong NUL, overlong slash, surrogate, overlong 4 bytes - no code 0
+  CHARSET_Translate(addr, codes, "A" "\xC0\x80" "B \xE0\x80\xAF \xED\xA0\x80 \xF0\x80\x80\x80 end", sizeof(codes));
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW2_START, codes);
+  snapshot("overlong, surrogate");
+}
+#endif
+
+#if TERM
+/**
+ * @desc    Snapshot named by cells written since last one
+ *
+ * @param   const char * - step name
+ *
+ * @return  void
+ */
+static void snapshot_cells (const char *step)
+{
+  static unsigned long int data = 0;
+  char name[64];
+
+  // minimal rewrite visible in golden file
+  snprintf(name, sizeof(name), "%s, %lu cells", step, hd44780[0].data - data);
+  snapshot(name);
+  data = hd44780[0].data;
+}
+
+/**
+ * @desc    Terminal - wrap, newline scroll, carriage return, VT100
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_term (void)
+{
+  char addr = PCF8574_ADDRESS;
+
+  HD44780_PCF8574_Init(addr);
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_DisplayClear(addr);
+  HD44780_PCF8574_CursorOn(addr);
+  TERM_Init(addr);
+  snapshot_cells("init");
+
+  // boot log, last newline scrolls
+  TERM_Puts(addr, "boot 1.2\nadc ok\n");
+  snapshot_cells("boot log");
+  TERM_Puts(addr, "twi ok");
+  snapshot_cells("scroll");
+
+  // long line wraps, full row then newline adds no empty row
+  TERM_Puts(addr, "\nsensor 1 23.5 C ok");
+  snapshot_cells("wrap");
+  TERM_Puts(addr, "\r\n0123456789abcdef\n");
+  snapshot_cells("full row");
+
+  // progress overwritten in place, only digits sent
+  TERM_Puts(addr, "load  10%");
+  TERM_Puts(addr, "\rload  55%");
+  snapshot_cells("carriage return");
+  TERM_Puts(addr, "\b\b\b\b100%");
+  snapshot_cells("backspace");
+
+  // VT100 - clear, position, erase in line
+  TERM_Puts(addr, "\x1b[2J\x1b[1;5HTIME\x1b[2;1H12:00:00");
+  snapshot_cells("clear, position");
+  TERM_Puts(addr, "\x1b[2;4H34\x1b[3C\x1b[K");
+  snapshot_cells("move, erase line");
+  TERM_Puts(addr, "\x1b[1;1H\x1b[1J\x1b[9;99H#\x1b[A\x1b[2D<\x1b[q");
+  snapshot_cells("erase start, clamp");
+}
+#endif
+
+/**
+ * @desc    Compare snapshots with golden file
+ *
+ * @param   const char * - snapshots
+ * @param   const char * - golden file
+ *
+ * @return  int - 0 = same
+ */
+static int compare (const char *out, const char *file)
+{
+  char expected[256];
+  const char *end;
+  size_t len;
+  int line = 0;
+  FILE *fp;
+
+  if ((fp = fopen(file, "r")) == NULL) {
+    fprintf(stderr, "golden: cannot open %s, run make golden\n", file);
+    return 1;
+  }
+  while (fgets(expected, sizeof(expected), fp) != NULL) {
+    line++;
+    // line of snapshots
+    end = strchr(out, '\n');
+    len = end ? (size_t) (end - out + 1) : strlen(out);
+    if ((len != strlen(expected)) || strncmp(out, expected, len)) {
+      printf("%s:%d differs\n  expected: %s  got:      %.*s%s", file, line, expected, (int) len, out, end ? "" : "<end>\n");
+      fclose(fp);
+      return 1;
+    }
+    out += len;
+  }
+  fclose(fp);
+  // snapshots longer than golden file
+  if (*out) {
+    printf("%s:%d differs\n  expected: <end>\n  got:      %.*s", file, line + 1, (int) (strchr(out, '\n') - out + 1), out);
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @desc    Main function
+ *
+ * @param   int
+ * @param   char **
+ *
+ * @return  int
+ */
+int main (int argc, char **argv)
+{
+  int update = 0;
+  int result = 0;
+  char *out = NULL;
+  size_t size = 0;
+  FILE *fp;
+
+  // write golden file
+  if ((argc > 1) && !strcmp(argv[1], "-u")) {
+    update = 1;
+    argv++;
+    argc--;
+  }
+  if (argc != 3) {
+    fprintf(stderr, "usage: golden [-u] <api|voltmeter|copro|utf8|term|bridge> <golden file>\n");
+    return EXIT_FAILURE;
+  }
+
+  // scenario, default bus clock from TWBR
+  _golden_out = open_memstream(&out, &size);
+  sim_reset(0);
+  if (!strcmp(argv[1], "api")) {
+    scenario_api();
+  } else if (!strcmp(argv[1], "voltmeter")) {
+    scenario_voltmeter();
+#if COPRO
+  } else if (!strcmp(argv[1], "copro")) {
+    scenario_copro();
+#endif
+#if CHARSET_UTF8
+  } else if (!strcmp(argv[1], "utf8")) {
+    scenario_utf8();
+#endif
+#if BRIDGE
+  } else if (!strcmp(argv[1], "bridge")) {
+    scenario_bridge();
+#endif
+#if TERM
+  } else if (!strcmp(argv[1], "term")) {
+    scenario_term();
+#endif
+  } else {
+    fprintf(stderr, "golden: unknown scenario %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  sim_flush();
+  fclose(_golden_out);
+
+  // timings are checked too
+  if (sim_violations) {
+    printf("%s: %lu violations\n", argv[1], sim_violations);
+    result = 1;
+  }
+  if (update) {
+    if ((fp = fopen(argv[2], "w")) == NULL) {
+      fprintf(stderr, "golden: cannot write %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+    fputs(out, fp);
+    fclose(fp);
+    printf("%s: %s written\n", argv[1], argv[2]);
+  } else if (compare(out, argv[2])) {
+    result = 1;
+  } else {
+    printf("%s: %s ok\n", argv[1], argv[2]);
+  }
+  free(out);
+
+  return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,360 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - HD44780 model with timing checker
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        hd44780.c
+ * @tested      gcc, Linux
+ *
+ * @depend      hd44780.h
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "sim.h"
+#include "hd44780.h"
+
+// driver layout of pins, sim.c moves wired pins here
+#define PIN_RS               0x01
+#define PIN_RW               0x02
+#define PIN_E                0x04
+#define PIN_DB               0xF0
+
+// scale execution time to slowest oscillator
+#define SLOW(NS)             (((uint64_t) (NS) * 270) / HD44780_FOSC_KHZ)
+
+/** @var controllers, one per lane */
+HD44780_Model hd44780[HD44780_LCDS];
+
+/**
+ * @desc    Report violation, lcd named only with more lanes
+ *
+ * @param   HD44780_Model * - controller
+ * @param   const char * - printf format
+ *
+ * @return  void
+ */
+static void hd44780_violation (HD44780_Model *m, const char *format, ...)
+{
+  char msg[160];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(msg, sizeof(msg), format, args);
+  va_end(args);
+#if HD44780_LCDS > 1
+  sim_violation("lcd %d: %s", (int) (m - hd44780), msg);
+#else
+  (void) m;
+  sim_violation("%s", msg);
+#endif
+}
+
+/**
+ * @desc    Next DDRAM / CGRAM address
+ *
+ * @param   HD44780_Model * - controller
+ * @param   uint8_t - address
+ * @param   int - increment
+ *
+ * @return  uint8_t
+ */
+static uint8_t hd44780_next (HD44780_Model *m, uint8_t ac, int inc)
+{
+  // CGRAM wraps in 64 bytes
+  if (m->cg) {
+    return (ac + (inc ? 1 : 0x3F)) & 0x3F;
+  }
+  // two lines of 40, line 1 follows line 2
+  if (inc) {
+    return (ac == 0x27) ? 0x40 : (ac == 0x67) ? 0x00 : ac + 1;
+  }
+  return (ac == 0x40) ? 0x27 : (ac == 0x00) ? 0x67 : ac - 1;
+}
+
+/**
+ * @desc    Execute byte written to controller
+ *
+ * @param   HD44780_Model * - controller
+ * @param   uint8_t - instruction or data
+ * @param   int - RS
+ * @param   uint64_t - time
+ *
+ * @return  void
+ */
+static void hd44780_execute (HD44780_Model *m, uint8_t byte, int rs, uint64_t t)
+{
+  uint64_t exec = SLOW(HD44780_T_EXEC);
+
+  // power on
+  if (t < HD44780_T_POWER_ON) {
+    hd44780_violation(m, "power on: 0x%02X written %.3f ms after VCC, need %.1f ms", byte, t / 1e6, HD44780_T_POWER_ON / 1e6);
+  // previous one still executes
+  } else if (t < m->busy) {
+    hd44780_violation(m, "busy: 0x%02X written %.3f us before 0x%02X finished", byte, (m->busy - t) / 1e3, m->last);
+  }
+  m->last = byte;
+
+  // data
+  if (rs) {
+    if (m->cg) {
+      m->cgram[m->ac] = byte;
+    } else {
+      m->ddram[m->ac] = byte;
+    }
+    m->ac = hd44780_next(m, m->ac, m->entry & 0x02);
+    // entry mode with display shift
+    if (m->entry & 0x01) {
+      m->shift = (m->entry & 0x02) ? (m->shift + 1) % HD44780_LINE : (m->shift + HD44780_LINE - 1) % HD44780_LINE;
+    }
+    m->data++;
+    m->busy = t + exec + SLOW(HD44780_T_ADD);
+    return;
+  }
+
+  m->instructions++;
+  // set DDRAM address
+  if (byte & 0x80) {
+    m->ac = byte & 0x7F;
+    m->cg = 0;
+  // set CGRAM address
+  } else if (byte & 0x40) {
+    m->ac = byte & 0x3F;
+    m->cg = 1;
+  // function set
+  } else if (byte & 0x20) {
+    // init by instruction, waits between 0x3 nibbles
+    if (m->mode8 && (byte & 0x10)) {
+      m->init++;
+      exec = (m->init == 1) ? HD44780_T_INIT1 : (m->init == 2) ? HD44780_T_INIT2 : exec;
+    }
+    m->mode8 = (byte & 0x10) ? 1 : 0;
+    m->function = byte;
+    m->phase = 0;
+  // cursor or display shift
+  } else if (byte & 0x10) {
+    if (byte & 0x08) {
+      m->shift = (byte & 0x04) ? (m->shift + HD44780_LINE - 1) % HD44780_LINE : (m->shift + 1) % HD44780_LINE;
+    } else {
+      m->ac = hd44780_next(m, m->ac, byte & 0x04);
+    }
+  // display control
+  } else if (byte & 0x08) {
+    m->control = byte;
+  // entry mode
+  } else if (byte & 0x04) {
+    m->entry = byte;
+  // return home
+  } else if (byte & 0x02) {
+    m->ac = 0;
+    m->cg = 0;
+    m->shift = 0;
+    exec = SLOW(HD44780_T_HOME);
+  // display clear
+  } else if (byte & 0x01) {
+    memset(m->ddram, ' ', sizeof(m->ddram));
+    m->ac = 0;
+    m->cg = 0;
+    m->shift = 0;
+    m->entry |= 0x02;
+    exec = SLOW(HD44780_T_HOME);
+  }
+  m->busy = t + exec;
+}
+
+/**
+ * @desc    Power on of all controllers
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void hd44780_reset (void)
+{
+  int lcd;
+
+  for (lcd = 0; lcd < HD44780_LCDS; lcd++) {
+    hd44780_brownout(lcd);
+    // PCF8574 powers on with all outputs high
+    memset(&hd44780[lcd].bus, 0, sizeof(hd44780[lcd].bus));
+    hd44780[lcd].bus.pins = 0xFF;
+  }
+}
+
+/**
+ * @desc    Controller reset, expander keeps its outputs
+ *
+ * @param   int - lcd
+ *
+ * @return  void
+ */
+void hd44780_brownout (int lcd)
+{
+  HD44780_Model *m = &hd44780[lcd];
+  // pins seen by controller
+  HD44780_Bus bus = m->bus;
+
+  memset(m, 0, sizeof(*m));
+  m->bus = bus;
+  memset(m->ddram, ' ', sizeof(m->ddram));
+  // internal reset - 8 bit, 1 line, display off, increment
+  m->mode8 = 1;
+  m->function = 0x30;
+  m->entry = 0x06;
+}
+
+/**
+ * @desc    Port pins changed, driver layout
+ *
+ * @param   int - lcd
+ * @param   uint8_t - P7 .. P0 = DB7 DB6 DB5 DB4 BL E RW RS
+ * @param   uint64_t - time in ns
+ *
+ * @return  void
+ */
+void hd44780_pins (int lcd, uint8_t pins, uint64_t t)
+{
+  HD44780_Model *m = &hd44780[lcd];
+  uint8_t old = m->bus.pins;
+  uint8_t changed = old ^ pins;
+  int rise = !(old & PIN_E) && (pins & PIN_E);
+  int fall = (old & PIN_E) && !(pins & PIN_E);
+  uint8_t byte;
+
+  // E fall ends cycle
+  if (fall) {
+    if (t - m->bus.rise < HD44780_T_PWEH) {
+      hd44780_violation(m, "PWEH: E high %llu ns, need %u ns", (unsigned long long) (t - m->bus.rise), HD44780_T_PWEH);
+    }
+    // write cycle latches DB7 - DB4
+    if (!(old & PIN_RW)) {
+      if (t - m->bus.db < HD44780_T_DSW) {
+        hd44780_violation(m, "tDSW: data set %llu ns before E fall, need %u ns", (unsigned long long) (t - m->bus.db), HD44780_T_DSW);
+      }
+      // 8 bit interface, DB3 - DB0 tied low
+      if (m->mode8) {
+        hd44780_execute(m, old & PIN_DB, old & PIN_RS, t);
+      // upper nibble
+      } else if (!m->phase) {
+        m->high = old & PIN_DB;
+        m->phase = 1;
+      // lower nibble
+      } else {
+        m->phase = 0;
+        hd44780_execute(m, m->high | ((old & PIN_DB) >> 4), old & PIN_RS, t);
+      }
+    // read cycle
+    } else {
+      if (m->mode8 || m->phase) {
+        m->phase = 0;
+        // data read moves address counter
+        if (old & PIN_RS) {
+          m->ac = hd44780_next(m, m->ac, m->entry & 0x02);
+        }
+      } else {
+        m->phase = 1;
+      }
+    }
+    m->bus.fall = t;
+  }
+
+  // register select, read / write
+  if (changed & (PIN_RS | PIN_RW)) {
+    if ((old & PIN_E) && (pins & PIN_E)) {
+      hd44780_violation(m, "RS / RW changed while E high");
+    } else if (m->bus.fall && (t - m->bus.fall < HD44780_T_AH)) {
+      hd44780_violation(m, "tAH: RS / RW held %llu ns after E fall, need %u ns", (unsigned long long) (t - m->bus.fall), HD44780_T_AH);
+    }
+    m->bus.rs = t;
+  }
+
+  // data lines
+  if (changed & PIN_DB) {
+    if (m->bus.fall && !(old & PIN_RW) && !(pins & PIN_E) && (t - m->bus.fall < HD44780_T_H)) {
+      hd44780_violation(m, "tH: data held %llu ns after E fall, need %u ns", (unsigned long long) (t - m->bus.fall), HD44780_T_H);
+    }
+    m->bus.db = t;
+  }
+
+  // E rise starts cycle
+  if (rise) {
+    if (t - m->bus.rs < HD44780_T_AS) {
+      hd44780_violation(m, "tAS: RS / RW set %llu ns before E rise, need %u ns", (unsigned long long) (t - m->bus.rs), HD44780_T_AS);
+    }
+    if (m->bus.rise && (t - m->bus.rise < HD44780_T_CYCE)) {
+      hd44780_violation(m, "tcycE: E cycle %llu ns, need %u ns", (unsigned long long) (t - m->bus.rise), HD44780_T_CYCE);
+    }
+    // read cycle, value of whole byte at upper nibble
+    if ((pins & PIN_RW) && (m->mode8 || !m->phase)) {
+      if (pins & PIN_RS) {
+        if (t < m->busy) {
+          hd44780_violation(m, "busy: DDRAM read %.3f us before 0x%02X finished", (m->busy - t) / 1e3, m->last);
+        }
+        byte = m->cg ? m->cgram[m->ac] : m->ddram[m->ac];
+        m->reads++;
+      } else {
+        byte = ((t < m->busy) ? 0x80 : 0x00) | m->ac;
+      }
+      m->bus.value = byte;
+    }
+    m->bus.rise = t;
+  }
+
+  m->bus.pins = pins;
+}
+
+/**
+ * @desc    Port pins read, controller drives DB7 - DB4 in read cycle
+ *
+ * @param   int - lcd
+ * @param   uint8_t - levels of pins, driver layout
+ * @param   uint64_t - time in ns
+ *
+ * @return  uint8_t - pins
+ */
+uint8_t hd44780_read (int lcd, uint8_t latch, uint64_t t)
+{
+  HD44780_Model *m = &hd44780[lcd];
+  uint8_t nibble;
+
+  // controller outputs only with RW and E high
+  if ((latch & (PIN_RW | PIN_E)) != (PIN_RW | PIN_E)) {
+    return latch;
+  }
+  if (t - m->bus.rise < HD44780_T_DDR) {
+    hd44780_violation(m, "tDDR: data read %llu ns after E rise, need %u ns", (unsigned long long) (t - m->bus.rise), HD44780_T_DDR);
+  }
+  // upper or lower nibble
+  nibble = (m->mode8 || !m->phase) ? (m->bus.value & 0xF0) : (m->bus.value << 4);
+
+  // quasi bidirectional, controller pulls low
+  return latch & (nibble | ~PIN_DB);
+}
+
+/**
+ * @desc    Visible text of one row, display shift applied
+ *
+ * @param   int - lcd
+ * @param   int - row
+ * @param   int - columns of panel
+ * @param   char * - buffer, columns + 1 chars
+ *
+ * @return  char *
+ */
+char *hd44780_row (int lcd, int row, int cols, char *str)
+{
+  HD44780_Model *m = &hd44780[lcd];
+  int i;
+
+  for (i = 0; i < cols; i++) {
+    str[i] = m->ddram[(row ? 0x40 : 0x00) + (i + m->shift) % HD44780_LINE];
+  }
+  str[cols] = '\0';
+
+  return str;
+}
@@ -0,0 +1,158 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - HD44780 model with timing checker
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        hd44780.h
+ * @tested      gcc, Linux
+ *
+ * @depend      sim.h
+ * ---------------------------------------------------------------+
+ *              Pins are driven by expander or GPIO outputs. Every edge is
+ *              checked against HD44780U datasheet, VCC 4.5 - 5.5 V,
+ *              bus timing (table 8.1) and execution times (table 6)
+ *              scaled to slowest oscillator. Violations are reported
+ *              by sim_violation with call stack of driver.
+ */
+#ifndef __SIM_HD44780_H__
+#define __SIM_HD44780_H__
+
+#include <stdint.h>
+#include "lib/expander.h"
+
+  // @const bus timing in ns
+  #define HD44780_T_CYCE       500   // enable cycle time
+  #define HD44780_T_PWEH       230   // enable pulse width high
+  #define HD44780_T_AS         40    // RS, RW setup before E rise
+  #define HD44780_T_AH         10    // RS, RW hold after E fall
+  #define HD44780_T_DSW        80    // data setup before E fall
+  #define HD44780_T_H          10    // data hold after E fall
+  #define HD44780_T_DDR        160   // read data delay after E rise
+
+  // @const execution times in ns at fosc 270 kHz
+  #define HD44780_T_EXEC       37000
+  #define HD44780_T_ADD        4000  // address counter update after data
+  #define HD44780_T_HOME       1520000
+  // @const power on and init by instruction
+  #define HD44780_T_POWER_ON   15000000
+  #define HD44780_T_INIT1      4100000
+  #define HD44780_T_INIT2      100000
+
+  // @const slowest oscillator in kHz, times scale by 270 / fosc
+  #ifndef HD44780_FOSC_KHZ
+    #define HD44780_FOSC_KHZ   250
+  #endif
+
+  // @const DDRAM line length
+  #define HD44780_LINE         40
+
+  // @const controllers, one per lane of backend
+  #define HD44780_LCDS         EXPANDER_LANES
+
+  /** @struct pins and times of last changes */
+  typedef struct {
+    uint8_t pins;
+    uint64_t rs;
+    uint64_t db;
+    uint64_t rise;
+    uint64_t fall;
+    // byte read in progress
+    uint8_t value;
+  } HD44780_Bus;
+
+  /** @struct controller state */
+  typedef struct {
+    // DDRAM, 0x00 - 0x27 line 1, 0x40 - 0x67 line 2
+    uint8_t ddram[0x80];
+    // CGRAM
+    uint8_t cgram[0x40];
+    // address counter
+    uint8_t ac;
+    // address counter points to CGRAM
+    uint8_t cg;
+    // display shift 0 .. 39
+    uint8_t shift;
+    // entry mode, display control, function set
+    uint8_t entry;
+    uint8_t control;
+    uint8_t function;
+    // 8 bit interface
+    uint8_t mode8;
+    // lower nibble comes next
+    uint8_t phase;
+    // upper nibble of byte in progress
+    uint8_t high;
+    // 0x3 nibbles of init by instruction
+    uint8_t init;
+    // busy till
+    uint64_t busy;
+    // last instruction or data
+    uint8_t last;
+    // counters
+    unsigned long instructions;
+    unsigned long data;
+    unsigned long reads;
+    // pins
+    HD44780_Bus bus;
+  } HD44780_Model;
+
+  /** @var controllers, one per lane */
+  extern HD44780_Model hd44780[HD44780_LCDS];
+
+  /**
+   * @desc    Power on of all controllers
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void hd44780_reset (void);
+
+  /**
+   * @desc    Controller reset, expander keeps its outputs
+   *
+   * @param   int - lcd
+   *
+   * @return  void
+   */
+  void hd44780_brownout (int);
+
+  /**
+   * @desc    Port pins changed, driver layout
+   *
+   * @param   int - lcd
+   * @param   uint8_t - P7 .. P0 = DB7 DB6 DB5 DB4 BL E RW RS
+   * @param   uint64_t - time in ns
+   *
+   * @return  void
+   */
+  void hd44780_pins (int, uint8_t, uint64_t);
+
+  /**
+   * @desc    Port pins read, controller drives DB7 - DB4 in read cycle
+   *
+   * @param   int - lcd
+   * @param   uint8_t - levels of pins, driver layout
+   * @param   uint64_t - time in ns
+   *
+   * @return  uint8_t - pins
+   */
+  uint8_t hd44780_read (int, uint8_t, uint64_t);
+
+  /**
+   * @desc    Visible text of one row, display shift applied
+   *
+   * @param   int - lcd
+   * @param   int - row
+   * @param   int - columns of panel
+   * @param   char * - buffer, columns + 1 chars
+   *
+   * @return  char *
+   */
+  char *hd44780_row (int, int, int, char *);
+
+#endif
@@ -0,0 +1,1231 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - virtual time, TWI bus, I/O expanders
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        sim.c
+ * @tested      gcc, Linux
+ *
+ * @depend      sim.h
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "lib/prof.h"
+#include "lib/twi.h"
+#include "lib/expander.h"
+#include "hd44780.h"
+#if EXPANDER == EXPANDER_LINUX
+  #include <linux/i2c.h>
+  #include <linux/i2c-dev.h>
+#endif
+#include "sim.h"
+
+// plain registers
+volatile uint8_t TWAR, TWBR, TWDR, TWSR;
+volatile uint8_t TCCR0A, TCCR0B, OCR0A, TIMSK0, TCNT0, TIFR0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint8_t TCCR2A, OCR2A, TIMSK2, TCNT2, TIFR2, ASSR;
+volatile uint8_t ADMUX, MCUSR;
+volatile uint8_t UCSR0B, UCSR0C, UBRR0H, UBRR0L;
+volatile uint8_t PORTB, PORTC, DDRC, PINC;
+volatile uint16_t OCR1A, UBRR0, ADC;
+volatile uint16_t UDR0 = 0xFFFF;
+
+/** @var global interrupt flag */
+volatile uint8_t sim_sreg_i = 0;
+
+/** @var virtual time in ns since power on */
+uint64_t sim_ns = 0;
+
+/** @var number of reported violations */
+unsigned long sim_violations = 0;
+
+/** @var mocked ADC input by channel */
+uint16_t sim_adc[8];
+
+/** @var open and ioctl calls of Linux backend */
+unsigned long sim_syscalls = 0;
+
+/** @var next address bytes lost to other master */
+unsigned int sim_collisions = 0;
+
+/** @var data byte to expander lost to other master, n-th from now, 0 = none */
+unsigned int sim_data_collision = 0;
+
+/** @var called at every idle sleep, NULL = none */
+void (*sim_idle)(void) = NULL;
+
+/** @var longjmp target to leave endless main loop from sim_idle */
+jmp_buf sim_exit;
+
+/** @var hooked registers */
+static volatile uint8_t sim_reg_twcr = SIM_TWCR_DONE;
+static volatile uint16_t sim_reg_tcnt1 = 0;
+static volatile uint8_t sim_reg_tccr2b = 0;
+static volatile uint8_t sim_reg_ucsr0a = 0;
+static volatile uint8_t sim_reg_adcsra = 0;
+static volatile uint8_t sim_reg_adcl = 0;
+static volatile uint8_t sim_reg_adch = 0;
+static volatile uint8_t sim_reg_portd = 0;
+static volatile uint8_t sim_reg_ddrd = 0;
+static volatile uint8_t sim_reg_pind = 0;
+static volatile uint8_t sim_reg_ddrb = 0;
+static volatile uint8_t sim_reg_pinb = 0;
+
+// one CPU cycle per port access
+#define SIM_CYCLE_NS         (1000000000ULL / F_CPU)
+
+/** @var bus clock in kHz, 0 = from TWBR / TWSR */
+static unsigned int sim_khz = 0;
+
+/** @var bus owned between START and STOP */
+static int sim_bus_busy = 0;
+
+/** @var transfer direction after address, 'W', 'R', 'N' not acknowledged
+ *       or 'L' arbitration lost */
+static int sim_bus_mode = 0;
+
+/** @var other master holds bus till ns */
+static uint64_t sim_foreign = 0;
+
+// @const bytes of other master after won arbitration
+#define SIM_FOREIGN_BYTES    4
+
+/** @var expander output latch, PCF8574 port or MCP23008 OLAT */
+static uint8_t sim_latch = 0xFF;
+
+/** @var MCP23008 direction, configuration, register pointer */
+static uint8_t sim_iodir = 0xFF;
+static uint8_t sim_iocon = 0;
+static uint8_t sim_pointer = 0;
+
+/** @var MCP23008 first byte of write sets register pointer */
+static int sim_pointer_set = 0;
+
+/** @var GPIO wired LCD, levels of PORTD pins */
+static uint8_t sim_gpio_pins = 0xFF;
+
+/** @var PCF8574 on every software I2C lane */
+static struct {
+  // 0 idle, 'A' address, 'W' write, 'R' read, 'N' not addressed
+  int mode;
+  // clocks of byte, 9 = acknowledge clock
+  uint8_t bits;
+  uint8_t byte;
+  // slave pulls SDA low
+  uint8_t pull;
+  uint8_t latch;
+} sim_lane[EXPANDER_LANES];
+
+/** @var software I2C line levels, SCL and SDA of lanes */
+static uint8_t sim_swi2c_lines = 0xFF;
+
+/** @var next Timer0 compare match, 0 = timer not running */
+static uint64_t sim_tick = 0;
+
+/** @var next Timer2 compare match, 0 = timer not running */
+static uint64_t sim_timer2 = 0;
+
+/** @var TCCR2B at last start or stop of Timer2 */
+static uint8_t sim_tccr2b_seen = 0;
+
+// Timer0 compare vector, linked only with scheduler
+void TIMER0_COMPA_vect (void) __attribute__ ((weak));
+
+// Timer2 compare vector, linked only with idle sleep
+void TIMER2_COMPA_vect (void) __attribute__ ((weak));
+
+// TWI vector, linked only with coprocessor
+void TWI_vect (void) __attribute__ ((weak));
+
+// UART receive vector, linked only with bridge
+void USART_RX_vect (void) __attribute__ ((weak));
+
+/** @var bytes of host on UART line, ring */
+static uint8_t sim_uart_queue[SIM_UART_QUEUE];
+static int sim_uart_head = 0;
+static int sim_uart_queued = 0;
+
+/** @var stop bit of next byte on line */
+static uint64_t sim_uart_next = 0;
+
+/** @var receive buffer of UART, 2 bytes deep */
+static uint8_t sim_uart_fifo[2];
+static int sim_uart_unread = 0;
+
+/** @var byte lost after buffered byte, bit i = byte i of buffer */
+static uint8_t sim_uart_dor = 0;
+
+/** @var RX vector running, UDR0 holds received byte */
+static int sim_uart_rx = 0;
+
+/**
+ * @desc    Prescaler of timer from clock select bits
+ *
+ * @param   uint8_t - CSn2:0
+ *
+ * @return  unsigned long - 0 = stopped
+ */
+static unsigned long sim_prescaler (uint8_t cs)
+{
+  static const unsigned long prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+  return prescaler[cs & 0x07];
+}
+
+/**
+ * @desc    Prescaler of Timer2 from clock select bits
+ *
+ * @param   uint8_t - CS22:0
+ *
+ * @return  unsigned long - 0 = stopped
+ */
+static unsigned long sim_prescaler2 (uint8_t cs)
+{
+  static const unsigned long prescaler[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+
+  return prescaler[cs & 0x07];
+}
+
+/**
+ * @desc    Period of Timer2 in CTC mode
+ *
+ * @param   void
+ *
+ * @return  uint64_t - ns
+ */
+static uint64_t sim_period2 (void)
+{
+  return ((uint64_t) (OCR2A + 1) * sim_prescaler2(sim_reg_tccr2b) * 1000000000ULL) / F_CPU;
+}
+
+/**
+ * @desc    Timer2 started or stopped by TCCR2B write since last look,
+ *          counts from TCNT2 = 0
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void sim_timer2_sync (void)
+{
+  // no write
+  if (sim_reg_tccr2b == sim_tccr2b_seen) {
+    return;
+  }
+  sim_tccr2b_seen = sim_reg_tccr2b;
+  sim_timer2 = sim_prescaler2(sim_reg_tccr2b) ? sim_ns + sim_period2() : 0;
+}
+
+/**
+ * @desc    RX vector for every unread byte, interrupts on
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void sim_uart_vector (void)
+{
+  while (sim_uart_unread && sim_sreg_i && (UCSR0B & (1 << RXCIE0)) && USART_RX_vect) {
+    // char written by transmitter goes out first
+    sim_ucsr0a();
+    UDR0 = sim_uart_fifo[0];
+    // vector, interrupts off inside, reads UDR0 once
+    sim_uart_rx = 1;
+    sim_sreg_i = 0;
+    USART_RX_vect();
+    sim_sreg_i = 1;
+    sim_uart_rx = 0;
+    UDR0 = 0xFFFF;
+    sim_uart_fifo[0] = sim_uart_fifo[1];
+    sim_uart_unread--;
+    // flag goes with byte before lost one
+    sim_uart_dor >>= 1;
+  }
+}
+
+/**
+ * @desc    Time of one 8N1 byte at baud rate set by UBRR0 and U2X0, so
+ *          rounding of UBRR0 is felt by receiver
+ *
+ * @param   void
+ *
+ * @return  uint64_t - ns
+ */
+static uint64_t sim_uart_byte_ns (void)
+{
+  uint64_t ubrr = ((uint64_t) UBRR0H << 8) | UBRR0L;
+  // clocks per bit, 8 at double speed
+  uint64_t bit = ((sim_reg_ucsr0a & (1 << U2X0)) ? 8 : 16) * (ubrr + 1);
+
+  // start, 8 data, stop
+  return 10 * bit * 1000000000ULL / F_CPU;
+}
+
+/**
+ * @desc    Byte of host complete at stop bit, lost if receive buffer
+ *          is full
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void sim_uart_arrive (void)
+{
+  uint8_t byte = sim_uart_queue[sim_uart_head];
+
+  sim_uart_head = (sim_uart_head + 1) % SIM_UART_QUEUE;
+  sim_uart_queued--;
+  sim_uart_next += sim_uart_byte_ns();
+  // receiver enabled
+  if (UCSR0B & (1 << RXEN0)) {
+    if (sim_uart_unread == 2) {
+      sim_uart_dor |= 0x02;
+    } else {
+      sim_uart_fifo[sim_uart_unread++] = byte;
+    }
+  }
+  sim_uart_vector();
+}
+
+/**
+ * @desc    Move virtual time, fire Timer0 and Timer2 compare and UART
+ *          receive interrupts on the way
+ *
+ * @param   uint64_t - ns
+ *
+ * @return  void
+ */
+static void sim_advance (uint64_t ns)
+{
+  uint64_t end = sim_ns + ns;
+  unsigned long prescaler = sim_prescaler(TCCR0B);
+  uint64_t period = 0;
+
+  // Timer2 written before wait
+  sim_timer2_sync();
+  // Timer0 stopped
+  if ((prescaler == 0) || !(TIMSK0 & (1 << OCIE0A))) {
+    sim_tick = 0;
+  } else {
+    // CTC period
+    period = ((uint64_t) (OCR0A + 1) * prescaler * 1000000000ULL) / F_CPU;
+    // just started
+    if (sim_tick == 0) {
+      sim_tick = sim_ns + period;
+    }
+  }
+  // bytes received while interrupts were off
+  sim_uart_vector();
+  // compare matches and UART bytes on the way, earlier first
+  while (1) {
+    // UART byte
+    if (sim_uart_queued && (sim_uart_next <= end) && (!sim_tick || (sim_uart_next < sim_tick)) && (!sim_timer2 || (sim_uart_next < sim_timer2))) {
+      sim_ns = sim_uart_next;
+      sim_uart_arrive();
+    // Timer0
+    } else if (sim_tick && (sim_tick <= end) && (!sim_timer2 || (sim_tick <= sim_timer2))) {
+      sim_ns = sim_tick;
+      sim_tick += period;
+      // interrupt enabled
+      if (sim_sreg_i && TIMER0_COMPA_vect) {
+        sim_sreg_i = 0;
+        TIMER0_COMPA_vect();
+        sim_sreg_i = 1;
+      }
+    // Timer2, CTC restarts from 0
+    } else if (sim_timer2 && (sim_timer2 <= end)) {
+      sim_ns = sim_timer2;
+      sim_timer2 += sim_period2();
+      TIFR2 |= (1 << OCF2A);
+      // interrupt enabled, flag cleared by vector
+      if (sim_sreg_i && (TIMSK2 & (1 << OCIE2A)) && TIMER2_COMPA_vect) {
+        TIFR2 &= ~(1 << OCF2A);
+        sim_sreg_i = 0;
+        TIMER2_COMPA_vect();
+        sim_sreg_i = 1;
+      }
+    } else {
+      break;
+    }
+  }
+  sim_ns = end;
+}
+
+/**
+ * @desc    Expander or GPIO pins changed, LCD sees them in driver layout
+ *
+ * @param   int - lcd
+ * @param   uint8_t - levels of port pins
+ *
+ * @return  void
+ */
+static void sim_pins (int lcd, uint8_t pins)
+{
+  hd44780_pins(lcd, EXPANDER_UNMAP(pins), sim_ns);
+}
+
+/**
+ * @desc    Port pins read, controller drives data lines in read cycle
+ *
+ * @param   int - lcd
+ * @param   uint8_t - levels of port pins
+ *
+ * @return  uint8_t
+ */
+static uint8_t sim_pins_read (int lcd, uint8_t pins)
+{
+  // wired pins from LCD, others as they are
+  return (pins & ~EXPANDER_MASK) | EXPANDER_MAP(hd44780_read(lcd, EXPANDER_UNMAP(pins), sim_ns));
+}
+
+/**
+ * @desc    Levels of expander pins, inputs float high
+ *
+ * @param   void
+ *
+ * @return  uint8_t
+ */
+static uint8_t sim_expander (void)
+{
+#if EXPANDER == EXPANDER_MCP23008
+  return (sim_latch & ~sim_iodir) | sim_iodir;
+#else
+  return sim_latch;
+#endif
+}
+
+/**
+ * @desc    Data byte written to expander
+ *
+ * @param   uint8_t
+ *
+ * @return  void
+ */
+static void sim_expander_write (uint8_t data)
+{
+#if EXPANDER == EXPANDER_MCP23008
+  // register address
+  if (!sim_pointer_set) {
+    sim_pointer = data;
+    sim_pointer_set = 1;
+    return;
+  }
+  // register
+  if (sim_pointer == MCP23008_IODIR) {
+    sim_iodir = data;
+  } else if (sim_pointer == MCP23008_IOCON) {
+    sim_iocon = data;
+  } else if ((sim_pointer == MCP23008_GPIO) || (sim_pointer == MCP23008_OLAT)) {
+    sim_latch = data;
+  }
+  // sequential mode, 11 registers
+  if (!(sim_iocon & MCP23008_SEQOP)) {
+    sim_pointer = (sim_pointer + 1) % (MCP23008_OLAT + 1);
+  }
+#else
+  sim_latch = data;
+#endif
+  sim_pins(0, sim_expander());
+}
+
+/**
+ * @desc    Data byte read from expander
+ *
+ * @param   void
+ *
+ * @return  uint8_t
+ */
+static uint8_t sim_expander_read (void)
+{
+#if EXPANDER == EXPANDER_MCP23008
+  // registers other than port
+  if (sim_pointer == MCP23008_IODIR) {
+    return sim_iodir;
+  } else if (sim_pointer == MCP23008_IOCON) {
+    return sim_iocon;
+  } else if (sim_pointer == MCP23008_OLAT) {
+    return sim_latch;
+  } else if (sim_pointer != MCP23008_GPIO) {
+    return 0;
+  }
+#endif
+  return sim_pins_read(0, sim_expander());
+}
+
+/**
+ * @desc    GPIO wired LCD, report changed pins
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void sim_gpio (void)
+{
+#if EXPANDER == EXPANDER_GPIO
+  // inputs pulled up
+  uint8_t pins = (sim_reg_portd & sim_reg_ddrd) | ~sim_reg_ddrd;
+
+  if (pins != sim_gpio_pins) {
+    sim_gpio_pins = pins;
+    sim_pins(0, pins);
+  }
+#endif
+}
+
+/**
+ * @desc    Software I2C lanes, PCF8574 slaves follow line edges
+ *          SDA fall / rise while SCL high is START / STOP, data are
+ *          sampled at SCL rise, slaves drive SDA after SCL fall
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void sim_swi2c (void)
+{
+#if EXPANDER == EXPANDER_SWI2C
+  uint8_t old = sim_swi2c_lines;
+  uint8_t lines;
+  uint8_t scl = 1 << SWI2C_SCL;
+  int rise;
+  int fall;
+  int sda;
+  int was;
+  int lane;
+
+  // open drain, master pulls by DDR, slaves by acknowledge or data
+  lines = ~sim_reg_ddrb;
+  for (lane = 0; lane < EXPANDER_LANES; lane++) {
+    if (sim_lane[lane].pull) {
+      lines &= ~(1 << (SWI2C_SDA + lane));
+    }
+  }
+  if (lines == old) {
+    return;
+  }
+  rise = !(old & scl) && (lines & scl);
+  fall = (old & scl) && !(lines & scl);
+
+  for (lane = 0; lane < EXPANDER_LANES; lane++) {
+    sda = (lines >> (SWI2C_SDA + lane)) & 0x01;
+    was = (old >> (SWI2C_SDA + lane)) & 0x01;
+    // START or STOP, SCL kept high
+    if ((old & scl) && (lines & scl) && (sda != was)) {
+      sim_lane[lane].mode = sda ? 0 : 'A';
+      sim_lane[lane].bits = 0;
+      sim_lane[lane].byte = 0;
+      sim_lane[lane].pull = 0;
+    // master samples or slave samples
+    } else if (rise) {
+      if ((sim_lane[lane].mode == 'A') || (sim_lane[lane].mode == 'W')) {
+        if (sim_lane[lane].bits < 8) {
+          sim_lane[lane].byte = (sim_lane[lane].byte << 1) | sda;
+          sim_lane[lane].bits++;
+        }
+      } else if (sim_lane[lane].mode == 'R') {
+        if (sim_lane[lane].bits < 8) {
+          sim_lane[lane].bits++;
+        // not acknowledged by master, last byte
+        } else if (sda) {
+          sim_lane[lane].mode = 'N';
+        } else {
+          sim_lane[lane].bits = 9;
+        }
+      }
+    // slave drives SDA
+    } else if (fall) {
+      // acknowledge clock done, next byte
+      if (sim_lane[lane].bits == 9) {
+        sim_lane[lane].bits = 0;
+        sim_lane[lane].byte = 0;
+        sim_lane[lane].pull = 0;
+        // quasi bidirectional port, controller pulls data lines low
+        if (sim_lane[lane].mode == 'R') {
+          sim_lane[lane].byte = sim_pins_read(lane, sim_lane[lane].latch);
+          sim_lane[lane].pull = !(sim_lane[lane].byte & 0x80);
+        }
+      // address byte received
+      } else if ((sim_lane[lane].mode == 'A') && (sim_lane[lane].bits == 8)) {
+        if ((sim_lane[lane].byte >> 1) == EXPANDER_ADDRESS) {
+          sim_lane[lane].mode = (sim_lane[lane].byte & TWI_READ) ? 'R' : 'W';
+          sim_lane[lane].pull = 1;
+          sim_lane[lane].bits = 9;
+        } else {
+          sim_lane[lane].mode = 'N';
+        }
+      // data byte received, outputs change at acknowledge
+      } else if ((sim_lane[lane].mode == 'W') && (sim_lane[lane].bits == 8)) {
+        sim_lane[lane].latch = sim_lane[lane].byte;
+        sim_pins(lane, sim_lane[lane].latch);
+        sim_lane[lane].pull = 1;
+        sim_lane[lane].bits = 9;
+      // data bit, released for acknowledge of master
+      } else if (sim_lane[lane].mode == 'R') {
+        sim_lane[lane].pull = (sim_lane[lane].bits < 8) && !(sim_lane[lane].byte & (0x80 >> sim_lane[lane].bits));
+      }
+    }
+  }
+
+  // levels with new slave outputs
+  lines = ~sim_reg_ddrb;
+  for (lane = 0; lane < EXPANDER_LANES; lane++) {
+    if (sim_lane[lane].pull) {
+      lines &= ~(1 << (SWI2C_SDA + lane));
+    }
+  }
+  sim_swi2c_lines = lines;
+#endif
+}
+
+/**
+ * @desc    One SCL period in ns
+ *
+ * @param   void
+ *
+ * @return  uint64_t
+ */
+static uint64_t sim_bit (void)
+{
+  unsigned long divider;
+
+  // forced bus clock
+  if (sim_khz) {
+    return 1000000ULL / sim_khz;
+  }
+  // SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+  divider = 16 + 2UL * TWBR * (1UL << (2 * (TWSR & 0x03)));
+
+  return ((uint64_t) divider * 1000000000ULL) / F_CPU;
+}
+
+/**
+ * @desc    Execute TWCR write - START, STOP or byte transfer
+ *
+ * @param   uint8_t - written value
+ *
+ * @return  void
+ */
+static void sim_twi (uint8_t twcr)
+{
+  uint64_t bit = sim_bit();
+  uint8_t status = TWI_STATUS_NONE;
+  uint8_t data;
+
+  // start or repeated start
+  if (twcr & (1 << TWSTA)) {
+    status = sim_bus_busy ? TWI_REP_START_ACK : TWI_START_ACK;
+    // bus not free, START after STOP of other master
+    if (sim_ns < sim_foreign) {
+      sim_advance(sim_foreign - sim_ns);
+    }
+    sim_advance(bit);
+    sim_bus_busy = 1;
+    sim_bus_mode = 0;
+    twcr |= (1 << TWINT);
+  // stop, TWINT stays cleared
+  } else if (twcr & (1 << TWSTO)) {
+    sim_advance(bit);
+    sim_bus_busy = 0;
+    sim_bus_mode = 0;
+    twcr &= ~((1 << TWSTO) | (1 << TWINT));
+  // released after arbitration lost, not addressed slave
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 'L')) {
+    sim_bus_mode = 0;
+    twcr &= ~(1 << TWINT);
+  // other master sends lower address bit, its transaction follows
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 0) && sim_collisions) {
+    sim_collisions--;
+    sim_advance(9 * bit);
+    sim_bus_busy = 0;
+    sim_bus_mode = 'L';
+    sim_foreign = sim_ns + SIM_FOREIGN_BYTES * 9 * bit + bit;
+    status = TWI_FLAG_ARB_LOST;
+  // address byte
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 0)) {
+    data = TWDR;
+    sim_advance(9 * bit);
+    // only expander on bus
+    if ((data >> 1) == EXPANDER_ADDRESS) {
+      sim_pointer_set = 0;
+      sim_bus_mode = (data & TWI_READ) ? 'R' : 'W';
+      status = (data & TWI_READ) ? TWI_MR_SLAR_ACK : TWI_MT_SLAW_ACK;
+    } else {
+      sim_bus_mode = 'N';
+      status = (data & TWI_READ) ? TWI_MR_SLAR_NACK : TWI_MT_SLAW_NACK;
+    }
+  // other master sends lower data bit, byte not latched, its transaction follows
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 'W') && sim_data_collision && !--sim_data_collision) {
+    sim_advance(9 * bit);
+    sim_bus_busy = 0;
+    sim_bus_mode = 'L';
+    sim_foreign = sim_ns + SIM_FOREIGN_BYTES * 9 * bit + bit;
+    status = TWI_FLAG_ARB_LOST;
+  // data to expander, outputs change after acknowledge clock
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 'W')) {
+    sim_advance(8 * bit + bit / 2);
+    sim_expander_write(TWDR);
+    sim_advance(bit / 2);
+    status = TWI_MT_DATA_ACK;
+  // data from expander, PCF8574 pins quasi bidirectional
+  } else if ((twcr & (1 << TWINT)) && (sim_bus_mode == 'R')) {
+    TWDR = sim_expander_read();
+    sim_advance(9 * bit);
+    status = (twcr & (1 << TWEA)) ? TWI_MR_DATA_ACK : TWI_MR_DATA_NACK;
+  // nobody listens
+  } else if (twcr & (1 << TWINT)) {
+    sim_advance(9 * bit);
+    status = TWI_MT_DATA_NACK;
+  }
+  // status, prescaler kept
+  TWSR = status | (TWSR & 0x03);
+  // processed
+  sim_reg_twcr = twcr | SIM_TWCR_DONE;
+}
+
+/**
+ * @desc    Stand-in of open() for Linux backend, fake adapter
+ *
+ * @param   const char * - device path
+ * @param   int - flags
+ *
+ * @return  int - SIM_I2C_FD
+ */
+int sim_open (const char *path, int flags, ...)
+{
+  (void) path;
+  (void) flags;
+  sim_syscalls++;
+
+  return SIM_I2C_FD;
+}
+
+/**
+ * @desc    Stand-in of ioctl() for Linux backend, I2C_RDWR messages
+ *          go through expander model in bus time, STOP at end
+ *
+ * @param   int - fd
+ * @param   unsigned long - request
+ * @param   struct i2c_rdwr_ioctl_data *
+ *
+ * @return  int - number of messages, -1 on error
+ */
+int sim_ioctl (int fd, unsigned long request, ...)
+{
+#if EXPANDER == EXPANDER_LINUX
+  struct i2c_rdwr_ioctl_data *data;
+  struct i2c_msg *msg;
+  uint64_t bit = sim_bit();
+  va_list args;
+  unsigned int i;
+  unsigned int j;
+
+  va_start(args, request);
+  data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+  va_end(args);
+  sim_syscalls++;
+
+  // fake adapter only
+  if ((fd != SIM_I2C_FD) || (request != I2C_RDWR)) {
+    errno = (fd != SIM_I2C_FD) ? EBADF : ENOTTY;
+    return -1;
+  }
+  for (i = 0; i < data->nmsgs; i++) {
+    msg = &data->msgs[i];
+    // (repeated) start, address
+    sim_advance(bit + 9 * bit);
+    // only expander on bus
+    if (msg->addr != EXPANDER_ADDRESS) {
+      sim_advance(bit);
+      errno = ENXIO;
+      return -1;
+    }
+    sim_pointer_set = 0;
+    for (j = 0; j < msg->len; j++) {
+      // PCF8574 pins quasi bidirectional
+      if (msg->flags & I2C_M_RD) {
+        msg->buf[j] = sim_expander_read();
+        sim_advance(9 * bit);
+      // outputs change after acknowledge clock
+      } else {
+        sim_advance(8 * bit + bit / 2);
+        sim_expander_write(msg->buf[j]);
+        sim_advance(bit / 2);
+      }
+    }
+  }
+  // stop
+  sim_advance(bit);
+
+  return data->nmsgs;
+#else
+  (void) fd;
+  (void) request;
+  errno = ENOTTY;
+
+  return -1;
+#endif
+}
+
+/**
+ * @desc    Bus event of other master for own slave address, TWI vector
+ *          runs at once, its TWCR write does not start a transfer
+ *
+ * @param   uint8_t - status
+ * @param   uint64_t - bus time of event in ns
+ *
+ * @return  int - 1 acknowledged by TWEA
+ */
+static int sim_slave_event (uint8_t status, uint64_t ns)
+{
+  sim_advance(ns);
+  TWSR = status | (TWSR & 0x03);
+  sim_reg_twcr |= (1 << TWINT) | SIM_TWCR_DONE;
+  // vector, interrupts off inside
+  sim_sreg_i = 0;
+  TWI_vect();
+  sim_sreg_i = 1;
+  sim_reg_twcr |= SIM_TWCR_DONE;
+
+  return (sim_reg_twcr & (1 << TWEA)) ? 1 : 0;
+}
+
+/**
+ * @desc    Slave listens at address with TWI interrupt
+ *
+ * @param   uint8_t - 7 bit address
+ *
+ * @return  int
+ */
+static int sim_slave_listens (uint8_t addr)
+{
+  return TWI_vect && sim_sreg_i && (sim_reg_twcr & (1 << TWIE)) && (sim_reg_twcr & (1 << TWEA)) && ((TWAR >> 1) == addr);
+}
+
+/**
+ * @desc    Other master writes to slave of MCU, START .. STOP at 100 kHz
+ *
+ * @param   uint8_t - 7 bit address
+ * @param   const uint8_t * - bytes, register first
+ * @param   int - number of bytes
+ *
+ * @return  int - 0 acknowledged, -1 not
+ */
+int sim_slave_write (uint8_t addr, const uint8_t *data, int n)
+{
+  int i;
+
+  if (!sim_slave_listens(addr)) {
+    return -1;
+  }
+  // START, SLA+W
+  sim_slave_event(TWI_SR_SLAW_ACK, SIM_SLAVE_BIT_NS + 9 * SIM_SLAVE_BIT_NS);
+  for (i = 0; i < n; i++) {
+    TWDR = data[i];
+    sim_slave_event(TWI_SR_OA_DATA_ACK, 9 * SIM_SLAVE_BIT_NS);
+  }
+  // STOP
+  sim_slave_event(TWI_SR_STOP_RSTART, SIM_SLAVE_BIT_NS);
+
+  return 0;
+}
+
+/**
+ * @desc    Other master reads slave of MCU - register write, repeated
+ *          START, bytes with ACK but last, STOP at 100 kHz
+ *
+ * @param   uint8_t - 7 bit address
+ * @param   uint8_t - register
+ * @param   uint8_t * - bytes
+ * @param   int - number of bytes
+ *
+ * @return  int - 0 acknowledged, -1 not
+ */
+int sim_slave_read (uint8_t addr, uint8_t reg, uint8_t *data, int n)
+{
+  int i;
+
+  if (!sim_slave_listens(addr)) {
+    return -1;
+  }
+  // START, SLA+W, register
+  sim_slave_event(TWI_SR_SLAW_ACK, SIM_SLAVE_BIT_NS + 9 * SIM_SLAVE_BIT_NS);
+  TWDR = reg;
+  sim_slave_event(TWI_SR_OA_DATA_ACK, 9 * SIM_SLAVE_BIT_NS);
+  // repeated START, SLA+R, slave loads first byte
+  sim_slave_event(TWI_SR_STOP_RSTART, SIM_SLAVE_BIT_NS);
+  sim_slave_event(TWI_ST_OA_ACK, 9 * SIM_SLAVE_BIT_NS);
+  for (i = 0; i < n; i++) {
+    data[i] = TWDR;
+    // master NACK after last byte
+    sim_slave_event((i + 1 < n) ? TWI_ST_DATA_ACK : TWI_ST_DATA_NACK, 9 * SIM_SLAVE_BIT_NS);
+  }
+  // STOP, slave not addressed any more
+  sim_advance(SIM_SLAVE_BIT_NS);
+
+  return 0;
+}
+
+/**
+ * @desc    Host sends bytes to UART of MCU, 8N1 at baud rate set by
+ *          UBRR0 and U2X0, after bytes sent before
+ *
+ * @param   const uint8_t * - bytes
+ * @param   int - number of bytes
+ *
+ * @return  int - 0 queued, -1 queue full
+ */
+int sim_uart_write (const uint8_t *data, int n)
+{
+  int i;
+
+  if (sim_uart_queued + n > SIM_UART_QUEUE) {
+    return -1;
+  }
+  // line idle, first byte complete one byte time from now
+  if (!sim_uart_queued) {
+    sim_uart_next = sim_ns + sim_uart_byte_ns();
+  }
+  for (i = 0; i < n; i++) {
+    sim_uart_queue[(sim_uart_head + sim_uart_queued++) % SIM_UART_QUEUE] = data[i];
+  }
+
+  return 0;
+}
+
+/**
+ * @desc    TWCR hook - previous write is executed before next access
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_twcr (void)
+{
+  // new value written by driver
+  if (!(sim_reg_twcr & SIM_TWCR_DONE)) {
+    sim_twi(sim_reg_twcr);
+  }
+  return &sim_reg_twcr;
+}
+
+/**
+ * @desc    TCNT1 hook - free running from virtual time
+ *
+ * @param   void
+ *
+ * @return  volatile uint16_t *
+ */
+volatile uint16_t *sim_tcnt1 (void)
+{
+  unsigned long prescaler = sim_prescaler(TCCR1B);
+
+  // running
+  if (prescaler) {
+    sim_reg_tcnt1 = (uint16_t) ((sim_ns * (F_CPU / 1000000ULL)) / 1000ULL / prescaler);
+  }
+  return &sim_reg_tcnt1;
+}
+
+/**
+ * @desc    TCCR2B hook - write starts or stops Timer2, seen at next
+ *          access or wait
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_tccr2b (void)
+{
+  // previous write
+  sim_timer2_sync();
+  return &sim_reg_tccr2b;
+}
+
+/**
+ * @desc    UCSR0A hook - transmitted char goes to stdout, never busy
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_ucsr0a (void)
+{
+  // char written, UDR0 of RX vector is received byte
+  if (!sim_uart_rx && (UDR0 != 0xFFFF)) {
+    putchar(UDR0 & 0xFF);
+    UDR0 = 0xFFFF;
+  }
+  // double speed kept as written, transmitter empty, received bytes
+  sim_reg_ucsr0a = (sim_reg_ucsr0a & (1 << U2X0)) | (1 << UDRE0) | (1 << TXC0) | (sim_uart_unread ? (1 << RXC0) : 0) | ((sim_uart_dor & 0x01) ? (1 << DOR0) : 0);
+
+  return &sim_reg_ucsr0a;
+}
+
+/**
+ * @desc    ADCSRA hook - conversion completes at once
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_adcsra (void)
+{
+  // conversion started
+  if (sim_reg_adcsra & (1 << ADSC)) {
+    sim_reg_adcsra &= ~(1 << ADSC);
+    sim_reg_adcsra |= (1 << ADIF);
+  }
+  return &sim_reg_adcsra;
+}
+
+/**
+ * @desc    ADCL hook - mocked input of selected channel
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_adcl (void)
+{
+  sim_reg_adcl = sim_adc[ADMUX & 0x07] & 0xFF;
+
+  return &sim_reg_adcl;
+}
+
+/**
+ * @desc    ADCH hook - mocked input of selected channel
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_adch (void)
+{
+  sim_reg_adch = (sim_adc[ADMUX & 0x07] >> 8) & 0x03;
+
+  return &sim_reg_adch;
+}
+
+/**
+ * @desc    PORTD hook - previous write reaches pins, one cycle per access
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_portd (void)
+{
+  sim_gpio();
+  sim_advance(SIM_CYCLE_NS);
+
+  return &sim_reg_portd;
+}
+
+/**
+ * @desc    DDRD hook - previous write reaches pins, one cycle per access
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_ddrd (void)
+{
+  sim_gpio();
+  sim_advance(SIM_CYCLE_NS);
+
+  return &sim_reg_ddrd;
+}
+
+/**
+ * @desc    PIND hook - levels of pins, LCD drives data lines in read cycle
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_pind (void)
+{
+  sim_gpio();
+  sim_advance(SIM_CYCLE_NS);
+  sim_reg_pind = sim_pins_read(0, sim_gpio_pins);
+
+  return &sim_reg_pind;
+}
+
+/**
+ * @desc    DDRB hook - previous write reaches lanes, one cycle per access
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_ddrb (void)
+{
+  sim_swi2c();
+  sim_advance(SIM_CYCLE_NS);
+
+  return &sim_reg_ddrb;
+}
+
+/**
+ * @desc    PINB hook - levels of lines, slaves drive SDA
+ *
+ * @param   void
+ *
+ * @return  volatile uint8_t *
+ */
+volatile uint8_t *sim_pinb (void)
+{
+  sim_swi2c();
+  sim_advance(SIM_CYCLE_NS);
+  sim_reg_pinb = sim_swi2c_lines;
+
+  return &sim_reg_pinb;
+}
+
+/**
+ * @desc    Finish pending TWI, UART, GPIO and software I2C register writes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void sim_flush (void)
+{
+  sim_twcr();
+  sim_ucsr0a();
+  sim_gpio();
+  sim_swi2c();
+}
+
+/**
+ * @desc    Busy wait
+ *
+ * @param   double - ns
+ *
+ * @return  void
+ */
+void sim_delay_ns (double ns)
+{
+  // STOP written just before wait
+  sim_flush();
+  sim_advance((uint64_t) (ns + 0.5));
+}
+
+/**
+ * @desc    Idle sleep till next Timer0 tick
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void sim_sleep (void)
+{
+  sim_flush();
+  // test hook, no transfer in progress
+  if (sim_idle) {
+    sim_idle();
+  }
+  // Timer2 written before sleep
+  sim_timer2_sync();
+  // woken by Timer2 compare
+  if (sim_timer2 && (TIMSK2 & (1 << OCIE2A)) && (!sim_tick || (sim_timer2 < sim_tick))) {
+    sim_advance(sim_timer2 - sim_ns);
+  // by tick, or 1 ms if timer stopped
+  } else {
+    sim_advance(sim_tick > sim_ns ? sim_tick - sim_ns : 1000000ULL);
+  }
+}
+
+/**
+ * @desc    Report violation with call stack from PROF_ENTER
+ *
+ * @param   const char * - printf format
+ *
+ * @return  void
+ */
+void sim_violation (const char *format, ...)
+{
+  va_list args;
+#if PROF
+  char name[PROF_NAME];
+  unsigned char i;
+#endif
+
+  sim_violations++;
+  printf("%12.3f us  ", sim_ns / 1000.0);
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+#if PROF
+  // outermost call first
+  printf("                at ");
+  for (i = 0; (i < _prof_depth) && (i < PROF_DEPTH); i++) {
+    printf("%s%s", i ? " > " : "", PROF_Name(_prof_stack[i], name));
+  }
+  printf("\n");
+#endif
+}
+
+/**
+ * @desc    Reset simulator - power on at time 0
+ *
+ * @param   unsigned int - bus clock in kHz, 0 = from TWBR / TWSR
+ *
+ * @return  void
+ */
+void sim_reset (unsigned int khz)
+{
+  int i;
+
+  sim_ns = 0;
+  sim_tick = 0;
+  sim_timer2 = 0;
+  sim_tccr2b_seen = sim_reg_tccr2b = 0;
+  sim_violations = 0;
+  sim_syscalls = 0;
+  sim_khz = khz;
+  sim_sreg_i = 0;
+  sim_bus_busy = 0;
+  sim_bus_mode = 0;
+  sim_collisions = 0;
+  sim_data_collision = 0;
+  sim_foreign = 0;
+  sim_reg_twcr = SIM_TWCR_DONE;
+  sim_latch = 0xFF;
+  sim_iodir = 0xFF;
+  sim_iocon = 0;
+  sim_pointer = 0;
+  sim_pointer_set = 0;
+  sim_reg_portd = sim_reg_ddrd = 0;
+  sim_gpio_pins = 0xFF;
+  sim_reg_ddrb = 0;
+  sim_swi2c_lines = 0xFF;
+  memset(sim_lane, 0, sizeof(sim_lane));
+  for (i = 0; i < EXPANDER_LANES; i++) {
+    sim_lane[i].latch = 0xFF;
+  }
+  // power on reset of registers used by lib
+  TWBR = TWSR = 0;
+  TCCR0B = TIMSK0 = TCCR1B = TIMSK2 = 0;
+  ADMUX = MCUSR = 0;
+  sim_reg_adcsra = 0;
+  sim_idle = NULL;
+  UDR0 = 0xFFFF;
+  UCSR0B = 0;
+  sim_uart_head = sim_uart_queued = 0;
+  sim_uart_unread = 0;
+  sim_uart_dor = 0;
+  hd44780_reset();
+}
@@ -0,0 +1,163 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - virtual time, TWI bus, I/O expanders
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        sim.h
+ * @tested      gcc, Linux
+ *
+ * @depend      sim/avr, sim/util shims, hd44780.h
+ * ---------------------------------------------------------------+
+ *              Driver sources are compiled for host against shims in
+ *              sim/avr and sim/util. Code runs in zero time, only busy
+ *              waits and TWI transfers move virtual time - the fastest
+ *              possible MCU, worst case for minimal timings.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdint.h>
+#include <setjmp.h>
+
+  // @const TWCR bit 1 is reserved, simulator marks processed value
+  #define SIM_TWCR_DONE        0x02
+
+  // @const SCL period of other master addressing MCU, 100 kHz
+  #define SIM_SLAVE_BIT_NS     10000
+
+  // @const bytes of host not received yet
+  #define SIM_UART_QUEUE       2048
+
+  // @const file descriptor of fake I2C adapter
+  #define SIM_I2C_FD           0x12C
+
+  /** @var virtual time in ns since power on */
+  extern uint64_t sim_ns;
+
+  /** @var number of reported violations */
+  extern unsigned long sim_violations;
+
+  /** @var mocked ADC input by channel */
+  extern uint16_t sim_adc[8];
+
+  /** @var open and ioctl calls of Linux backend */
+  extern unsigned long sim_syscalls;
+
+  /** @var next address bytes lost to other master */
+  extern unsigned int sim_collisions;
+
+  /** @var data byte to expander lost to other master, n-th from now, 0 = none */
+  extern unsigned int sim_data_collision;
+
+  /** @var called at every idle sleep, NULL = none */
+  extern void (*sim_idle)(void);
+
+  /** @var longjmp target to leave endless main loop from sim_idle */
+  extern jmp_buf sim_exit;
+
+  /**
+   * @desc    Reset simulator - power on at time 0
+   *
+   * @param   unsigned int - bus clock in kHz, 0 = from TWBR / TWSR
+   *
+   * @return  void
+   */
+  void sim_reset (unsigned int);
+
+  /**
+   * @desc    Busy wait
+   *
+   * @param   double - ns
+   *
+   * @return  void
+   */
+  void sim_delay_ns (double);
+
+  /**
+   * @desc    Idle sleep till next Timer0 tick
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void sim_sleep (void);
+
+  /**
+   * @desc    Finish pending TWI, UART, GPIO and software I2C register writes
+   *
+   * @param   void
+   *
+   * @return  void
+   */
+  void sim_flush (void);
+
+  /**
+   * @desc    Stand-in of open() for Linux backend, fake adapter
+   *
+   * @param   const char * - device path
+   * @param   int - flags
+   *
+   * @return  int - SIM_I2C_FD
+   */
+  int sim_open (const char *, int, ...);
+
+  /**
+   * @desc    Stand-in of ioctl() for Linux backend, I2C_RDWR messages
+   *
+   * @param   int - fd
+   * @param   unsigned long - request
+   * @param   struct i2c_rdwr_ioctl_data *
+   *
+   * @return  int - number of messages, -1 on error
+   */
+  int sim_ioctl (int, unsigned long, ...);
+
+  /**
+   * @desc    Other master writes to slave of MCU, START .. STOP at 100 kHz
+   *
+   * @param   uint8_t - 7 bit address
+   * @param   const uint8_t * - bytes, register first
+   * @param   int - number of bytes
+   *
+   * @return  int - 0 acknowledged, -1 not
+   */
+  int sim_slave_write (uint8_t, const uint8_t *, int);
+
+  /**
+   * @desc    Other master reads slave of MCU - register write, repeated
+   *          START, bytes with ACK but last, STOP at 100 kHz
+   *
+   * @param   uint8_t - 7 bit address
+   * @param   uint8_t - register
+   * @param   uint8_t * - bytes
+   * @param   int - number of bytes
+   *
+   * @return  int - 0 acknowledged, -1 not
+   */
+  int sim_slave_read (uint8_t, uint8_t, uint8_t *, int);
+
+  /**
+   * @desc    Host sends bytes to UART of MCU, 8N1 at baud rate set by
+   *          UBRR0 and U2X0, after bytes sent before
+   *
+   * @param   const uint8_t * - bytes
+   * @param   int - number of bytes
+   *
+   * @return  int - 0 queued, -1 queue full
+   */
+  int sim_uart_write (const uint8_t *, int);
+
+  /**
+   * @desc    Report violation with call stack from PROF_ENTER
+   *
+   * @param   const char * - printf format
+   *
+   * @return  void
+   */
+  void sim_violation (const char *, ...);
+
+#endif
@@ -0,0 +1,360 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host simulator - driver timing check at bus clocks
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       16.12.2020
+ * @file        timing.c
+ * @tested      gcc, Linux
+ *
+ * @usage       timing [khz ...], default 100 400
+ *
+ *              Runs every public call of driver against HD44780 model.
+ *              Exit status 1 if any datasheet timing is violated.
+ *              Longest calls compare backends, make bench.
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/interrupt.h>
+#include "lib/hd44780pcf8574.h"
+#include "lib/twi.h"
+#include "lib/prof.h"
+#include "lib/idle.h"
+#include "lib/scheduler.h"
+#include "lib/screens.h"
+#include "hd44780.h"
+#include "sim.h"
+
+// @const backend on TWI, other master can share bus
+#define TIMING_TWI           ((EXPANDER == EXPANDER_PCF8574) || (EXPANDER == EXPANDER_PCF8574A) || (EXPANDER == EXPANDER_MCP23008))
+
+/** @var syscalls of DrawString of 15 chars, Linux backend */
+static unsigned long _timing_syscalls;
+
+/**
+ * @desc    Compare visible row of one lcd with expected text
+ *
+ * @param   int - lcd
+ * @param   int - row
+ * @param   const char * - expected
+ *
+ * @return  void
+ */
+static void expect_lcd (int lcd, int row, const char *text)
+{
+  char str[HD44780_COLS + 1];
+
+  hd44780_row(lcd, row, HD44780_COLS, str);
+  if (strcmp(str, text)) {
+    sim_violation("lcd %d row %d: \"%s\", expected \"%s\"", lcd, row, str, text);
+  }
+}
+
+/**
+ * @desc    Compare visible row of every lcd with expected text
+ *
+ * @param   int - row
+ * @param   const char * - expected
+ *
+ * @return  void
+ */
+static void expect (int row, const char *text)
+{
+  int lcd;
+
+  // lanes run the same instructions
+  for (lcd = 0; lcd < HD44780_LCDS; lcd++) {
+    expect_lcd(lcd, row, text);
+  }
+}
+
+/**
+ * @desc    Drive every public call once
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario (void)
+{
+  char addr = PCF8574_ADDRESS;
+  char text[EXPANDER_LANES][HD44780_COLS + 1];
+  char *lanes[EXPANDER_LANES];
+  int lcd;
+
+  PROF_Init();
+#if IDLE_SLEEP
+  // waits sleep only with interrupts enabled
+  IDLE_Init();
+  sei();
+#endif
+
+  // cold init, display on
+  HD44780_PCF8574_Init(addr);
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_DisplayClear(addr);
+  expect(0, "                ");
+
+  // text
+  HD44780_PCF8574_PositionXY(addr, 0, 0);
+  _timing_syscalls = sim_syscalls;
+  HD44780_PCF8574_DrawString(addr, "HD44780 PCF8574");
+  _timing_syscalls = sim_syscalls - _timing_syscalls;
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawChar(addr, '>');
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW2_START + 1, "timing");
+  expect(0, "HD44780 PCF8574 ");
+  expect(1, ">timing         ");
+
+  // cursor, shift
+  HD44780_PCF8574_CursorOn(addr);
+  HD44780_PCF8574_CursorBlink(addr);
+  HD44780_PCF8574_Shift(addr, HD44780_DISPLAY, HD44780_LEFT);
+  HD44780_PCF8574_SendInstructions(addr, HD44780_SHIFT | HD44780_DISPLAY | HD44780_RIGHT, 1);
+  HD44780_PCF8574_DisplayOn(addr);
+  expect(0, "HD44780 PCF8574 ");
+
+  // own string on every lane, shorter ones padded
+  for (lcd = 0; lcd < EXPANDER_LANES; lcd++) {
+    snprintf(text[lcd], sizeof(text[lcd]), "lane %d%s", lcd, lcd ? "" : " longest");
+    lanes[lcd] = text[lcd];
+  }
+  HD44780_PCF8574_PositionXY(addr, 0, 1);
+  HD44780_PCF8574_DrawStrings(addr, lanes);
+  for (lcd = 0; lcd < EXPANDER_LANES; lcd++) {
+    snprintf(text[lcd], sizeof(text[lcd]), "lane %d%-*s", lcd, HD44780_COLS - 6, lcd ? "" : " longest");
+    expect_lcd(lcd, 1, text[lcd]);
+  }
+
+  // read back
+  HD44780_PCF8574_CheckBF(addr);
+  HD44780_PCF8574_SendInstruction(addr, HD44780_POSITION | HD44780_ROW1_START);
+  if (HD44780_PCF8574_ReadData(addr) != 'H') {
+    sim_violation("ReadData: DDRAM 0x00 is not 'H'");
+  }
+  if ((unsigned char) HD44780_PCF8574_ReadStatus(addr) != 0x01) {
+    sim_violation("ReadStatus: address counter is not 0x01");
+  }
+  while (HD44780_PCF8574_Scrub(addr) == PCF8574_PENDING);
+
+  // pre-encoded screen
+  HD44780_PCF8574_DisplayClear(addr);
+  HD44780_PCF8574_DrawScreen(addr, HD44780_SCREEN_VOLTMETER);
+
+  // recover after controller reset, warm init
+  HD44780_PCF8574_Recover(addr);
+  HD44780_PCF8574_InitWarm(addr);
+}
+
+#if TIMING_TWI
+/**
+ * @desc    Other master wins address of 3 transactions, after bench
+ *          figures - repeated transactions stretch longest calls, then
+ *          a data byte - transaction cut, glass recovered
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void scenario_contention (void)
+{
+  char addr = PCF8574_ADDRESS;
+
+  HD44780_PCF8574_DisplayClear(addr);
+  sim_collisions = 3;
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START, "multi master");
+  sim_flush();
+  expect(0, "multi master    ");
+  // repeated after backoff, none given up
+  if ((_twi_contention.retries != 3) || _twi_contention.aborted) {
+    sim_violation("arbitration: %u retries, %u aborted, expected 3, 0", _twi_contention.retries, _twi_contention.aborted);
+  }
+  // other master wins a data byte in the middle of a nibble
+  sim_data_collision = 13;
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW2_START, "data byte lost");
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START + 13, "end");
+  sim_flush();
+  if (sim_data_collision || !_twi_contention.aborted) {
+    sim_violation("arbitration: data byte not lost");
+  }
+  // recovered at end of cut transaction, text on glass
+  expect(0, "multi master end");
+  expect(1, "data byte lost  ");
+}
+#endif
+
+/**
+ * @desc    Alarm queued while bulk redraw is pumped - drawn at next cell,
+ *          redraw goes on after it, address counter of writer restored
+ *
+ * @param   void
+ *
+ * @return  unsigned int - us from queue of alarm to alarm on glass
+ */
+static unsigned int scenario_queue (void)
+{
+  char addr = PCF8574_ADDRESS;
+  uint64_t queued;
+  unsigned int latency;
+  int lcd;
+
+  HD44780_PCF8574_DisplayClear(addr);
+  // menu redraw, 26 cells
+  HD44780_PCF8574_Queue(HD44780_LANE_BULK, HD44780_ROW1_START, "MENU  settings 1");
+  HD44780_PCF8574_Queue(HD44780_LANE_BULK, HD44780_ROW2_START, "> contrast");
+  HD44780_PCF8574_Pump(addr, 4);
+  // over voltage in the middle of redraw
+  queued = sim_ns;
+  HD44780_PCF8574_Queue(HD44780_LANE_ALARM, HD44780_ROW2_START + 12, "OVER");
+  HD44780_PCF8574_Pump(addr, 4);
+  sim_flush();
+  latency = (unsigned int) ((sim_ns - queued) / 1000);
+  expect(0, "MENU            ");
+  expect(1, "            OVER");
+  // rest of redraw
+  while (HD44780_PCF8574_Pump(addr, 1) == PCF8574_PENDING);
+  sim_flush();
+  expect(0, "MENU  settings 1");
+  expect(1, "> contrast  OVER");
+
+  // alarm over idle writer, address counter back at its cell
+  HD44780_PCF8574_PositionXY(addr, 5, 1);
+  HD44780_PCF8574_Queue(HD44780_LANE_ALARM, HD44780_ROW2_START + 12, "  OK");
+  HD44780_PCF8574_Pump(addr, HD44780_COLS);
+  sim_flush();
+  expect(1, "> contrast    OK");
+  for (lcd = 0; lcd < HD44780_LCDS; lcd++) {
+    if (hd44780[lcd].ac != HD44780_ROW2_START + 5) {
+      sim_violation("lcd %d: address counter 0x%02x after alarm, expected 0x45", lcd, hd44780[lcd].ac);
+    }
+  }
+
+  // address between lines, refused and nothing queued
+  if (HD44780_PCF8574_Queue(HD44780_LANE_ALARM, HD44780_LINE_LENGTH, "GAP") != PCF8574_ERROR) {
+    sim_violation("queue at 0x%02x accepted", HD44780_LINE_LENGTH);
+  }
+  if (HD44780_PCF8574_Pump(addr, HD44780_COLS) != PCF8574_SUCCESS) {
+    sim_violation("queue not empty after refused write");
+  }
+
+  return latency;
+}
+
+/**
+ * @desc    Resumable init - blocking without tick, power on wait with
+ *          tick counted from first call, not from boot
+ *
+ * @param   void
+ *
+ * @return  unsigned int - ms from first call to init done
+ */
+static unsigned int scenario_init_async (void)
+{
+  char addr = PCF8574_ADDRESS;
+  uint64_t start;
+  unsigned int ms;
+
+  // no tick, done in one call instead of waiting forever
+  if (HD44780_PCF8574_InitAsync(addr) == PCF8574_PENDING) {
+    sim_violation("InitAsync pending without scheduler tick");
+    while (HD44780_PCF8574_InitAsync(addr) == PCF8574_PENDING);
+  }
+  // tick running for a while, power on wait still in full
+  SCHED_Init();
+  sim_delay_ns(50e6);
+  start = sim_ns;
+  while (HD44780_PCF8574_InitAsync(addr) == PCF8574_PENDING) {
+    sim_delay_ns(100e3);
+  }
+  ms = (unsigned int) ((sim_ns - start) / 1000000);
+  if (ms < HD44780_POWER_ON_MS) {
+    sim_violation("InitAsync done %u ms after first call, power on wait %u ms", ms, HD44780_POWER_ON_MS);
+  }
+  HD44780_PCF8574_DisplayOn(addr);
+  HD44780_PCF8574_UpdateString(addr, HD44780_ROW1_START, "init async");
+  sim_flush();
+  expect(0, "init async      ");
+  // tick off again
+  TIMSK0 = 0;
+  TCCR0B = 0;
+
+  return ms;
+}
+
+/**
+ * @desc    Longest call of site in us
+ *
+ * @param   unsigned char - site
+ *
+ * @return  unsigned int
+ */
+static unsigned int longest (unsigned char site)
+{
+  return _prof_sites[site].max / PROF_TICKS_PER_US;
+}
+
+/**
+ * @desc    Main function
+ *
+ * @param   int
+ * @param   char **
+ *
+ * @return  int
+ */
+int main (int argc, char **argv)
+{
+  static const char *clocks[] = { "100", "400" };
+  const char **khz = clocks;
+  int n = 2;
+  unsigned long total = 0;
+  unsigned int latency;
+  int i;
+
+  // bus clocks from command line
+  if (argc > 1) {
+    khz = (const char **) argv + 1;
+    n = argc - 1;
+  }
+  for (i = 0; i < n; i++) {
+    printf("-- %s kHz\n", khz[i]);
+    sim_reset(atoi(khz[i]));
+    scenario();
+    sim_flush();
+    printf("   %.3f ms, %lu instructions, %lu data, %lu reads, %lu violations\n",
+      sim_ns / 1e6, hd44780[0].instructions, hd44780[0].data, hd44780[0].reads, sim_violations);
+    // cost of backend per call
+    printf("   DrawChar %u us, PositionXY %u us, ReadStatus %u us, Init %u us\n",
+      longest(PROF_LCD_DRAW_CHAR), longest(PROF_LCD_POSITION_XY), longest(PROF_LCD_READ_STATUS), longest(PROF_LCD_INIT));
+    // all lanes at once
+    printf("   DrawStrings %u us, %d lanes\n", longest(PROF_LCD_DRAW_STRINGS), HD44780_LCDS);
+#if IDLE_SLEEP
+    // awake part of display updates, rest slept in waits
+    printf("   active DrawChar %u%%, DrawString %u%%, UpdateString %u%%, Init %u%%\n",
+      PROF_Active(PROF_LCD_DRAW_CHAR), PROF_Active(PROF_LCD_DRAW_STRING), PROF_Active(PROF_LCD_UPDATE_STRING), PROF_Active(PROF_LCD_INIT));
+#endif
+#if TIMING_TWI
+    // contention cost
+    memset(&_twi_contention, 0, sizeof(_twi_contention));
+    scenario_contention();
+    printf("   arbitration lost %u, backoff %lu us, %lu violations\n", _twi_contention.lost, _twi_contention.slots * TWI_BACKOFF_US, sim_violations);
+#endif
+    // alarm preempts redraw
+    latency = scenario_queue();
+    printf("   alarm %u us during redraw, %lu violations\n", latency, sim_violations);
+    // power on wait of resumable init
+    latency = scenario_init_async();
+    printf("   InitAsync %u ms from first call, %lu violations\n", latency, sim_violations);
+#if EXPANDER == EXPANDER_LINUX
+    // write-combined frames
+    printf("   %lu syscalls, DrawString of 15 chars %lu\n", sim_syscalls, _timing_syscalls);
+#endif
+    total += sim_violations;
+  }
+
+  return total ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - atomic block, ISR never preempts host code
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_UTIL_ATOMIC_H__
+#define __SIM_UTIL_ATOMIC_H__
+
+#define ATOMIC_RESTORESTATE  0
+#define ATOMIC_BLOCK(TYPE)   for (int _sim_atomic = 1; _sim_atomic; _sim_atomic = 0)
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - CRC updates of avr-libc
+ * ---------------------------------------------------------------+
+ */
+#ifndef __SIM_UTIL_CRC16_H__
+#define __SIM_UTIL_CRC16_H__
+
+#include <stdint.h>
+
+/**
+ * @desc    CRC-8 CCITT, polynomial x^8 + x^2 + x + 1, the same result
+ *          as avr-libc
+ *
+ * @param   uint8_t - crc
+ * @param   uint8_t - data
+ *
+ * @return  uint8_t
+ */
+static inline uint8_t _crc8_ccitt_update (uint8_t crc, uint8_t data)
+{
+  uint8_t i;
+
+  crc ^= data;
+  for (i = 0; i < 8; i++) {
+    crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+  }
+  return crc;
+}
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host shim - busy waits advance virtual time
+ * ---------------------------------------------------------------+
+ *              Linux backend waits through its transport as on target,
+ *              transport sleeps by sim_delay_ns (I2CDEV_SLEEP).
+ */
+#ifndef __SIM_UTIL_DELAY_H__
+#define __SIM_UTIL_DELAY_H__
+
+#include "lib/expander.h"
+
+void sim_delay_ns (double);
+
+#if EXPANDER == EXPANDER_LINUX
+void I2CDEV_Delay (double);
+
+#define _delay_us(US)        I2CDEV_Delay((US) * 1000.0)
+#define _delay_ms(MS)        I2CDEV_Delay((MS) * 1000000.0)
+#else
+#define _delay_us(US)        sim_delay_ns((US) * 1000.0)
+#define _delay_ms(MS)        sim_delay_ns((MS) * 1000000.0)
+#endif
+
+#endif
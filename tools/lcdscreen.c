@@ -0,0 +1,227 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host tool - static screens to PCF8574 byte streams
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       08.12.2020
+ * @file        lcdscreen.c
+ * @tested      gcc, Linux
+ *
+ * @usage       lcdscreen <output.h> <screen.scr> [<screen.scr> ...]
+ *
+ *              Every screen is encoded exactly like the driver does in
+ *              HD44780_PCF8574_Send_8bits_M4b_I - each nibble as three
+ *              expander bytes (data, data | E, data & ~E) with RS and
+ *              backlight already applied. Blob starts with 16 bit little
+ *              endian length and is streamed by HD44780_PCF8574_DrawScreen.
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PCF8574 pins, must match hd44780pcf8574.h
+#define PCF8574_PIN_RS       0x01
+#define PCF8574_PIN_E        0x04
+#define PCF8574_PIN_P3       0x08
+
+// HD44780 instructions and geometry, must match hd44780pcf8574.h
+#define HD44780_POSITION     0x80
+#define HD44780_ROW1_START   0x00
+#define HD44780_ROW2_START   0x40
+#define HD44780_ROWS         2
+// DDRAM line, screens may use columns hidden by display shift
+#define HD44780_LINE_LENGTH  40
+
+// max blob size
+#define SCREEN_MAX_BYTES     4096
+// max line length
+#define SCREEN_MAX_LINE      256
+
+/** @var current blob */
+static unsigned char blob[SCREEN_MAX_BYTES];
+/** @var current blob length */
+static unsigned int blob_len = 0;
+
+/**
+ * @desc    Append 8 bits in 4 bit mode to blob
+ *
+ * @param   unsigned char - data
+ * @param   unsigned char - annex (RS, backlight)
+ *
+ * @return  int
+ */
+static int append_8bits (unsigned char data, unsigned char annex)
+{
+  unsigned char nibble[2];
+  int i;
+
+  // upper nibble, lower nibble
+  nibble[0] = (data & 0xF0) | annex;
+  nibble[1] = ((data << 4) & 0xF0) | annex;
+  // check space
+  if (blob_len + 6 > SCREEN_MAX_BYTES) {
+    return -1;
+  }
+  // data, E up, E down
+  for (i = 0; i < 2; i++) {
+    blob[blob_len++] = nibble[i];
+    blob[blob_len++] = nibble[i] | PCF8574_PIN_E;
+    blob[blob_len++] = nibble[i] & ~PCF8574_PIN_E;
+  }
+  // success
+  return 0;
+}
+
+/**
+ * @desc    Write current blob as PROGMEM array
+ *
+ * @param   FILE *
+ * @param   const char * - screen name
+ *
+ * @return  void
+ */
+static void write_blob (FILE *out, const char *name)
+{
+  unsigned int i;
+
+  fprintf(out, "\n  // %u bytes on bus\n", blob_len);
+  fprintf(out, "  static const uint8_t HD44780_SCREEN_%s[] PROGMEM = {\n", name);
+  fprintf(out, "    0x%02X, 0x%02X,", blob_len & 0xFF, (blob_len >> 8) & 0xFF);
+  for (i = 0; i < blob_len; i++) {
+    // 12 bytes per line = 2 characters
+    if ((i % 12) == 0) {
+      fprintf(out, "\n   ");
+    }
+    fprintf(out, " 0x%02X,", blob[i]);
+  }
+  fprintf(out, "\n  };\n");
+}
+
+/**
+ * @desc    Parse one screen description file
+ *
+ * @param   FILE * - output
+ * @param   const char * - input file name
+ *
+ * @return  int
+ */
+static int parse_file (FILE *out, const char *file)
+{
+  char line[SCREEN_MAX_LINE];
+  char name[SCREEN_MAX_LINE] = "";
+  unsigned char backlight = PCF8574_PIN_P3;
+  unsigned int nr = 0;
+  int x, y, n;
+  char *text;
+  FILE *in;
+
+  // open
+  if ((in = fopen(file, "r")) == NULL) {
+    fprintf(stderr, "lcdscreen: cannot open %s\n", file);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), in) != NULL) {
+    nr++;
+    // strip new line
+    line[strcspn(line, "\r\n")] = '\0';
+    // comment or empty line
+    if ((line[0] == '#') || (line[0] == '\0')) {
+      continue;
+    }
+    // new screen
+    if (strncmp(line, "screen ", 7) == 0) {
+      // flush previous
+      if (name[0] != '\0') {
+        write_blob(out, name);
+      }
+      blob_len = 0;
+      sscanf(line + 7, "%255s", name);
+    // backlight
+    } else if (strncmp(line, "backlight ", 10) == 0) {
+      backlight = (strcmp(line + 10, "off") == 0) ? 0 : PCF8574_PIN_P3;
+    // text at x y
+    } else if ((sscanf(line, "%d %d %n", &x, &y, &n) == 2) && (name[0] != '\0')) {
+      // check geometry
+      if ((x < 0) || (x >= HD44780_LINE_LENGTH) || (y < 0) || (y >= HD44780_ROWS)) {
+        fprintf(stderr, "%s:%u: position out of display\n", file, nr);
+        fclose(in);
+        return -1;
+      }
+      // text past last column would wrap into other line
+      if (x + strlen(line + n) > HD44780_LINE_LENGTH) {
+        fprintf(stderr, "%s:%u: text past column %d\n", file, nr, HD44780_LINE_LENGTH - 1);
+        fclose(in);
+        return -1;
+      }
+      // set DDRAM address
+      if (append_8bits(HD44780_POSITION | ((y == 0 ? HD44780_ROW1_START : HD44780_ROW2_START) + x), backlight) < 0) {
+        fprintf(stderr, "%s:%u: screen too long\n", file, nr);
+        fclose(in);
+        return -1;
+      }
+      // characters
+      for (text = line + n; *text != '\0'; text++) {
+        if (append_8bits((unsigned char) *text, PCF8574_PIN_RS | backlight) < 0) {
+          fprintf(stderr, "%s:%u: screen too long\n", file, nr);
+          fclose(in);
+          return -1;
+        }
+      }
+    // unknown
+    } else {
+      fprintf(stderr, "%s:%u: syntax error\n", file, nr);
+      fclose(in);
+      return -1;
+    }
+  }
+  // last screen
+  if (name[0] != '\0') {
+    write_blob(out, name);
+  }
+  fclose(in);
+  // success
+  return 0;
+}
+
+/**
+ * @desc    Main function
+ *
+ * @param   int
+ * @param   char **
+ *
+ * @return  int
+ */
+int main (int argc, char **argv)
+{
+  FILE *out;
+  int i;
+
+  // usage
+  if (argc < 3) {
+    fprintf(stderr, "usage: lcdscreen <output.h> <screen.scr> [<screen.scr> ...]\n");
+    return EXIT_FAILURE;
+  }
+  // output
+  if ((out = fopen(argv[1], "w")) == NULL) {
+    fprintf(stderr, "lcdscreen: cannot create %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  fprintf(out, "/**\n * Generated by tools/lcdscreen - do not edit\n */\n");
+  fprintf(out, "#ifndef __SCREENS_H__\n#define __SCREENS_H__\n\n#include <stdint.h>\n#include <avr/pgmspace.h>\n");
+  // screens
+  for (i = 2; i < argc; i++) {
+    if (parse_file(out, argv[i]) < 0) {
+      fclose(out);
+      remove(argv[1]);
+      return EXIT_FAILURE;
+    }
+  }
+  fprintf(out, "\n#endif\n");
+  fclose(out);
+  // success
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,517 @@
+/**
+ * ---------------------------------------------------------------+
+ * @desc        Host tool - TWI trace dump to VCD with HD44780 decode
+ * ---------------------------------------------------------------+
+ *              Copyright (C) 2020 Marian Hrinko.
+ *              Written by Marian Hrinko (mato.hrinko@gmail.com)
+ *
+ * @author      Marian Hrinko
+ * @datum       15.12.2020
+ * @file        twitrace.c
+ * @tested      gcc, Linux
+ *
+ * @usage       twitrace <dump.txt> <out.vcd> [bit_us]
+ *
+ *              Input is the UART output of 't' command (make TRACE=1),
+ *              lines '<event> <stamp> <data> <status>' between
+ *              '# twitrace <ticks/us>' and '# end'. Output VCD holds
+ *              synthesized SCL / SDA (sigrok / PulseView import, i2c
+ *              decoder), PCF8574 port, HD44780 pins and decoded bytes.
+ *              Annotation is printed to stdout:
+ *                - every byte on bus with pin changes
+ *                - decoded instructions, data and reads
+ *                - 'idle' bytes not changing any pin
+ *                - 'merge' data setup bytes which could ride on E rise
+ *                  (RS, RW unchanged, data needs setup only before E fall)
+ * ---------------------------------------------------------------+
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PCF8574 pins, must match hd44780pcf8574.h
+#define PCF8574_PIN_RS       0x01
+#define PCF8574_PIN_RW       0x02
+#define PCF8574_PIN_E        0x04
+#define PCF8574_PIN_P3       0x08
+#define PCF8574_PIN_DB       0xF0
+
+// TWI events and status, must match twi.h
+#define TWI_EVENT_START      'S'
+#define TWI_EVENT_SLAW       'W'
+#define TWI_EVENT_SLAR       'R'
+#define TWI_EVENT_BYTE       'B'
+#define TWI_EVENT_RECEIVE    'r'
+#define TWI_EVENT_STOP       'P'
+#define TWI_START_ACK        0x08
+#define TWI_REP_START_ACK    0x10
+#define TWI_MT_SLAW_ACK      0x18
+#define TWI_MT_DATA_ACK      0x28
+#define TWI_MR_SLAR_ACK      0x40
+#define TWI_MR_DATA_ACK      0x50
+#define TWI_MR_DATA_NACK     0x58
+#define TWI_STATUS_NONE      0xF8
+
+// VCD time unit 100 ns
+#define VCD_UNITS_PER_US     10
+// default bit time, 100 kHz
+#define TRACE_BIT_US         10
+// max line length
+#define TRACE_MAX_LINE       128
+
+// VCD signal ids
+#define SIG_SCL              "!"
+#define SIG_SDA              "\""
+#define SIG_PORT             "#"
+#define SIG_RS               "$"
+#define SIG_RW               "%"
+#define SIG_E                "&"
+#define SIG_BL               "'"
+#define SIG_DB               "("
+#define SIG_LCD              ")"
+#define SIG_WASTE            "*"
+#define SIG_ERROR            "+"
+
+/** @var vcd output */
+static FILE *vcd;
+/** @var last time written to vcd */
+static unsigned long vcd_time = 0;
+/** @var device time of current record in us, for annotation */
+static double now = 0;
+/** @var bit time in vcd units */
+static unsigned long bit = TRACE_BIT_US * VCD_UNITS_PER_US;
+
+/** @struct decoder state */
+static struct {
+  // port of PCF8574, as last written
+  unsigned char port;
+  // port before last write
+  unsigned char prev;
+  // inside write / read transaction
+  char mode;
+  // controller in 8 bit mode, init sequence
+  char mode8;
+  // lower nibble expected
+  char phase;
+  // upper nibble, written / read
+  unsigned char high;
+  unsigned char rhigh;
+  char rphase;
+  // counters for summary
+  unsigned long bytes, starts, idle, merge, instructions, data, reads, errors;
+} lcd = { .port = 0xFF, .prev = 0xFF };
+
+/**
+ * @desc    VCD - move time, monotonic
+ *
+ * @param   unsigned long
+ *
+ * @return  void
+ */
+static void vcd_at (unsigned long t)
+{
+  if (t > vcd_time) {
+    vcd_time = t;
+    fprintf(vcd, "#%lu\n", vcd_time);
+  }
+}
+
+/**
+ * @desc    VCD - set 1 bit signal
+ *
+ * @param   unsigned long - time
+ * @param   const char * - id
+ * @param   int - value
+ *
+ * @return  void
+ */
+static void vcd_bit (unsigned long t, const char *id, int value)
+{
+  vcd_at(t);
+  fprintf(vcd, "%d%s\n", value ? 1 : 0, id);
+}
+
+/**
+ * @desc    VCD - set vector signal
+ *
+ * @param   unsigned long - time
+ * @param   const char * - id
+ * @param   unsigned - value
+ * @param   int - width
+ *
+ * @return  void
+ */
+static void vcd_vec (unsigned long t, const char *id, unsigned value, int width)
+{
+  int i;
+
+  vcd_at(t);
+  fputc('b', vcd);
+  for (i = width - 1; i >= 0; i--) {
+    fputc((value >> i) & 1 ? '1' : '0', vcd);
+  }
+  fprintf(vcd, " %s\n", id);
+}
+
+/**
+ * @desc    VCD - header
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+static void vcd_header (void)
+{
+  fprintf(vcd, "$comment tools/twitrace - PCF8574 / HD44780 $end\n");
+  fprintf(vcd, "$timescale 100 ns $end\n");
+  fprintf(vcd, "$scope module twi $end\n");
+  fprintf(vcd, "$var wire 1 %s scl $end\n", SIG_SCL);
+  fprintf(vcd, "$var wire 1 %s sda $end\n", SIG_SDA);
+  fprintf(vcd, "$var wire 1 %s error $end\n", SIG_ERROR);
+  fprintf(vcd, "$upscope $end\n");
+  fprintf(vcd, "$scope module pcf8574 $end\n");
+  fprintf(vcd, "$var wire 8 %s port $end\n", SIG_PORT);
+  fprintf(vcd, "$var wire 1 %s rs $end\n", SIG_RS);
+  fprintf(vcd, "$var wire 1 %s rw $end\n", SIG_RW);
+  fprintf(vcd, "$var wire 1 %s e $end\n", SIG_E);
+  fprintf(vcd, "$var wire 1 %s backlight $end\n", SIG_BL);
+  fprintf(vcd, "$var wire 4 %s db7_4 $end\n", SIG_DB);
+  fprintf(vcd, "$upscope $end\n");
+  fprintf(vcd, "$scope module hd44780 $end\n");
+  fprintf(vcd, "$var wire 8 %s byte $end\n", SIG_LCD);
+  fprintf(vcd, "$var wire 1 %s wasted $end\n", SIG_WASTE);
+  fprintf(vcd, "$upscope $end\n");
+  fprintf(vcd, "$enddefinitions $end\n");
+  fprintf(vcd, "#0\n$dumpvars\n1%s\n1%s\n0%s\nbxxxxxxxx %s\nx%s\nx%s\nx%s\nx%s\nbxxxx %s\nbxxxxxxxx %s\n0%s\n$end\n",
+    SIG_SCL, SIG_SDA, SIG_ERROR, SIG_PORT, SIG_RS, SIG_RW, SIG_E, SIG_BL, SIG_DB, SIG_LCD, SIG_WASTE);
+}
+
+/**
+ * @desc    VCD - short pulse on 1 bit signal
+ *
+ * @param   unsigned long - time
+ * @param   const char * - id
+ *
+ * @return  void
+ */
+static void vcd_pulse (unsigned long t, const char *id)
+{
+  vcd_bit(t, id, 1);
+  vcd_bit(t + bit / 2, id, 0);
+}
+
+/**
+ * @desc    Synthesize 8 bits + acknowledge on SCL / SDA
+ *
+ * @param   unsigned long - start time
+ * @param   unsigned char - byte
+ * @param   int - 1 if acknowledged
+ *
+ * @return  unsigned long - time after acknowledge
+ */
+static unsigned long wave_byte (unsigned long t, unsigned char data, int ack)
+{
+  int i;
+
+  for (i = 0; i < 9; i++) {
+    // data change while SCL low
+    vcd_bit(t, SIG_SDA, (i < 8) ? (data >> (7 - i)) & 1 : !ack);
+    // sample on SCL high
+    vcd_bit(t + bit / 4, SIG_SCL, 1);
+    vcd_bit(t + 3 * bit / 4, SIG_SCL, 0);
+    t += bit;
+  }
+  return t;
+}
+
+/**
+ * @desc    Instruction mnemonic
+ *
+ * @param   unsigned char
+ *
+ * @return  const char *
+ */
+static const char *mnemonic (unsigned char instr)
+{
+  if (instr & 0x80) return "set DDRAM address";
+  if (instr & 0x40) return "set CGRAM address";
+  if (instr & 0x20) return "function set";
+  if (instr & 0x10) return (instr & 0x08) ? "display shift" : "cursor shift";
+  if (instr & 0x08) return "display control";
+  if (instr & 0x04) return "entry mode set";
+  if (instr & 0x02) return "return home";
+  if (instr & 0x01) return "display clear";
+  return "nop";
+}
+
+/**
+ * @desc    Decode written nibble latched on E fall
+ *
+ * @param   unsigned long - time
+ * @param   unsigned char - port before E fall
+ *
+ * @return  void
+ */
+static void lcd_nibble (unsigned long t, unsigned char port)
+{
+  unsigned char nibble = port & PCF8574_PIN_DB;
+  int rs = port & PCF8574_PIN_RS;
+  unsigned char value;
+
+  // function set 8 bit, init sequence or lost nibble sync
+  if (!rs && !lcd.phase && (nibble == 0x30)) {
+    lcd.mode8 = 1;
+  }
+  // 8 bit mode - single nibble is whole instruction
+  if (lcd.mode8) {
+    printf("%10.1f us   INSTR 0x%02X  %s (8 bit)\n", now, nibble, mnemonic(nibble));
+    vcd_vec(t, SIG_LCD, nibble, 8);
+    lcd.instructions++;
+    // function set 4 bit
+    if (nibble == 0x20) {
+      lcd.mode8 = 0;
+    }
+    lcd.phase = 0;
+    return;
+  }
+  // upper nibble
+  if (!lcd.phase) {
+    lcd.high = nibble;
+    lcd.phase = 1;
+    return;
+  }
+  // lower nibble completes byte
+  value = lcd.high | (nibble >> 4);
+  lcd.phase = 0;
+  vcd_vec(t, SIG_LCD, value, 8);
+  if (rs) {
+    printf("%10.1f us   DATA  0x%02X  '%c'\n", now, value, (value >= 0x20 && value < 0x7F) ? value : '.');
+    lcd.data++;
+  } else {
+    printf("%10.1f us   INSTR 0x%02X  %s\n", now, value, mnemonic(value));
+    lcd.instructions++;
+  }
+}
+
+/**
+ * @desc    Decode byte written to PCF8574
+ *
+ * @param   unsigned long - time pins change
+ * @param   unsigned char - new port
+ *
+ * @return  void
+ */
+static void lcd_write (unsigned long t, unsigned char port)
+{
+  unsigned char before = lcd.prev;
+  unsigned char old = lcd.port;
+
+  // pins
+  vcd_vec(t, SIG_PORT, port, 8);
+  vcd_bit(t, SIG_RS, port & PCF8574_PIN_RS);
+  vcd_bit(t, SIG_RW, port & PCF8574_PIN_RW);
+  vcd_bit(t, SIG_E, port & PCF8574_PIN_E);
+  vcd_bit(t, SIG_BL, port & PCF8574_PIN_P3);
+  vcd_vec(t, SIG_DB, port >> 4, 4);
+  printf("%10.1f us     port 0x%02X", now, port);
+  // nothing changed
+  if (port == old) {
+    printf("  idle\n");
+    vcd_pulse(t, SIG_WASTE);
+    lcd.idle++;
+  // E rise after data setup byte with RS, RW kept
+  } else if ((port == (old | PCF8574_PIN_E)) && !(old & PCF8574_PIN_E) && !(before & PCF8574_PIN_E) &&
+             ((old & (PCF8574_PIN_RS | PCF8574_PIN_RW)) == (before & (PCF8574_PIN_RS | PCF8574_PIN_RW))) &&
+             ((old & PCF8574_PIN_DB) != (before & PCF8574_PIN_DB)) && (before != 0xFF)) {
+    printf("  E rise, previous byte could merge\n");
+    vcd_pulse(t, SIG_WASTE);
+    lcd.merge++;
+  } else {
+    printf("%s\n", (old == 0xFF) ? "" : (port & PCF8574_PIN_E) && !(old & PCF8574_PIN_E) ? "  E rise" :
+                   !(port & PCF8574_PIN_E) && (old & PCF8574_PIN_E) ? "  E fall" : "");
+  }
+  // E fall with RW low latches nibble
+  if ((old != 0xFF) && (old & PCF8574_PIN_E) && !(port & PCF8574_PIN_E) && !(old & PCF8574_PIN_RW)) {
+    lcd_nibble(t, old);
+  }
+  lcd.prev = old;
+  lcd.port = port;
+}
+
+/**
+ * @desc    Decode byte read from PCF8574
+ *
+ * @param   unsigned char - pins
+ *
+ * @return  void
+ */
+static void lcd_read (unsigned char pins)
+{
+  unsigned char value;
+
+  printf("%10.1f us     read 0x%02X\n", now, pins);
+  // upper nibble
+  if (!lcd.rphase) {
+    lcd.rhigh = pins & PCF8574_PIN_DB;
+    lcd.rphase = 1;
+    return;
+  }
+  // lower nibble
+  value = lcd.rhigh | ((pins & PCF8574_PIN_DB) >> 4);
+  lcd.rphase = 0;
+  lcd.reads++;
+  if (lcd.port & PCF8574_PIN_RS) {
+    printf("%10.1f us   READ  0x%02X  data\n", now, value);
+  } else {
+    printf("%10.1f us   READ  0x%02X  BF %d AC 0x%02X\n", now, value, value >> 7, value & 0x7F);
+  }
+}
+
+/**
+ * @desc    Report unexpected status
+ *
+ * @param   unsigned long - time
+ * @param   unsigned - status
+ * @param   unsigned - expected
+ *
+ * @return  void
+ */
+static void check (unsigned long t, unsigned status, unsigned expected)
+{
+  if (status != expected) {
+    printf("%10.1f us   ERROR status 0x%02X, expected 0x%02X\n", now, status, expected);
+    vcd_pulse(t, SIG_ERROR);
+    lcd.errors++;
+  }
+}
+
+/**
+ * @desc    Main function
+ *
+ * @param   int
+ * @param   char **
+ *
+ * @return  int
+ */
+int main (int argc, char **argv)
+{
+  char line[TRACE_MAX_LINE];
+  unsigned ticks_per_us = 1;
+  unsigned stamp, data, status;
+  unsigned last_stamp = 0;
+  unsigned long wrap = 0;
+  unsigned long t, end;
+  int started = 0;
+  char event;
+  FILE *in;
+
+  // usage
+  if (argc < 3) {
+    fprintf(stderr, "usage: twitrace <dump.txt> <out.vcd> [bit_us]\n");
+    return EXIT_FAILURE;
+  }
+  if (argc > 3) {
+    bit = strtoul(argv[3], NULL, 10) * VCD_UNITS_PER_US;
+  }
+  // files
+  if ((in = fopen(argv[1], "r")) == NULL) {
+    fprintf(stderr, "twitrace: cannot open %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  if ((vcd = fopen(argv[2], "w")) == NULL) {
+    fprintf(stderr, "twitrace: cannot create %s\n", argv[2]);
+    fclose(in);
+    return EXIT_FAILURE;
+  }
+  vcd_header();
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    // header
+    if (sscanf(line, "# twitrace %u", &ticks_per_us) == 1) {
+      started = 1;
+      ticks_per_us = ticks_per_us ? ticks_per_us : 1;
+      continue;
+    }
+    // footer or noise around dump
+    if (!started || (strncmp(line, "# end", 5) == 0)) {
+      started = started && strncmp(line, "# end", 5);
+      continue;
+    }
+    if (sscanf(line, " %c %x %x %x", &event, &stamp, &data, &status) != 4) {
+      continue;
+    }
+    // unwrap 16 bit Timer1
+    if (stamp < last_stamp) {
+      wrap += 0x10000UL;
+    }
+    last_stamp = stamp;
+    // end of event in vcd units
+    end = ((wrap + stamp) * VCD_UNITS_PER_US) / ticks_per_us;
+    now = (double) (wrap + stamp) / ticks_per_us;
+
+    switch (event) {
+      // start or repeated start, ends with SCL low
+      case TWI_EVENT_START:
+        t = (end > bit + vcd_time) ? end - bit : vcd_time;
+        vcd_bit(t, SIG_SDA, 1);
+        vcd_bit(t + bit / 4, SIG_SCL, 1);
+        vcd_bit(t + bit / 2, SIG_SDA, 0);
+        vcd_bit(t + 3 * bit / 4, SIG_SCL, 0);
+        printf("%10.1f us START\n", now);
+        check(end, status, (status == TWI_REP_START_ACK) ? TWI_REP_START_ACK : TWI_START_ACK);
+        lcd.starts++;
+        lcd.mode = 0;
+        break;
+      // address
+      case TWI_EVENT_SLAW:
+      case TWI_EVENT_SLAR:
+        t = (end > 9 * bit + vcd_time) ? end - 9 * bit : vcd_time;
+        wave_byte(t, data, (status == TWI_MT_SLAW_ACK) || (status == TWI_MR_SLAR_ACK));
+        printf("%10.1f us   SLA%c 0x%02X\n", now, (event == TWI_EVENT_SLAW) ? 'W' : 'R', data >> 1);
+        check(end, status, (event == TWI_EVENT_SLAW) ? TWI_MT_SLAW_ACK : TWI_MR_SLAR_ACK);
+        lcd.mode = event;
+        lcd.bytes++;
+        break;
+      // data to PCF8574, pins change after acknowledge
+      case TWI_EVENT_BYTE:
+        t = (end > 9 * bit + vcd_time) ? end - 9 * bit : vcd_time;
+        t = wave_byte(t, data, status == TWI_MT_DATA_ACK);
+        check(end, status, TWI_MT_DATA_ACK);
+        lcd_write(t, data);
+        lcd.bytes++;
+        break;
+      // data from PCF8574
+      case TWI_EVENT_RECEIVE:
+        t = (end > 9 * bit + vcd_time) ? end - 9 * bit : vcd_time;
+        wave_byte(t, data, status == TWI_MR_DATA_ACK);
+        if ((status != TWI_MR_DATA_ACK) && (status != TWI_MR_DATA_NACK)) {
+          check(end, status, TWI_MR_DATA_NACK);
+        }
+        lcd_read(data);
+        lcd.bytes++;
+        break;
+      // stop
+      case TWI_EVENT_STOP:
+        t = (end > vcd_time) ? end : vcd_time;
+        vcd_bit(t, SIG_SDA, 0);
+        vcd_bit(t + bit / 4, SIG_SCL, 1);
+        vcd_bit(t + bit / 2, SIG_SDA, 1);
+        printf("%10.1f us STOP\n", now);
+        lcd.mode = 0;
+        break;
+    }
+  }
+  fprintf(vcd, "#%lu\n", vcd_time + bit);
+  fclose(vcd);
+  fclose(in);
+
+  // summary
+  printf("\n%lu bytes in %lu transactions\n", lcd.bytes, lcd.starts);
+  printf("%lu instructions, %lu data, %lu reads\n", lcd.instructions, lcd.data, lcd.reads);
+  printf("%lu idle bytes, %lu mergeable setup bytes, %lu errors\n", lcd.idle, lcd.merge, lcd.errors);
+  if (lcd.instructions + lcd.data) {
+    printf("%.1f bus bytes per HD44780 byte\n", (double) lcd.bytes / (lcd.instructions + lcd.data));
+  }
+  // success
+  return EXIT_SUCCESS;
+}